@@ -234,6 +234,20 @@ void jpeg_free(struct jpeg_reader *j)
 	free(j);
 }
 
+int jpeg_scale(struct jpeg_reader *j, unsigned int num, unsigned int denom, struct jpeg_conf *conf)
+{
+	if (0 != setjmp(j->e.jmp))
+		return -1;
+
+	j->jd.scale_num = num;
+	j->jd.scale_denom = denom;
+	jpeg_calc_output_dimensions(&j->jd);
+
+	conf->width = j->jd.output_width;
+	conf->height = j->jd.output_height;
+	return 0;
+}
+
 enum { R_START, R_READ, R_FIN };
 
 int jpeg_read(struct jpeg_reader *j, const void *data, size_t *len, void *line)
@@ -255,7 +269,7 @@ int jpeg_read(struct jpeg_reader *j, const void *data, size_t *len, void *line)
 	case R_READ:
 		if (1 != jpeg_read_scanlines(&j->jd, (void*)&line, 1))
 			return 0;
-		if (++j->line == j->jd.image_height)
+		if (++j->line == j->jd.output_height)
 			j->state = R_FIN;
 		r = 1;
 		break;
@@ -40,6 +40,14 @@ _EXPORT int jpeg_open(struct jpeg_reader **j, const void *data, size_t *len, str
 
 _EXPORT void jpeg_free(struct jpeg_reader *j);
 
+/** Set DCT scaling factor: the image will be decoded with size (width * num / denom).
+Must be called after jpeg_open() and before jpeg_read().
+libjpeg-turbo supports num = 1..16 and denom = 8.
+conf: receives the output 'width' and 'height'
+Return 0 on success;
+ <0 on error. */
+_EXPORT int jpeg_scale(struct jpeg_reader *j, unsigned int num, unsigned int denom, struct jpeg_conf *conf);
+
 /** Read one line.
 line: receives uncompressed data;  must be large enough for a full line.
 Return 1 if line is ready;
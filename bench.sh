@@ -0,0 +1,282 @@
+#!/bin/bash
+# fcom benchmark
+# Generates test data in $BENCH_DIR and measures the time of fcom operations.
+# Prints 1 JSON object per line to stdout:
+#  {"bench":"NAME","usec":N,"bytes":N,"files":N,"mb_per_sec":N,"files_per_sec":N,"peak_rss_kb":N}
+# 'startup' runs fcom many times on a tiny input and prints:
+#  {"bench":"startup-OP","exe":"NAME","runs":N,"usec":N,"usec_per_run":N}
+# Environment:
+#  FCOM         fcom executable (default: ./fcom)
+#  FCOM_STATIC  static fcom executable to compare startup time with (default: ./fcom-static if exists)
+#  BENCH_DIR    directory for test data (default: ./fcombench); reused by the next runs
+#  BENCH_SCALE  multiply the size of test data (default: 1)
+
+BENCHES=(startup copy list sync zip zst gz md5 textcount pic)
+
+if test "$#" -lt 1 ; then
+	echo "Usage: bash bench.sh (all | BENCH...)"
+	echo "BENCH: ${BENCHES[@]}"
+	exit 1
+fi
+
+CMDS=("$@")
+if test "$1" == "all" ; then
+	CMDS=("${BENCHES[@]}")
+fi
+
+set -e
+
+FCOM=$(realpath ${FCOM:-./fcom})
+FCOM_STATIC=${FCOM_STATIC:-./fcom-static}
+if test -x "$FCOM_STATIC" ; then
+	FCOM_STATIC=$(realpath $FCOM_STATIC)
+else
+	FCOM_STATIC=
+fi
+BENCH_DIR=$(realpath -m ${BENCH_DIR:-./fcombench})
+SCALE=${BENCH_SCALE:-1}
+DATA=$BENCH_DIR/data
+OUT=$BENCH_DIR/out
+
+# GNU time reports peak RSS
+TIME_BIN=
+if /usr/bin/time -f %M true 2>/dev/null ; then
+	TIME_BIN=/usr/bin/time
+fi
+
+log() {
+	echo "bench: $@" >&2
+}
+
+# Compressible text data
+gen_text() {
+	seq 1 $(($1 / 32 + 1)) | awk '{ print $1, "file", $1 * 7, "lorem ipsum dolor sit amet, consectetur" }' | head -c $1
+}
+
+# Little-endian integers for binary headers
+le16() {
+	printf "\\x$(printf %02x $(($1 & 255)))\\x$(printf %02x $((($1 >> 8) & 255)))"
+}
+le32() {
+	le16 $(($1 & 65535)) ; le16 $((($1 >> 16) & 65535))
+}
+
+# 24-bit .bmp file with random pixels
+gen_bmp() {
+	local w=$1 h=$2 stride=$((($1 * 3 + 3) / 4 * 4))
+	local size=$((stride * h))
+	{
+		printf "BM" ; le32 $((54 + size)) ; le32 0 ; le32 54
+		le32 40 ; le32 $w ; le32 $h ; le16 1 ; le16 24 ; le32 0 ; le32 $size ; le32 2835 ; le32 2835 ; le32 0 ; le32 0
+		head -c $size /dev/urandom
+	} >$3
+}
+
+# Many small files: half compressible, half random
+gen_small() {
+	test -f $DATA/small.done && return
+	log "generating small files..."
+	rm -rf $DATA/small
+	local ndirs=$((100 * SCALE))
+	gen_text $((ndirs / 2 * 100 * 4096)) >$DATA/small.txt
+	for i in $(seq 1 $ndirs) ; do
+		mkdir -p $DATA/small/d$i
+		if test $((i % 2)) == 0 ; then
+			tail -c +$(((i / 2 - 1) * 100 * 4096 + 1)) $DATA/small.txt | head -c $((100 * 4096)) | split -b 4096 -d -a 3 - $DATA/small/d$i/f
+		else
+			head -c $((100 * 4096)) /dev/urandom | split -b 4096 -d -a 3 - $DATA/small/d$i/f
+		fi
+	done
+	rm $DATA/small.txt
+	touch $DATA/small.done
+}
+
+# Few huge files: compressible and random
+gen_big() {
+	test -f $DATA/big.done && return
+	log "generating big files..."
+	mkdir -p $DATA/big
+	gen_text $((256 * 1024 * 1024 * SCALE)) >$DATA/big/text.dat
+	head -c $((256 * 1024 * 1024 * SCALE)) /dev/urandom >$DATA/big/rnd.dat
+	touch $DATA/big.done
+}
+
+# Deep directory tree
+gen_deep() {
+	test -f $DATA/deep.done && return
+	log "generating deep tree..."
+	rm -rf $DATA/deep
+	for b in $(seq 1 $((10 * SCALE))) ; do
+		local d=$DATA/deep/b$b
+		for l in $(seq 1 32) ; do
+			d=$d/l$l
+			mkdir -p $d
+			head -c 1024 /dev/urandom | split -b 256 -a 1 - $d/f
+		done
+	done
+	touch $DATA/deep.done
+}
+
+gen_pic() {
+	test -f $DATA/pic.done && return
+	log "generating pictures..."
+	mkdir -p $DATA/pic
+	for i in $(seq 1 $((10 * SCALE))) ; do
+		gen_bmp 1920 1080 $DATA/pic/p$i.bmp
+	done
+	touch $DATA/pic.done
+}
+
+dir_bytes() {
+	find "$@" -type f -printf '%s\n' | awk '{ n += $1 } END { print n }'
+}
+
+dir_files() {
+	find "$@" -type f | wc -l
+}
+
+# run NAME BYTES FILES COMMAND...
+run() {
+	local name=$1 bytes=$2 files=$3
+	shift 3
+	log "$name: $@"
+
+	sync
+	local rss=0
+	local t1=$(date +%s%N)
+	if test -n "$TIME_BIN" ; then
+		$TIME_BIN -f %M -o $BENCH_DIR/rss "$@" >/dev/null
+		rss=$(tail -1 $BENCH_DIR/rss)
+	else
+		"$@" >/dev/null
+	fi
+	local t2=$(date +%s%N)
+
+	local usec=$(((t2 - t1) / 1000))
+	test $usec != 0 || usec=1
+	printf '{"bench":"%s","usec":%u,"bytes":%u,"files":%u,"mb_per_sec":%u,"files_per_sec":%u,"peak_rss_kb":%u}\n' \
+		$name $usec $bytes $files $((bytes / usec)) $((files * 1000000 / usec)) $rss
+}
+
+# Process startup: module loading dominates when fcom is run for every single file
+bench_startup() {
+	mkdir -p $DATA/startup
+	echo "startup" >$DATA/startup/f
+	local n=$((1000 * SCALE))
+
+	for exe in $FCOM $FCOM_STATIC ; do
+		for op in list md5 ; do
+			log "startup-$op: $exe x$n"
+			local t1=$(date +%s%N)
+			for i in $(seq 1 $n) ; do
+				$exe $op $DATA/startup/f >/dev/null
+			done
+			local t2=$(date +%s%N)
+
+			local usec=$(((t2 - t1) / 1000))
+			printf '{"bench":"startup-%s","exe":"%s","runs":%u,"usec":%u,"usec_per_run":%u}\n' \
+				$op $(basename $exe) $n $usec $((usec / n))
+		done
+	done
+}
+
+bench_copy() {
+	gen_small ; gen_big ; gen_deep
+	run copy-small $(dir_bytes $DATA/small) $(dir_files $DATA/small) \
+		$FCOM copy $DATA/small -C $OUT/copy
+	run copy-big $(dir_bytes $DATA/big) 2 \
+		$FCOM copy $DATA/big -C $OUT/copy
+	run copy-deep $(dir_bytes $DATA/deep) $(dir_files $DATA/deep) \
+		$FCOM copy $DATA/deep -C $OUT/copy
+}
+
+# 'find -printf' is the reference for listing a large tree
+bench_list() {
+	gen_small ; gen_deep
+	for d in small deep ; do
+		run list-$d 0 $(dir_files $DATA/$d) \
+			$FCOM list -R $DATA/$d
+		run list-long-$d 0 $(dir_files $DATA/$d) \
+			$FCOM list -R -l $DATA/$d
+		run find-printf-$d 0 $(dir_files $DATA/$d) \
+			find $DATA/$d -printf '%s %TY-%Tm-%Td %TT %p\n'
+	done
+}
+
+bench_sync() {
+	gen_small
+	# target directory: a copy with some files changed
+	mkdir -p $OUT/sync
+	cp -a $DATA/small $OUT/sync/right
+	find $OUT/sync/right -name 'f0[0-4]*' -delete
+	find $OUT/sync/right -name 'f09*' -exec touch {} +
+
+	cd $DATA
+	run sync-diff $(dir_bytes small) $(dir_files small) \
+		$FCOM sync --diff "" small -o $OUT/sync/right
+	run sync-snapshot $(dir_bytes small) $(dir_files small) \
+		$FCOM sync --snapshot small -o $OUT/sync/small.snap -f
+	cd - >/dev/null
+}
+
+bench_zip() {
+	gen_small
+	run zip $(dir_bytes $DATA/small) $(dir_files $DATA/small) \
+		$FCOM zip $DATA/small -o $OUT/small.zip
+	run unzip $(dir_bytes $DATA/small) $(dir_files $DATA/small) \
+		$FCOM unzip $OUT/small.zip -C $OUT/unzip
+}
+
+bench_zst() {
+	gen_big
+	for f in text rnd ; do
+		run zst-$f $(dir_bytes $DATA/big/$f.dat) 1 \
+			$FCOM zst $DATA/big/$f.dat -o $OUT/$f.zst
+		run unzst-$f $(dir_bytes $DATA/big/$f.dat) 1 \
+			$FCOM unzst $OUT/$f.zst -o $OUT/$f.unzst
+	done
+}
+
+bench_gz() {
+	gen_big
+	for f in text rnd ; do
+		run gz-$f $(dir_bytes $DATA/big/$f.dat) 1 \
+			$FCOM gz $DATA/big/$f.dat -o $OUT/$f.gz
+		run ungz-$f $(dir_bytes $DATA/big/$f.dat) 1 \
+			$FCOM ungz $OUT/$f.gz -o $OUT/$f.ungz
+	done
+}
+
+bench_md5() {
+	gen_small ; gen_big
+	run md5-big $(dir_bytes $DATA/big) 2 \
+		$FCOM md5 $DATA/big
+	run md5-small $(dir_bytes $DATA/small) $(dir_files $DATA/small) \
+		$FCOM md5 $DATA/small
+}
+
+bench_textcount() {
+	gen_big
+	run textcount $(dir_bytes $DATA/big/text.dat) 1 \
+		$FCOM textcount $DATA/big/text.dat
+}
+
+bench_pic() {
+	gen_pic
+	run pic-jpg $(dir_bytes $DATA/pic) $(dir_files $DATA/pic) \
+		$FCOM pic $DATA/pic -C $OUT/pic -o .jpg
+	run pic-resize $(dir_bytes $DATA/pic) $(dir_files $DATA/pic) \
+		$FCOM pic $DATA/pic --max-side 640 -C $OUT/pic-small -o .png
+}
+
+mkdir -p $DATA
+
+for cmd in "${CMDS[@]}" ; do
+
+	rm -rf $OUT
+	mkdir -p $OUT
+	bench_$cmd
+
+done
+
+rm -rf $OUT
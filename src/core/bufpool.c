@@ -0,0 +1,149 @@
+/** fcom: core: pool of aligned I/O buffers
+2026, Simon Zolin */
+
+/*
+Buffers are grouped in size classes: powers of 2 from 4KB to 64MB.
+A released buffer is kept in the free list of its class
+ until the total size of idle buffers reaches BUFPOOL_IDLE_MAX.
+The list is LIFO, so the next user gets the memory that has been used (page-faulted in) most recently.
+Larger buffers are allocated and freed directly.
+Huge pages (Linux): buffers >=2MB are aligned to 2MB and marked for transparent huge pages.
+*/
+
+#include <fcom.h>
+#ifdef FF_LINUX
+#include <sys/mman.h>
+#endif
+
+extern fcom_core *core;
+
+#define BUFPOOL_ALIGN  (4*1024)
+#define BUFPOOL_CLASS_MIN_SHIFT  12 // 4KB
+#define BUFPOOL_CLASSES  15 // ..64MB
+#define BUFPOOL_IDLE_MAX  (256*1024*1024)
+#define BUFPOOL_HUGE  (2*1024*1024)
+
+struct bp_free {
+	struct bp_free *next;
+};
+
+struct bufpool {
+	fflock lock;
+	struct bp_free *free[BUFPOOL_CLASSES];
+	ffsize idle; // bytes in free lists
+	ffsize used, used_peak; // bytes given to users
+	uint hugepages :1;
+};
+static struct bufpool gbp;
+
+void bufpool_init(uint hugepages)
+{
+	fflock_init(&gbp.lock);
+	gbp.hugepages = hugepages;
+}
+
+/** Size class index;  -1: too large */
+static int bp_class(ffsize size)
+{
+	if (size <= ((ffsize)1 << BUFPOOL_CLASS_MIN_SHIFT))
+		return 0;
+	uint i = 64 - __builtin_clzll(size - 1) - BUFPOOL_CLASS_MIN_SHIFT; // ceil(log2(size))
+	if (i >= BUFPOOL_CLASSES)
+		return -1;
+	return i;
+}
+
+static void* bp_sys_alloc(ffsize size)
+{
+	void *p;
+#ifdef FF_LINUX
+	if (gbp.hugepages && size >= BUFPOOL_HUGE) {
+		if (NULL != (p = ffmem_align(size, BUFPOOL_HUGE)))
+			madvise(p, size, MADV_HUGEPAGE);
+		return p;
+	}
+#endif
+	p = ffmem_align(size, BUFPOOL_ALIGN);
+	return p;
+}
+
+/** Get buffer of at least `size` bytes aligned to 4KB */
+void* bufpool_alloc(ffsize size)
+{
+	void *p = NULL;
+	int c = bp_class(size);
+	if (c >= 0)
+		size = (ffsize)1 << (c + BUFPOOL_CLASS_MIN_SHIFT);
+
+	fflock_lock(&gbp.lock);
+	if (c >= 0 && gbp.free[c] != NULL) {
+		struct bp_free *f = gbp.free[c];
+		gbp.free[c] = f->next;
+		gbp.idle -= size;
+		p = f;
+	}
+	gbp.used += size;
+	gbp.used_peak = ffmax(gbp.used_peak, gbp.used);
+	fflock_unlock(&gbp.lock);
+
+	if (p != NULL) {
+		if (core->stats)
+			core->stat_add(FCOM_STAT_BUF_REUSED, 1);
+		return p;
+	}
+
+	if (NULL == (p = bp_sys_alloc(size))) {
+		fflock_lock(&gbp.lock);
+		gbp.used -= size;
+		fflock_unlock(&gbp.lock);
+		return NULL;
+	}
+	if (core->stats)
+		core->stat_add(FCOM_STAT_BUF_NEW, 1);
+	return p;
+}
+
+/** Return buffer to the pool
+size: the same value passed to bufpool_alloc() */
+void bufpool_free(void *p, ffsize size)
+{
+	if (p == NULL)
+		return;
+
+	int c = bp_class(size);
+	if (c >= 0)
+		size = (ffsize)1 << (c + BUFPOOL_CLASS_MIN_SHIFT);
+
+	fflock_lock(&gbp.lock);
+	gbp.used -= size;
+	if (c >= 0 && gbp.idle + size <= BUFPOOL_IDLE_MAX) {
+		struct bp_free *f = p;
+		f->next = gbp.free[c];
+		gbp.free[c] = f;
+		gbp.idle += size;
+		p = NULL;
+	}
+	fflock_unlock(&gbp.lock);
+
+	if (p != NULL)
+		ffmem_alignfree(p);
+}
+
+/** Add pool usage to performance counters */
+void bufpool_stats()
+{
+	core->stat_add(FCOM_STAT_BUF_PEAK_KB, gbp.used_peak / 1024);
+}
+
+void bufpool_destroy()
+{
+	for (uint i = 0;  i != BUFPOOL_CLASSES;  i++) {
+		struct bp_free *f = gbp.free[i], *next;
+		for (;  f != NULL;  f = next) {
+			next = f->next;
+			ffmem_alignfree(f);
+		}
+		gbp.free[i] = NULL;
+	}
+	gbp.idle = 0;
+}
@@ -6,6 +6,8 @@
 #include <ffsys/pipe.h>
 #include <ffbase/map.h>
 #include <ffbase/fntree.h>
+#include <ffbase/sort.h>
+#include <util/wildcard-set.h>
 
 extern fcom_core *core;
 
@@ -30,10 +32,16 @@ struct cmd {
 	uint argi;
 
 	fntree_block *ftree;
+	fntree_block *ftree_prev; // the previous portion of names from input_fd
 	fntree_cursor ftree_cur;
 	ffvec ftree_name;
 	fffd ftree_dir;
+	uint ftree_type; // enum FCOM_COM_FT: type of the current file
+	wcset include, exclude; // compiled cmd.include, cmd.exclude
 	uint isdir :1;
+	uint wc_compiled :1;
+	uint names_eof :1;
+	ffvec names_buf; // data read from input_fd
 	uint set_ftree :1;
 	uint args_parsed :1;
 	int result;
@@ -57,6 +65,7 @@ static void com_signal_all(uint signal)
 		struct cmd *c = FF_STRUCTPTR(struct cmd, sib, it);
 		if (c->op == NULL)
 			continue;
+		core->job_cancel(c->op);
 		c->opif->signal(c->op, signal);
 	}
 }
@@ -69,6 +78,8 @@ static fcom_cominfo* cmd_create()
 	ffstr path = {};
 	c->ftree = fntree_create(path);
 	c->ftree_dir = FFFILE_NULL;
+	wcset_init(&c->include);
+	wcset_init(&c->exclude);
 	fflist_add(&com.cmds, &c->sib);
 	return &c->cmd;
 }
@@ -101,8 +112,12 @@ static void cmd_destroy(fcom_cominfo *cmd)
 		ffstr_free(it);
 	}
 	ffvec_free(&cmd->exclude);
+	wcset_free(&c->include);
+	wcset_free(&c->exclude);
 
 	fntree_free_all(c->ftree);
+	fntree_free_all(c->ftree_prev);
+	ffvec_free(&c->names_buf);
 	ffvec_free(&c->ftree_name);
 	if (c->ftree_dir != FFFILE_NULL)
 		fffile_close(c->ftree_dir);
@@ -322,90 +337,256 @@ err:
 	return -1;
 }
 
-static int input_names_read(struct cmd *c)
+/** Each file tree entry stores the file type (enum FCOM_COM_FT) */
+static fntree_entry* ftree_add(fntree_block **b, ffstr name, uint type)
 {
-	fcom_cominfo *cmd = &c->cmd;
-	int rc = -1;
-	ffvec in_list = {};
+	fntree_entry *e = fntree_add(b, name, 1);
+	if (e != NULL)
+		*(u_char*)fntree_data(e) = type;
+	return e;
+}
 
-	for (;;) {
-		ffvec_grow(&in_list, 64*1024, 1);
-		dbglog("reading from input names file...");
-		ffssize r;
-		if (cmd->input_fd == ffstdin)
-			r = ffpipe_read(cmd->input_fd, ffslice_end(&in_list, 1), ffvec_unused(&in_list));
-		else
-			r = fffile_read(cmd->input_fd, ffslice_end(&in_list, 1), ffvec_unused(&in_list));
-		if (r == 0) {
-			break;
-		} else if (r < 0) {
-			syserrlog("input names file read");
-			goto end;
-		}
-		dbglog("input names file: read %L bytes", r);
-		in_list.len += r;
+#ifdef FF_LINUX
+
+#include <dirent.h>
+#include <fcntl.h>
+
+struct dent {
+	uint off; // offset of the name in the names buffer
+	uint type;
+};
+
+static int dent_cmp(const void *_a, const void *_b, void *udata)
+{
+	const struct dent *a = _a, *b = _b;
+	const char *names = udata;
+	return ffsz_cmp(names + a->off, names + b->off);
+}
+
+static uint dt_type(uint d_type)
+{
+	switch (d_type) {
+	case DT_UNKNOWN: return FCOM_COM_FT_UNKNOWN;
+	case DT_REG: return FCOM_COM_FT_FILE;
+	case DT_DIR: return FCOM_COM_FT_DIR;
+	case DT_LNK: return FCOM_COM_FT_LINK;
 	}
+	return FCOM_COM_FT_OTHER;
+}
+
+/** Read directory entries along with their types (d_type) into a new file tree block.
+The names are sorted.
+fd: [optional] directory descriptor */
+static fntree_block* ftree_dirscan(ffstr path, fffd fd)
+{
+	fntree_block *b = NULL;
+	ffvec names = {}, ents = {};
+	DIR *d;
 
-	ffstr view = FFSTR_INITSTR(&in_list);
-	while (view.len != 0) {
-		ffstr name;
-		ffstr_splitby(&view, '\n', &name, &view);
-		ffstr_trimwhite(&name);
-		if (name.len == 0)
+	if (fd == FFFILE_NULL
+		&& 0 > (fd = open(path.ptr, O_RDONLY | O_DIRECTORY | O_CLOEXEC)))
+		return NULL;
+	if (NULL == (d = fdopendir(fd))) {
+		close(fd);
+		return NULL;
+	}
+
+	const struct dirent *de;
+	errno = 0;
+	while (NULL != (de = readdir(d))) {
+		const char *fn = de->d_name;
+		if (fn[0] == '.' && (fn[1] == '\0' || (fn[1] == '.' && fn[2] == '\0')))
 			continue;
 
-		if (NULL == fntree_add(&c->ftree, name, 0)) {
-			fcom_errlog("fntree_add");
+		struct dent *e = ffvec_pushT(&ents, struct dent);
+		e->off = names.len;
+		e->type = dt_type(de->d_type);
+		ffvec_addsz(&names, fn);
+		ffvec_addchar(&names, '\0');
+	}
+	int err = errno;
+	closedir(d);
+	if (err != 0) {
+		errno = err;
+		goto end;
+	}
+
+	ffsort(ents.ptr, ents.len, sizeof(struct dent), dent_cmp, names.ptr);
+
+	b = fntree_create(path);
+	struct dent *it;
+	FFSLICE_WALK(&ents, it) {
+		ffstr name = FFSTR_INITZ((char*)names.ptr + it->off);
+		if (NULL == ftree_add(&b, name, it->type)) {
+			fntree_free_all(b);
+			b = NULL;
 			goto end;
 		}
 	}
 
-	rc = 0;
-
 end:
-	ffvec_free(&in_list);
-	return rc;
+	ffvec_free(&names);
+	ffvec_free(&ents);
+	return b;
 }
 
-/**
-Note: all directories must be always included because user expects -I '*.txt' to work */
-static int cmd_input_allowed(fcom_cominfo *cmd, ffstr name, uint flags)
+#else // the file type is unknown
+
+static fntree_block* ftree_dirscan(ffstr path, fffd fd)
 {
-	int k = 1;
-	ffstr *it;
-	uint wcflags = FFS_WC_ICASE;
+	ffdirscan ds = {};
+	if (0 != ffdirscan_open(&ds, path.ptr, 0))
+		return NULL;
 
-	int isdir = (flags == FCOM_COM_IA_DIR);
-	if (flags == FCOM_COM_IA_AUTO && cmd->include.len) {
-		fffileinfo fi;
-		if (!fffile_info_path(name.ptr, &fi))
-			isdir = fffile_isdir(fffileinfo_attr(&fi));
+	fntree_block *b = fntree_create(path);
+	const char *fn;
+	while (NULL != (fn = ffdirscan_next(&ds))) {
+		if (NULL == ftree_add(&b, FFSTR_Z(fn), FCOM_COM_FT_UNKNOWN)) {
+			fntree_free_all(b);
+			b = NULL;
+			break;
+		}
 	}
+	ffdirscan_close(&ds);
+	return b;
+}
+
+#endif
+
+#define INPUT_NAMES_CHUNK  (64*1024)
+
+/** Start a new file tree for the next portion of names.
+The previous tree is kept because the caller may still use the base path returned from it. */
+static void ftree_next(struct cmd *c)
+{
+	fntree_free_all(c->ftree_prev);
+	c->ftree_prev = c->ftree;
+	ffstr path = {};
+	c->ftree = fntree_create(path);
+	ffmem_zero_obj(&c->ftree_cur);
+}
 
-	if (cmd->include.len != 0 && !isdir) {
-		k = 0;
-		FFSLICE_WALK(&cmd->include, it) {
-			if (0 == ffs_wildcard(it->ptr, it->len, name.ptr, name.len, wcflags)) {
-				dbglog("include: '%S' by '%S'", &name, it);
-				k = 1;
-				break;
+/** Read the next portion of names from input_fd into a new file tree.
+Return 0: added new names;
+ 1: no more names;
+ <0: error */
+static int input_names_read(struct cmd *c)
+{
+	fcom_cominfo *cmd = &c->cmd;
+	ffvec *buf = &c->names_buf;
+	uint n = 0;
+
+	for (;;) {
+		if (!c->names_eof) {
+			ffvec_grow(buf, INPUT_NAMES_CHUNK, 1);
+			ffssize r;
+			if (cmd->input_fd == ffstdin)
+				r = ffpipe_read(cmd->input_fd, ffslice_end(buf, 1), ffvec_unused(buf));
+			else
+				r = fffile_read(cmd->input_fd, ffslice_end(buf, 1), ffvec_unused(buf));
+			if (r < 0) {
+				syserrlog("input names file read");
+				return -1;
 			}
+			dbglog("input names file: read %L bytes", r);
+			if (r == 0)
+				c->names_eof = 1;
+			buf->len += r;
 		}
 
-		if (!k)
-			return 1;
-	}
+		ffstr view = FFSTR_INITSTR(buf);
+		while (view.len != 0) {
+			ffstr name;
+			ffssize pos = ffstr_findchar(&view, '\n');
+			if (pos < 0) {
+				if (!c->names_eof)
+					break; // incomplete line
+				pos = view.len;
+			}
+			ffstr_set(&name, view.ptr, pos);
+			ffstr_shift(&view, ffmin((ffsize)pos + 1, view.len));
+
+			ffstr_trimwhite(&name);
+			if (name.len == 0)
+				continue;
+
+			if (n == 0)
+				ftree_next(c);
+			if (NULL == ftree_add(&c->ftree, name, FCOM_COM_FT_UNKNOWN)) {
+				fcom_errlog("fntree_add");
+				return -1;
+			}
+			n++;
+		}
 
-	FFSLICE_WALK(&cmd->exclude, it) {
-		if (0 == ffs_wildcard(it->ptr, it->len, name.ptr, name.len, wcflags)) {
-			dbglog("exclude: '%S' by '%S'", &name, it);
-			k = 0;
+		// move the incomplete line to the beginning
+		ffmem_move(buf->ptr, view.ptr, view.len);
+		buf->len = view.len;
+
+		if (n != 0) {
+			dbglog("input names file: added %u names", n);
+			return 0;
+		}
+		if (c->names_eof)
 			break;
+	}
+
+	ffvec_free(buf);
+	if (cmd->input_fd != ffstdin)
+		fffile_close(cmd->input_fd);
+	cmd->input_fd = FFFILE_NULL;
+	return 1;
+}
+
+/** Compile include/exclude patterns */
+static void cmd_wc_compile(struct cmd *c)
+{
+	ffstr *it;
+	FFSLICE_WALK(&c->cmd.include, it) {
+		wcset_add(&c->include, *it);
+	}
+	FFSLICE_WALK(&c->cmd.exclude, it) {
+		wcset_add(&c->exclude, *it);
+	}
+	if (wcset_compile(&c->include)
+		|| wcset_compile(&c->exclude))
+		errlog("wildcard patterns: no memory");
+	c->wc_compiled = 1;
+}
+
+/**
+Note: all directories must be always included because user expects -I '*.txt' to work */
+static int cmd_input_allowed(fcom_cominfo *cmd, ffstr name, uint flags)
+{
+	struct cmd *c = FF_STRUCTPTR(struct cmd, cmd, cmd);
+	int i;
+
+	if (!c->wc_compiled)
+		cmd_wc_compile(c);
+
+	if (cmd->include.len != 0) {
+		if (0 <= (i = wcset_match(&c->include, name))) {
+			dbglog("include: '%S' by '%S'", &name, ffslice_itemT(&cmd->include, i, ffstr));
+
+		} else {
+			int isdir = (flags == FCOM_COM_IA_DIR);
+			if (flags == FCOM_COM_IA_AUTO) {
+				// the name isn't included: check if it's a directory
+				fffileinfo fi;
+				if (!fffile_info_path(name.ptr, &fi))
+					isdir = fffile_isdir(fffileinfo_attr(&fi));
+			}
+			if (!isdir)
+				return 1;
 		}
 	}
 
-	if (!k)
+	if (cmd->exclude.len != 0
+		&& 0 <= (i = wcset_match(&c->exclude, name))) {
+		dbglog("exclude: '%S' by '%S'", &name, ffslice_itemT(&cmd->exclude, i, ffstr));
 		return 2;
+	}
+
 	return 0;
 }
 
@@ -424,43 +605,28 @@ static int cmd_input_next(fcom_cominfo *cmd, ffstr *name, ffstr *ubase, uint fla
 		c->set_ftree = 1;
 		ffstr *it;
 		FFSLICE_WALK(&c->cmd.input, it) {
-			if (NULL == fntree_add(&c->ftree, *it, 0)) {
+			if (NULL == ftree_add(&c->ftree, *it, FCOM_COM_FT_UNKNOWN)) {
 				fcom_errlog("fntree_add: '%S'", it);
 				return FCOM_COM_RINPUT_ERR;
 			}
 		}
 	}
 
-	if (c->cmd.input_fd != FFFILE_NULL) {
-		if (0 != input_names_read(c))
-			return FCOM_COM_RINPUT_ERR;
-		if (cmd->input_fd != ffstdin) {
-			fffile_close(cmd->input_fd);
-		}
-		cmd->input_fd = FFFILE_NULL;
-	}
-
 	if (c->isdir) {
 		c->isdir = 0;
-		ffdirscan ds = {};
-		uint flags = 0;
+		fffd fd = c->ftree_dir;
+		c->ftree_dir = FFFILE_NULL;
 
-#ifdef FF_LINUX
-		if (c->ftree_dir != FFFILE_NULL) {
-			ds.fd = c->ftree_dir;
-			c->ftree_dir = FFFILE_NULL;
-			flags = FFDIRSCAN_USEFD;
-		}
-#endif
-
-		if (0 != ffdirscan_open(&ds, c->ftree_name.ptr, flags)) {
-			fcom_syserrlog("ffdirscan_open: %s", c->ftree_name.ptr);
+		fftime t;
+		fcom_stat_begin(&t);
+		ffstr path = FFSTR_INITZ(c->ftree_name.ptr);
+		fntree_block *b = ftree_dirscan(path, fd);
+		fcom_stat_end(FCOM_STAT_META, &t, 0);
+		if (b == NULL) {
+			fcom_syserrlog("directory scan: %s", c->ftree_name.ptr);
 			return FCOM_COM_RINPUT_ERR;
 		}
-		ffstr path = FFSTR_INITZ(c->ftree_name.ptr);
-		fntree_block *b = fntree_from_dirscan(path, &ds, 0);
 		fntree_attach((fntree_entry*)c->ftree_cur.cur, b);
-		ffdirscan_close(&ds);
 	}
 
 	fntree_block *b;
@@ -473,6 +639,14 @@ static int cmd_input_next(fcom_cominfo *cmd, ffstr *name, ffstr *ubase, uint fla
 		else
 			it = fntree_cur_next_r(&c->ftree_cur, &b);
 		if (it == NULL) {
+			if (cmd->input_fd != FFFILE_NULL) {
+				// get the next portion of names from "@FILE"
+				int r = input_names_read(c);
+				if (r < 0)
+					return FCOM_COM_RINPUT_ERR;
+				if (r == 0)
+					continue;
+			}
 			fcom_dbglog("no more input files");
 			return FCOM_COM_RINPUT_NOMORE;
 		}
@@ -494,15 +668,24 @@ static int cmd_input_next(fcom_cominfo *cmd, ffstr *name, ffstr *ubase, uint fla
 		ffvec_addfmt(&c->ftree_name, "%S%Z", &nm);
 
 		ffstr_set(name, c->ftree_name.ptr, c->ftree_name.len - 1);
+		c->ftree_type = *(u_char*)fntree_data(it);
 		break;
 	}
 
 	dbglog("input file name: '%S' / '%S'", name, &base);
+	if (core->stats)
+		core->stat_add(FCOM_STAT_FILES, 1);
 	if (ubase != NULL)
 		*ubase = base;
 	return FCOM_COM_RINPUT_OK;
 }
 
+static uint cmd_input_type(fcom_cominfo *cmd)
+{
+	struct cmd *c = FF_STRUCTPTR(struct cmd, cmd, cmd);
+	return c->ftree_type;
+}
+
 static void cmd_input_dir(fcom_cominfo *cmd, fffd dir)
 {
 	struct cmd *c = FF_STRUCTPTR(struct cmd, cmd, cmd);
@@ -599,6 +782,7 @@ static int cmd_args_parse(fcom_cominfo *cmd, const struct ffarg *args, void *obj
 	}
 
 	*cmd = *ucmd;
+	cmd_wc_compile(c);
 
 	if (cmd->help) {
 		const char *s = c->opif->help();
@@ -628,4 +812,5 @@ const struct fcom_command _fcom_com = {
 	cmd_destroy, cmd_complete,
 	cmd_input_next, cmd_input_dir, cmd_input_allowed,
 	cmd_args_parse,
+	cmd_input_type,
 };
@@ -8,6 +8,9 @@
 #include <ffsys/perf.h>
 #include <ffsys/globals.h>
 #include <ffsys/random.h>
+#ifdef FF_LINUX
+#include <sys/random.h>
+#endif
 
 #define syserrlog(fmt, ...)  core_log(FCOM_LOG_ERR | FCOM_LOG_SYSERR, "core: " fmt, ##__VA_ARGS__)
 #define errlog(fmt, ...)  core_log(FCOM_LOG_ERR, "core: " fmt, ##__VA_ARGS__)
@@ -17,6 +20,19 @@ fcom_core _fcom_core;
 fcom_core *core = &_fcom_core;
 extern void com_init();
 extern void com_destroy();
+extern uint workers_init(uint n);
+extern void workers_destroy();
+extern void core_job(fcom_job *j);
+extern void core_job_cancel(const void *owner);
+extern void stats_init();
+extern void stats_print(uint json);
+extern void core_stat_add(uint id, uint64 val);
+extern void core_stat_op(uint op, const fftime *t1, uint64 bytes);
+extern void bufpool_init(uint hugepages);
+extern void bufpool_destroy();
+extern void bufpool_stats();
+extern void keystream_init(fcom_keystream *ks, const void *seed);
+extern void keystream_fill(fcom_keystream *ks, void *buf, ffsize len);
 
 struct core {
 	struct fcom_core_conf conf;
@@ -73,8 +89,9 @@ static int core_kq_attach(fffd fd, fcom_kevent *kev, uint flags)
 static void core_task(fcom_task *t, fcom_task_func func, void *param)
 {
 	dbglog("task: %p %p %p", t, func, param);
-	fftaskqueue_post4(&gcore->taskq, t, func, param);
-	ffkq_post(gcore->kq_wake, &gcore->kq_wake_ev);
+	fftask_set(t, func, param);
+	if (fftaskqueue_post(&gcore->taskq, t))
+		ffkq_post(gcore->kq_wake, &gcore->kq_wake_ev); // the first task since the queue was processed
 }
 
 static void core_timer(fcom_timer *t, int interval_msec, fcom_task_func func, void *param)
@@ -110,6 +127,25 @@ static uint core_random()
 	return ffrand_get();
 }
 
+static void core_keystream_init(fcom_keystream *ks, const void *seed)
+{
+	uint k[8];
+	if (seed == NULL) {
+#ifdef FF_LINUX
+		if (sizeof(k) != getrandom(k, sizeof(k), 0))
+#endif
+		{
+			fftime now;
+			fftime_now(&now);
+			for (uint i = 0;  i != 8;  i++) {
+				k[i] = core_random() ^ (now.nsec + i);
+			}
+		}
+		seed = k;
+	}
+	keystream_init(ks, seed);
+}
+
 static void tasks_run(void *param)
 {
 	ffkq_post_consume(gcore->kq_wake);
@@ -145,6 +181,10 @@ static fcom_core* core_conf(struct fcom_core_conf *conf)
 	core->debug = conf->debug;
 	core->verbose = conf->debug | conf->verbose;
 	core->stdout_color = conf->stdout_color;
+	core->stats = conf->stats;
+	if (core->stats)
+		stats_init();
+	bufpool_init(conf->hugepages);
 
 	if (FFKQ_NULL == (gcore->kq = ffkq_create())) {
 		syserrlog("ffkq_create");
@@ -167,6 +207,7 @@ static fcom_core* core_conf(struct fcom_core_conf *conf)
 	fftimerqueue_init(&gcore->tq);
 	tmr_func(NULL);
 
+	core->workers = workers_init(conf->workers);
 	com_init();
 
 	return &_fcom_core;
@@ -212,6 +253,11 @@ static int core_run()
 		}
 	}
 
+	if (core->stats) {
+		bufpool_stats();
+		stats_print(gcore->conf.stats_json);
+	}
+
 	dbglog("exit worker thread: %u", gcore->exit_code);
 	return gcore->exit_code;
 }
@@ -231,11 +277,13 @@ static void core_destroy()
 	if (gcore == NULL)
 		return;
 
+	workers_destroy();
 	if (gcore->tmr != FFTIMER_NULL)
 		fftimer_close(gcore->tmr, gcore->kq);
 	if (gcore->kq != FFKQ_NULL)
 		ffkq_close(gcore->kq);
 	com_destroy();
+	bufpool_destroy();
 	ffmem_free(gcore->conf.app_path);
 	ffmem_free(gcore);  gcore = NULL;
 }
@@ -253,6 +301,13 @@ fcom_core _fcom_core = {
 	core_clock,
 	core_log, core_logv,
 	core_random,
+	core_keystream_init,
+	keystream_fill,
+	core_job,
+	core_job_cancel,
+	0,
+	core_stat_add,
+	core_stat_op,
 };
 
 FF_EXPORT const struct fcom_coreinit fcom_coreinit = {
@@ -13,6 +13,12 @@ fbuf_write
 #pragma once
 #include <ffbase/slice.h>
 
+/** The user may define a custom allocator */
+#ifndef FBUF_ALLOC
+	#define FBUF_ALLOC(size, align)  ffmem_align(size, align)
+	#define FBUF_FREE(ptr, size)  ffmem_alignfree(ptr)
+#endif
+
 // can cast to ffstr*
 struct fbuf {
 	ffsize len;
@@ -23,6 +29,7 @@ struct fbuf {
 struct fbufset {
 	ffslice bufs; // struct fbuf[]
 	ffuint idx;
+	ffuint bufsize;
 	struct {
 		ffuint64 hits, misses;
 	};
@@ -33,10 +40,11 @@ static inline int fbufset_init(struct fbufset *c, ffuint nbufs, ffuint bufsize,
 	if (NULL == ffslice_zallocT(&c->bufs, nbufs, struct fbuf))
 		return 1;
 	c->bufs.len = nbufs;
+	c->bufsize = bufsize;
 
 	struct fbuf *b;
 	FFSLICE_WALK(&c->bufs, b) {
-		if (NULL == (b->ptr = ffmem_align(bufsize, align)))
+		if (NULL == (b->ptr = FBUF_ALLOC(bufsize, align)))
 			return 1;
 		b->off = (ffuint64)-1;
 	}
@@ -47,7 +55,8 @@ static inline void fbufset_destroy(struct fbufset *c)
 {
 	struct fbuf *b;
 	FFSLICE_WALK(&c->bufs, b) {
-		ffmem_alignfree(b->ptr);
+		if (b->ptr != NULL)
+			FBUF_FREE(b->ptr, c->bufsize);
 	}
 	ffslice_free(&c->bufs);
 }
@@ -0,0 +1,66 @@
+/** fcom: core: fcom_file: copy data between files inside the kernel
+2026, Simon Zolin */
+
+/*
+copy(): the data is transferred from the input file to the output without passing through user space:
+ file -> file: copy_file_range() (the filesystem may even share the data blocks)
+ file -> pipe: splice()
+If the kernel can't do it for this pair of files, nothing is copied
+ and the caller writes the data from its buffer as usual.
+*/
+
+#ifdef FF_LINUX
+
+#include <fcntl.h>
+
+/** Return N of bytes copied;  <0: error */
+static ffssize fcopy_range(struct file *f, struct file *src, uint64 src_off, uint64 size, uint64 off)
+{
+	off_t in_off = src_off, out_off = off;
+	uint64 n = 0;
+	uint pipe = !!(f->open_flags & FCOM_FILE_STDOUT);
+
+	while (n != size) {
+		ffsize len = ffmin(size - n, 1*1024*1024*1024);
+		ffssize r;
+		if (pipe)
+			r = splice(src->fd, &in_off, f->fd, NULL, len, SPLICE_F_MORE);
+		else if (f->open_flags & FCOM_FILE_STDOUT)
+			r = copy_file_range(src->fd, &in_off, f->fd, NULL, len, 0); // stdout is redirected to a file
+		else
+			r = copy_file_range(src->fd, &in_off, f->fd, &out_off, len, 0);
+
+		if (r < 0) {
+			int e = errno;
+			if (e == EINTR)
+				continue;
+			if (n == 0 && pipe && e == EINVAL) {
+				pipe = 0; // stdout isn't a pipe
+				continue;
+			}
+			if (n != 0 || e == EAGAIN
+				|| e == EINVAL || e == EXDEV || e == ENOSYS || e == EOPNOTSUPP
+				|| e == EBADF || e == ESPIPE)
+				break; // the rest is written by the caller
+			fcom_syserrlog("file copy: %s -> %s %U @%U"
+				, src->name, f->name, size - n, off + n);
+			return -1;
+		}
+		if (r == 0)
+			break; // the input file was truncated
+		n += r;
+	}
+
+	fcom_dbglog("%s: copied %U @%U from %s @%U"
+		, f->name, n, off, src->name, src_off);
+	return n;
+}
+
+#else
+
+static ffssize fcopy_range(struct file *f, struct file *src, uint64 src_off, uint64 size, uint64 off)
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,180 @@
+/** fcom: core: fcom_file: read data via memory-mapped views
+2026, Simon Zolin */
+
+/*
+FCOM_FILE_MMAP: read() returns a pointer into the mapped file region instead of copying data into a buffer.
+A file <=MMAP_WHOLE_MAX is mapped entirely;
+ larger files are mapped by windows of MMAP_WINDOW bytes.
+The 2 most recent views are kept mapped,
+ so the data returned by the previous read() remains valid (as with 2+ buffers).
+FCOM_FBEH_SEQ, FCOM_FBEH_RANDOM set madvise() hints for the views.
+Stdin, direct I/O and empty files fall back to the buffered reading.
+
+Limits:
+* read() returns the whole view at once: up to MMAP_WHOLE_MAX (1GB on 64-bit) for a small file,
+  or MMAP_WINDOW bytes for a larger one.
+  The user that processes data by small portions must limit it by itself (e.g. `hex`).
+* The views are MAP_SHARED: if the file is truncated by another process while mapped,
+  access to the pages beyond the new end of file raises SIGBUS.
+  The file size is re-checked before mapping each view,
+  and if the file has shrunk, reading falls back to pread() from that point,
+  but the views returned before can't be protected.
+*/
+
+#define FMAP_FALLBACK  (-100) // fmap_read(): use buffered reading
+
+#ifdef FF_UNIX
+
+#include <sys/mman.h>
+
+#define MMAP_WHOLE_MAX  ((sizeof(void*) == 8) ? 1024*1024*1024ULL : 64*1024*1024ULL)
+#define MMAP_WINDOW  ((sizeof(void*) == 8) ? 64*1024*1024ULL : 16*1024*1024ULL)
+#define MMAP_ALIGN  (64*1024)
+#define FMAP_SHRUNK  ((struct fmap_view*)-1)
+
+static void fmap_unview(struct fmap_view *v)
+{
+	if (v->ptr == NULL)
+		return;
+	munmap(v->ptr, v->len);
+	v->ptr = NULL;
+	v->len = 0;
+}
+
+static void fmap_close(struct file *f)
+{
+	fmap_unview(&f->map.cur);
+	fmap_unview(&f->map.prev);
+	f->map.active = 0;
+	f->map.advice = 0;
+}
+
+/** Prepare for mapped reading.
+Return 0 if the file can be mapped */
+static int fmap_open(struct file *f)
+{
+	if (f->open_flags & (FCOM_FILE_STDIN | FCOM_FILE_DIRECTIO | FCOM_FILE_WRITE | FCOM_FILE_READWRITE))
+		goto fail;
+
+	fffileinfo fi;
+	if (0 != fffile_info(f->fd, &fi)
+		|| fffile_isdir(fffileinfo_attr(&fi))
+		|| fffileinfo_size(&fi) == 0)
+		goto fail;
+
+	f->size = fffileinfo_size(&fi);
+	f->map.active = 1;
+	fcom_dbglog("%s: mmap: size:%U", f->name, f->size);
+	return 0;
+
+fail:
+	f->open_flags &= ~FCOM_FILE_MMAP;
+	return -1;
+}
+
+static void fmap_advise(struct file *f, int advice)
+{
+	f->map.advice = advice;
+	if (f->map.cur.ptr != NULL)
+		madvise(f->map.cur.ptr, f->map.cur.len, advice);
+	if (f->map.prev.ptr != NULL)
+		madvise(f->map.prev.ptr, f->map.prev.len, advice);
+}
+
+/** Map the region containing `off`.
+Return NULL on error;  FMAP_SHRUNK: the file has shrunk */
+static struct fmap_view* fmap_view(struct file *f, uint64 off)
+{
+	fffileinfo fi;
+	if (0 != fffile_info(f->fd, &fi)) {
+		fcom_syserrlog("file info: %s", f->name);
+		return NULL;
+	}
+	if (fffileinfo_size(&fi) < f->size) {
+		fcom_warnlog("%s: file has shrunk while reading: %U -> %U"
+			, f->name, f->size, fffileinfo_size(&fi));
+		return FMAP_SHRUNK;
+	}
+
+	uint64 woff = 0, wlen = f->size;
+	if (f->size > MMAP_WHOLE_MAX) {
+		woff = ffint_align_floor2(off, MMAP_ALIGN);
+		wlen = ffmin(MMAP_WINDOW, f->size - woff);
+	}
+
+	fftime t;
+	fcom_stat_begin(&t);
+	void *p = mmap(NULL, wlen, PROT_READ, MAP_SHARED, f->fd, woff);
+	fcom_stat_end(FCOM_STAT_META, &t, 0);
+	if (p == MAP_FAILED) {
+		fcom_syserrlog("mmap: %s %U @%U", f->name, wlen, woff);
+		return NULL;
+	}
+	if (f->map.advice != 0)
+		madvise(p, wlen, f->map.advice);
+	fcom_dbglog("%s: mmap: %U @%U", f->name, wlen, woff);
+
+	fmap_unview(&f->map.prev);
+	f->map.prev = f->map.cur;
+	f->map.cur.ptr = p;
+	f->map.cur.off = woff;
+	f->map.cur.len = wlen;
+	return &f->map.cur;
+}
+
+/**
+Return enum FCOM_FILE_RET or FMAP_FALLBACK */
+static int fmap_read(struct file *f, ffstr *d, uint64 off)
+{
+	if (off >= f->size) {
+		d->len = 0;
+		f->cur_off = off;
+		return FCOM_FILE_EOF;
+	}
+
+	fftime t;
+	fcom_stat_begin(&t);
+
+	struct fmap_view *v = &f->map.cur;
+	if (!(v->ptr != NULL && off >= v->off && off < v->off + v->len)) {
+		v = &f->map.prev;
+		if (!(v->ptr != NULL && off >= v->off && off < v->off + v->len)) {
+			if (NULL == (v = fmap_view(f, off)))
+				return FCOM_FILE_ERR;
+			if (v == FMAP_SHRUNK) {
+				// Keep the current views mapped: the user may still reference the data returned before
+				f->map.active = 0;
+				f->open_flags &= ~FCOM_FILE_MMAP;
+				return FMAP_FALLBACK;
+			}
+		}
+	}
+
+	ffstr_set(d, v->ptr + (off - v->off), v->len - (off - v->off));
+	f->cur_off = off + d->len;
+	f->stats.total_read += d->len;
+	fcom_stat_end(FCOM_STAT_READ, &t, d->len);
+	return FCOM_FILE_OK;
+}
+
+#else // no mmap support: always fall back to buffered reading
+
+static void fmap_close(struct file *f) {}
+
+static int fmap_open(struct file *f)
+{
+	f->open_flags &= ~FCOM_FILE_MMAP;
+	return -1;
+}
+
+static void fmap_advise(struct file *f, int advice) {}
+
+static int fmap_read(struct file *f, ffstr *d, uint64 off)
+{
+	return FCOM_FILE_ERR;
+}
+
+#define MADV_SEQUENTIAL  0
+#define MADV_RANDOM  0
+
+#endif
@@ -2,6 +2,10 @@
 2022, Simon Zolin */
 
 #include <fcom.h>
+extern void* bufpool_alloc(ffsize size);
+extern void bufpool_free(void *p, ffsize size);
+#define FBUF_ALLOC(size, align)  bufpool_alloc(size)
+#define FBUF_FREE(ptr, size)  bufpool_free(ptr, size)
 #include <core/fbuf.h>
 #include <ffsys/std.h>
 #include <ffsys/dir.h>
@@ -11,11 +15,18 @@
 extern fcom_core *core;
 #define ALIGN (4*1024)
 
+struct fmap_view {
+	char *ptr;
+	uint64 off;
+	ffsize len;
+};
+
 struct file {
 	char *name;
 	fffd fd;
 	uint open_flags;
 	uint buffer_size;
+	uint buffer_cap; // allocated size of each buffer
 	fftime mtime;
 	fffd fd_stdin, fd_stdout;
 
@@ -43,8 +54,17 @@ struct file {
 		fftime t_read, t_write;
 		uint64 total_read, total_write;
 	} stats;
+
+	struct {
+		struct fmap_view cur, prev;
+		int advice; // madvise() flag for new views
+		uint active :1;
+	} map;
 };
 
+#include <core/file-map.h>
+#include <core/file-copy.h>
+
 static int f_write(struct file *f, ffstr d, uint64 off);
 static int file_flush(fcom_file_obj *_f, uint flags);
 static int file_trunc(fcom_file_obj *_f, int64 size);
@@ -67,8 +87,9 @@ static fcom_file_obj* file_create(struct fcom_file_conf *conf)
 		f->fd_stdout = conf->fd_stdout;
 
 	f->buffer_size = ffmax(f->buffer_size, ALIGN);
-	fbufset_init(&f->bufset, conf->n_buffers, f->buffer_size, ALIGN);
-	f->wcache.buf.ptr = ffmem_align(f->buffer_size, ALIGN);
+	f->buffer_cap = f->buffer_size;
+	fbufset_init(&f->bufset, conf->n_buffers, f->buffer_cap, ALIGN);
+	f->wcache.buf.ptr = bufpool_alloc(f->buffer_cap);
 	return f;
 }
 
@@ -80,13 +101,17 @@ static void mtime_set(struct file *f)
 
 	fftime time1970 = f->mtime;
 	time1970.sec -= FFTIME_1970_SECONDS;
-	if (0 != fffile_set_mtime(f->fd, &time1970)) {
+	fftime t;
+	fcom_stat_begin(&t);
+	int r = fffile_set_mtime(f->fd, &time1970);
+	fcom_stat_end(FCOM_STAT_META, &t, 0);
+	if (r != 0) {
 		fcom_syswarnlog("file set mtime: %s", f->name);
 	} else if (core->debug) {
 		char buf[128];
 		ffdatetime dt;
 		fftime_split1(&dt, &f->mtime);
-		int r = fftime_tostr1(&dt, buf, sizeof(buf), FFTIME_YMD);
+		r = fftime_tostr1(&dt, buf, sizeof(buf), FFTIME_YMD);
 		buf[r] = '\0';
 		fcom_dbglog("%s: mtime: %s", f->name, buf);
 	}
@@ -125,6 +150,7 @@ end:
 static void file_close(fcom_file_obj *_f)
 {
 	struct file *f = _f;
+	fmap_close(f);
 	if (f->fd != FFFILE_NULL) {
 
 		if (f->open_flags & (FCOM_FILE_WRITE | FCOM_FILE_READWRITE)) {
@@ -135,7 +161,11 @@ static void file_close(fcom_file_obj *_f)
 		}
 
 		if (!(f->open_flags & (FCOM_FILE_STDIN | FCOM_FILE_STDOUT))) {
-			if (0 != fffile_close(f->fd)) {
+			fftime t;
+			fcom_stat_begin(&t);
+			int r = fffile_close(f->fd);
+			fcom_stat_end(FCOM_STAT_META, &t, 0);
+			if (0 != r) {
 				fcom_syserrlog("%s: fffile_close", f->name);
 			} else {
 				if (f->open_flags & (FCOM_FILE_WRITE | FCOM_FILE_READWRITE)) {
@@ -157,6 +187,12 @@ static void file_close(fcom_file_obj *_f)
 		f->fd = FFFILE_NULL;
 	}
 
+	if (core->stats) {
+		core->stat_add(FCOM_STAT_CACHE_HITS, f->bufset.hits);
+		core->stat_add(FCOM_STAT_CACHE_MISSES, f->bufset.misses);
+	}
+	f->bufset.hits = f->bufset.misses = 0;
+
 	ffmem_free(f->name); f->name = NULL;
 }
 
@@ -167,7 +203,7 @@ static void file_destroy(fcom_file_obj *_f)
 		return;
 
 	file_close(f);
-	ffmem_alignfree(f->wcache.buf.ptr);
+	bufpool_free(f->wcache.buf.ptr, f->buffer_cap);
 	fbufset_destroy(&f->bufset);
 	ffmem_free(f->name);
 	ffmem_free(f);
@@ -233,7 +269,11 @@ static int file_open(fcom_file_obj *_f, const char *name, uint how)
 	flags |= FFFILE_NOATIME;
 
 	for (uint i = 0;  ;  i++) {
-		if (FFFILE_NULL == (f->fd = fffile_open(f->name, flags))) {
+		fftime t;
+		fcom_stat_begin(&t);
+		f->fd = fffile_open(f->name, flags);
+		fcom_stat_end(FCOM_STAT_META, &t, 0);
+		if (FFFILE_NULL == f->fd) {
 
 #ifdef FF_UNIX
 			if (fferr_last() == EINVAL && (flags & FFFILE_DIRECT)) {
@@ -277,7 +317,7 @@ static int file_open(fcom_file_obj *_f, const char *name, uint how)
 
 static int f_benchmark(fftime *t)
 {
-	if (core->verbose) {
+	if (core->verbose || core->stats) {
 		*t = fftime_monotonic();
 		return 1;
 	}
@@ -292,6 +332,14 @@ static int file_read(fcom_file_obj *_f, ffstr *d, int64 off)
 	if (off == -1)
 		off = f->cur_off;
 
+	if (f->open_flags & FCOM_FILE_MMAP) {
+		if (f->map.active || 0 == fmap_open(f)) {
+			int r = fmap_read(f, d, off);
+			if (r != FMAP_FALLBACK)
+				return r;
+		}
+	}
+
 	if (NULL != (b = fbufset_find(&f->bufset, off))) {
 		fcom_dbglog("%s: @%U: cache hit: %L @%U", f->name, off, b->len, b->off);
 		goto done;
@@ -324,10 +372,12 @@ static int file_read(fcom_file_obj *_f, ffstr *d, int64 off)
 		return FCOM_FILE_ERR;
 	}
 
+	if (core->stats)
+		core->stat_op(FCOM_STAT_READ, &t1, r);
 	if (f_benchmark(&t2)) {
 		fftime_sub(&t2, &t1);
 		fftime_add(&f->stats.t_read, &t2);
-		f->stats.total_read += b->len;
+		f->stats.total_read += r;
 	}
 
 	if (r < f->buffer_size)
@@ -385,6 +435,8 @@ static int f_write(struct file *f, ffstr d, uint64 off)
 		return -FCOM_FILE_ERR;
 	}
 
+	if (core->stats)
+		core->stat_op(FCOM_STAT_WRITE, &t1, r);
 	if (f_benchmark(&t2)) {
 		fftime_sub(&t2, &t1);
 		fftime_add(&f->stats.t_write, &t2);
@@ -536,6 +588,48 @@ static int file_write_fmt(fcom_file_obj *_f, const char *fmt, ...)
 	return r;
 }
 
+static ffssize file_copy(fcom_file_obj *_f, fcom_file_obj *_src, uint64 src_off, uint64 size, int64 off)
+{
+	struct file *f = _f, *src = _src;
+	if (f->open_flags & FCOM_FILE_FAKEWRITE)
+		return size;
+
+	if ((f->open_flags | src->open_flags) & FCOM_FILE_DIRECTIO
+		|| f->w.async)
+		return 0;
+
+	// the cached data goes before the copied data
+	if (0 != file_flush(f, 0))
+		return -1;
+
+	if (off == -1)
+		off = f->cur_off;
+	if ((f->open_flags & FCOM_FILE_STDOUT) && (uint64)off != f->size) {
+		fcom_errlog("detected seeking attempt on output stream: %U  fsize:%U", off, f->size);
+		return -1;
+	}
+
+	fftime t1, t2 = {};
+	f_benchmark(&t1);
+
+	ffssize r = fcopy_range(f, src, src_off, size, off);
+	if (r <= 0)
+		return r;
+
+	if (core->stats)
+		core->stat_op(FCOM_STAT_WRITE, &t1, r);
+	if (f_benchmark(&t2)) {
+		fftime_sub(&t2, &t1);
+		fftime_add(&f->stats.t_write, &t2);
+		f->stats.total_write += r;
+	}
+
+	f->cur_off = off + r;
+	if (f->cur_off > f->size)
+		f->size = f->cur_off;
+	return r;
+}
+
 static int file_trunc(fcom_file_obj *_f, int64 size)
 {
 	struct file *f = _f;
@@ -561,12 +655,14 @@ static int file_behaviour(fcom_file_obj *_f, uint flags)
 		f->size = fffile_size(f->fd);
 		if (0 != fffile_readahead(f->fd, f->size))
 			fcom_dbglog("file read ahead: %E", fferr_last());
+		fmap_advise(f, MADV_SEQUENTIAL);
 		break;
 
 	case FCOM_FBEH_RANDOM:
 		fcom_dbglog("%s: random access", f->name);
 		if (0 != fffile_readahead(f->fd, -1))
 			fcom_dbglog("file read ahead: %E", fferr_last());
+		fmap_advise(f, MADV_RANDOM);
 		break;
 
 	case FCOM_FBEH_TRUNC_PREALLOC:
@@ -596,15 +692,16 @@ static int file_info(fcom_file_obj *_f, fffileinfo *fi)
 		return 0;
 	}
 
-	if (f->open_flags & FCOM_FILE_INFO_NOFOLLOW) {
-		if (0 != fffile_info_linkpath(f->name, fi)) {
-			fcom_syserrlog("file get info: %s", f->name);
-			return FCOM_FILE_ERR;
-		}
-		return 0;
-	}
+	fftime t;
+	fcom_stat_begin(&t);
+	int r;
+	if (f->open_flags & FCOM_FILE_INFO_NOFOLLOW)
+		r = fffile_info_linkpath(f->name, fi);
+	else
+		r = fffile_info(f->fd, fi);
+	fcom_stat_end(FCOM_STAT_META, &t, 0);
 
-	if (0 != fffile_info(f->fd, fi)) {
+	if (r != 0) {
 		fcom_syserrlog("file get info: %s", f->name);
 		return FCOM_FILE_ERR;
 	}
@@ -638,7 +735,10 @@ static int file_attr_set(fcom_file_obj *_f, uint attr)
 
 static int dir_create(const char *name, uint flags)
 {
+	fftime t;
+	fcom_stat_begin(&t);
 	int r = ffdir_make(name);
+	fcom_stat_end(FCOM_STAT_META, &t, 0);
 	if (r) {
 		if (fferr_exist(fferr_last())) {
 			fcom_dbglog("%s: directory already exists", name);
@@ -713,7 +813,10 @@ static int file_move(ffstr old, ffstr _new, uint flags)
 		}
 	}
 
+	fftime t;
+	fcom_stat_begin(&t);
 	int r = fffile_rename(src, dst);
+	fcom_stat_end(FCOM_STAT_META, &t, 0);
 	if (r != 0 && fferr_notexist(fferr_last())) {
 		if (0 != ffdir_make_path(dst, 0)) {
 			fcom_syserrlog("ffdir_make_path: for filename %s", dst);
@@ -737,7 +840,11 @@ end:
 
 static int file_delete(const char *name, uint flags)
 {
-	if (0 != fffile_remove(name)) {
+	fftime t;
+	fcom_stat_begin(&t);
+	int r = fffile_remove(name);
+	fcom_stat_end(FCOM_STAT_META, &t, 0);
+	if (r != 0) {
 		fcom_syserrlog("file delete: %s", name);
 		return -1;
 	}
@@ -759,4 +866,5 @@ const fcom_file _fcom_file = {
 	hlink_create, slink_create,
 	file_move,
 	file_delete,
+	file_copy,
 };
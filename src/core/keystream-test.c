@@ -0,0 +1,143 @@
+/** fcom: keystream: known-answer test; compare SIMD paths with the portable implementation
+2026, Simon Zolin */
+
+#include <core/keystream.c>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static const char* simd_name(uint simd)
+{
+	static const char names[][8] = { "none", "SSE2", "AVX2" };
+	return names[simd];
+}
+
+static void hex_parse(const char *s, u_char *out)
+{
+	for (uint i = 0;  s[i*2] != '\0';  i++) {
+		uint v;
+		sscanf(s + i*2, "%2x", &v);
+		out[i] = v;
+	}
+}
+
+/* RFC 7539: 2.3.2, A.1 */
+static const struct {
+	u_char key_last; // key: 00..00XX
+	u_char key_seq; // key: 00 01 .. 1f
+	uint counter;
+	uint nonce[3];
+	const char *block;
+} kat[] = {
+	{ 0, 0, 0, { 0, 0, 0 },
+		"76b8e0ada0f13d90405d6ae55386bd28bdd219b8a08ded1aa836efcc8b770dc7"
+		"da41597c5157488d7724e03fb8d84a376a43b8f41518a11cc387b669b2ee6586" },
+	{ 0, 0, 1, { 0, 0, 0 },
+		"9f07e7be5551387a98ba977c732d080dcb0f29a048e3656912c6533e32ee7aed"
+		"29b721769ce64e43d57133b074d839d531ed1f28510afb45ace10a1f4b794d6f" },
+	{ 1, 0, 1, { 0, 0, 0 },
+		"3aeb5224ecf849929b9d828db1ced4dd832025e8018b8160b82284f3c949aa5a"
+		"8eca00bbb4a73bdad192b5c42f73f2fd4e273644c8b36125a64addeb006c13a0" },
+	{ 0, 1, 1, { 0x09000000, 0x4a000000, 0 },
+		"10f1e7e4d13b5915500fdd1fa32071c4c7d1f4c733c068030422aa9ac3d46c4e"
+		"d2826446079faa0914c2d705d98b02a2b5129cd1de164eb9cbd083e8a2503c4e" },
+};
+
+/** Compute the block for each test vector.
+RFC 7539 uses a 32-bit counter and 96-bit nonce: state[13..15] = nonce */
+static int test_kat(uint simd)
+{
+	for (uint i = 0;  i != FF_COUNT(kat);  i++) {
+		u_char key[32] = {}, expect[64], out[8*64];
+		key[31] = kat[i].key_last;
+		if (kat[i].key_seq) {
+			for (uint j = 0;  j != 32;  j++) {
+				key[j] = j;
+			}
+		}
+		hex_parse(kat[i].block, expect);
+
+		fcom_keystream ks;
+		keystream_init(&ks, key);
+		ks_simd = simd;
+		ks.state[12] = kat[i].counter;
+		ks.state[13] = kat[i].nonce[0];
+		ks.state[14] = kat[i].nonce[1];
+		ks.state[15] = kat[i].nonce[2];
+		keystream_fill(&ks, out, sizeof(out)); // the SIMD paths compute 4 or 8 blocks at once
+		if (memcmp(out, expect, 64)) {
+			printf("FAIL: %s: test vector #%u\n", simd_name(simd), i);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+#define STREAM_SIZE  (64*1024 + 7)
+
+/** Fill the buffer by the portions of different size */
+static void fill_by_parts(uint simd, const u_char *key, uint counter_lo, u_char *out, uint seed)
+{
+	static const uint sizes[] = { 1, 3, 63, 64, 65, 127, 255, 256, 257, 511, 512, 513, 1000, 4096 };
+	fcom_keystream ks;
+	keystream_init(&ks, key);
+	ks_simd = simd;
+	ks.state[12] = counter_lo;
+
+	srand(seed);
+	for (uint off = 0;  off != STREAM_SIZE;  ) {
+		uint n = sizes[rand() % FF_COUNT(sizes)];
+		n = ffmin(n, STREAM_SIZE - off);
+		keystream_fill(&ks, out + off, n);
+		off += n;
+	}
+}
+
+/** Compare the stream with the one produced by the portable code by 1 call */
+static int test_stream(uint simd, const u_char *key, uint counter_lo, const u_char *ref, u_char *out)
+{
+	for (uint seed = 1;  seed != 5;  seed++) {
+		memset(out, 0xcc, STREAM_SIZE);
+		fill_by_parts(simd, key, counter_lo, out, seed);
+		if (memcmp(out, ref, STREAM_SIZE)) {
+			printf("FAIL: %s: counter:%#x seed:%u\n", simd_name(simd), counter_lo, seed);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int main()
+{
+	u_char key[32];
+	u_char *ref = malloc(STREAM_SIZE), *out = malloc(STREAM_SIZE);
+	int rc = 0;
+
+	for (uint i = 0;  i != 32;  i++) {
+		key[i] = i * 7 + 1;
+	}
+
+	uint best = ks_simd_detect();
+	// the initial counter values: 0; the low 32 bits overflow inside the stream
+	static const uint counters[] = { 0, 0xfffffff0 };
+	for (uint c = 0;  c != FF_COUNT(counters);  c++) {
+		fcom_keystream ks;
+		keystream_init(&ks, key);
+		ks_simd = KS_SIMD_NONE;
+		ks.state[12] = counters[c];
+		keystream_fill(&ks, ref, STREAM_SIZE);
+
+		for (uint simd = KS_SIMD_NONE;  simd <= best;  simd++) {
+			rc |= test_stream(simd, key, counters[c], ref, out);
+		}
+	}
+
+	for (uint simd = KS_SIMD_NONE;  simd <= best;  simd++) {
+		rc |= test_kat(simd);
+		printf("%s: checked\n", simd_name(simd));
+	}
+
+	free(ref);
+	free(out);
+	return rc;
+}
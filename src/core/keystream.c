@@ -0,0 +1,249 @@
+/** fcom: core: keystream generator
+2026, Simon Zolin */
+
+/*
+The keystream is ChaCha20 (20 rounds, 64-bit block counter, zero nonce) for the 256-bit seed.
+Each 64-byte block depends only on the seed and its number,
+ so several blocks are computed at once, one block per 32-bit lane:
+ x86 SSE2: 4 blocks, AVX2: 8 blocks;
+ the rest is computed by the portable code.
+The unused part of the last block is kept for the next call.
+*/
+
+#include <fcom.h>
+#if defined __x86_64__ || defined __i386__
+	#include <immintrin.h>
+	#define KS_SIMD_X86
+#endif
+
+enum KS_SIMD {
+	KS_SIMD_NONE,
+	KS_SIMD_SSE2,
+	KS_SIMD_AVX2,
+};
+static uint ks_simd = ~0U;
+
+#define KS_ROTL(v, n)  (((v) << (n)) | ((v) >> (32 - (n))))
+#define KS_QR(a, b, c, d) \
+	a += b;  d ^= a;  d = KS_ROTL(d, 16); \
+	c += d;  b ^= c;  b = KS_ROTL(b, 12); \
+	a += b;  d ^= a;  d = KS_ROTL(d, 8); \
+	c += d;  b ^= c;  b = KS_ROTL(b, 7)
+
+static void ks_block(const uint *in, u_char *out)
+{
+	uint x[16];
+	ffmem_copy(x, in, sizeof(x));
+
+	for (uint i = 0;  i != 10;  i++) {
+		KS_QR(x[0], x[4], x[8], x[12]);
+		KS_QR(x[1], x[5], x[9], x[13]);
+		KS_QR(x[2], x[6], x[10], x[14]);
+		KS_QR(x[3], x[7], x[11], x[15]);
+		KS_QR(x[0], x[5], x[10], x[15]);
+		KS_QR(x[1], x[6], x[11], x[12]);
+		KS_QR(x[2], x[7], x[8], x[13]);
+		KS_QR(x[3], x[4], x[9], x[14]);
+	}
+
+	for (uint i = 0;  i != 16;  i++) {
+		uint v = x[i] + in[i];
+		out[i*4] = v;
+		out[i*4 + 1] = v >> 8;
+		out[i*4 + 2] = v >> 16;
+		out[i*4 + 3] = v >> 24;
+	}
+}
+
+static inline void ks_counter_add(uint *st, uint n)
+{
+	uint64 c = st[12] | ((uint64)st[13] << 32);
+	c += n;
+	st[12] = (uint)c;
+	st[13] = (uint)(c >> 32);
+}
+
+#ifdef KS_SIMD_X86
+
+/* The same round function for 4 or 8 lanes */
+#define KS_VROUNDS(T, add, xor, rotl) \
+	for (uint i = 0;  i != 10;  i++) { \
+		KS_VQR(T, add, xor, rotl, x[0], x[4], x[8], x[12]); \
+		KS_VQR(T, add, xor, rotl, x[1], x[5], x[9], x[13]); \
+		KS_VQR(T, add, xor, rotl, x[2], x[6], x[10], x[14]); \
+		KS_VQR(T, add, xor, rotl, x[3], x[7], x[11], x[15]); \
+		KS_VQR(T, add, xor, rotl, x[0], x[5], x[10], x[15]); \
+		KS_VQR(T, add, xor, rotl, x[1], x[6], x[11], x[12]); \
+		KS_VQR(T, add, xor, rotl, x[2], x[7], x[8], x[13]); \
+		KS_VQR(T, add, xor, rotl, x[3], x[4], x[9], x[14]); \
+	}
+#define KS_VQR(T, add, xor, rotl, a, b, c, d) \
+	a = add(a, b);  d = rotl(xor(d, a), 16); \
+	c = add(c, d);  b = rotl(xor(b, c), 12); \
+	a = add(a, b);  d = rotl(xor(d, a), 8); \
+	c = add(c, d);  b = rotl(xor(b, c), 7)
+
+/* Transpose 4x4 32-bit words in each 128-bit lane: r[j] = (a[j], b[j], c[j], d[j]) */
+#define KS_TRANSPOSE(sfx, a, b, c, d, r) \
+do { \
+	T t0 = _mm##sfx##_unpacklo_epi32(a, b); \
+	T t1 = _mm##sfx##_unpacklo_epi32(c, d); \
+	T t2 = _mm##sfx##_unpackhi_epi32(a, b); \
+	T t3 = _mm##sfx##_unpackhi_epi32(c, d); \
+	r[0] = _mm##sfx##_unpacklo_epi64(t0, t1); \
+	r[1] = _mm##sfx##_unpackhi_epi64(t0, t1); \
+	r[2] = _mm##sfx##_unpacklo_epi64(t2, t3); \
+	r[3] = _mm##sfx##_unpackhi_epi64(t2, t3); \
+} while (0)
+
+__attribute__((target("sse2")))
+static inline __m128i ks_rotl_sse2(__m128i v, int n)
+{
+	return _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - n));
+}
+
+/** Compute 4 blocks */
+__attribute__((target("sse2")))
+static void ks_block4_sse2(const uint *in, u_char *out)
+{
+	typedef __m128i T;
+	T x[16], s[16];
+	uint64 c = in[12] | ((uint64)in[13] << 32);
+	for (uint i = 0;  i != 16;  i++) {
+		s[i] = _mm_set1_epi32(in[i]);
+	}
+	s[12] = _mm_setr_epi32(c, c + 1, c + 2, c + 3);
+	s[13] = _mm_setr_epi32((c) >> 32, (c + 1) >> 32, (c + 2) >> 32, (c + 3) >> 32);
+	ffmem_copy(x, s, sizeof(x));
+
+	KS_VROUNDS(T, _mm_add_epi32, _mm_xor_si128, ks_rotl_sse2);
+
+	for (uint i = 0;  i != 16;  i++) {
+		x[i] = _mm_add_epi32(x[i], s[i]);
+	}
+
+	for (uint i = 0;  i != 16;  i += 4) {
+		T r[4];
+		KS_TRANSPOSE(, x[i], x[i + 1], x[i + 2], x[i + 3], r);
+		for (uint j = 0;  j != 4;  j++) {
+			_mm_storeu_si128((T*)(out + j*64 + i*4), r[j]);
+		}
+	}
+}
+
+__attribute__((target("avx2")))
+static inline __m256i ks_rotl_avx2(__m256i v, int n)
+{
+	return _mm256_or_si256(_mm256_slli_epi32(v, n), _mm256_srli_epi32(v, 32 - n));
+}
+
+/** Compute 8 blocks.
+After the transposition the low 128-bit lane holds block J, the high lane - block J+4. */
+__attribute__((target("avx2")))
+static void ks_block8_avx2(const uint *in, u_char *out)
+{
+	typedef __m256i T;
+	T x[16], s[16];
+	uint64 c = in[12] | ((uint64)in[13] << 32);
+	for (uint i = 0;  i != 16;  i++) {
+		s[i] = _mm256_set1_epi32(in[i]);
+	}
+	s[12] = _mm256_setr_epi32(c, c + 1, c + 2, c + 3, c + 4, c + 5, c + 6, c + 7);
+	s[13] = _mm256_setr_epi32((c) >> 32, (c + 1) >> 32, (c + 2) >> 32, (c + 3) >> 32
+		, (c + 4) >> 32, (c + 5) >> 32, (c + 6) >> 32, (c + 7) >> 32);
+	ffmem_copy(x, s, sizeof(x));
+
+	KS_VROUNDS(T, _mm256_add_epi32, _mm256_xor_si256, ks_rotl_avx2);
+
+	for (uint i = 0;  i != 16;  i++) {
+		x[i] = _mm256_add_epi32(x[i], s[i]);
+	}
+
+	for (uint i = 0;  i != 16;  i += 4) {
+		T r[4];
+		KS_TRANSPOSE(256, x[i], x[i + 1], x[i + 2], x[i + 3], r);
+		for (uint j = 0;  j != 4;  j++) {
+			_mm_storeu_si128((__m128i*)(out + j*64 + i*4), _mm256_castsi256_si128(r[j]));
+			_mm_storeu_si128((__m128i*)(out + (j + 4)*64 + i*4), _mm256_extracti128_si256(r[j], 1));
+		}
+	}
+}
+
+#undef KS_VROUNDS
+#undef KS_VQR
+#undef KS_TRANSPOSE
+
+#endif // KS_SIMD_X86
+
+static uint ks_simd_detect()
+{
+#ifdef KS_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return KS_SIMD_AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return KS_SIMD_SSE2;
+#endif
+	return KS_SIMD_NONE;
+}
+
+void keystream_init(fcom_keystream *ks, const void *seed)
+{
+	if (ks_simd == ~0U)
+		ks_simd = ks_simd_detect();
+
+	static const char sigma[16] = "expand 32-byte k";
+	const u_char *k = seed;
+	for (uint i = 0;  i != 4;  i++) {
+		ks->state[i] = ffint_le_cpu32_ptr(sigma + i*4);
+	}
+	for (uint i = 0;  i != 8;  i++) {
+		ks->state[4 + i] = ffint_le_cpu32_ptr(k + i*4);
+	}
+	ks->state[12] = ks->state[13] = 0; // block counter
+	ks->state[14] = ks->state[15] = 0; // nonce
+	ks->rest_off = sizeof(ks->rest);
+}
+
+void keystream_fill(fcom_keystream *ks, void *buf, ffsize len)
+{
+	u_char *p = buf;
+
+	if (ks->rest_off != sizeof(ks->rest)) {
+		ffsize n = ffmin(len, sizeof(ks->rest) - ks->rest_off);
+		ffmem_copy(p, ks->rest + ks->rest_off, n);
+		ks->rest_off += n;
+		p += n;
+		len -= n;
+	}
+
+#ifdef KS_SIMD_X86
+	if (ks_simd == KS_SIMD_AVX2) {
+		for (;  len >= 8*64;  len -= 8*64) {
+			ks_block8_avx2(ks->state, p);
+			ks_counter_add(ks->state, 8);
+			p += 8*64;
+		}
+	}
+	if (ks_simd >= KS_SIMD_SSE2) {
+		for (;  len >= 4*64;  len -= 4*64) {
+			ks_block4_sse2(ks->state, p);
+			ks_counter_add(ks->state, 4);
+			p += 4*64;
+		}
+	}
+#endif
+
+	for (;  len >= 64;  len -= 64) {
+		ks_block(ks->state, p);
+		ks_counter_add(ks->state, 1);
+		p += 64;
+	}
+
+	if (len != 0) {
+		ks_block(ks->state, ks->rest);
+		ks_counter_add(ks->state, 1);
+		ffmem_copy(p, ks->rest, len);
+		ks->rest_off = len;
+	}
+}
@@ -0,0 +1,84 @@
+/** fcom: core: registry of the modules built into a static executable
+2026, Simon Zolin */
+
+/*
+The static build links each module into 1 object file
+ in which all symbols are local except for the module interfaces:
+ 'fcom_module' is renamed to 'fcom_module_ID'
+ and every other exported symbol 'SYM' is renamed to 'fcom_sym_ID_SYM'
+ (see 'STATIC_MOD' in Makefile).
+The lists below must match the modules and symbols exported by Makefile.
+*/
+
+/** X(ID, "name") */
+#define MODS_STATIC_BASE(X) \
+	X(7z, "7z") \
+	X(copy, "copy") \
+	X(crypto, "crypto") \
+	X(gz, "gz") \
+	X(hex, "hex") \
+	X(html, "html") \
+	X(ico_extract, "ico-extract") \
+	X(iso, "iso") \
+	X(list, "list") \
+	X(md5, "md5") \
+	X(move, "move") \
+	X(pack, "pack") \
+	X(pic, "pic") \
+	X(sync, "sync") \
+	X(tar, "tar") \
+	X(textcount, "textcount") \
+	X(touch, "touch") \
+	X(trash, "trash") \
+	X(unpack, "unpack") \
+	X(utf8, "utf8") \
+	X(xz, "xz") \
+	X(zip, "zip") \
+	X(zst, "zst")
+
+#ifdef FF_WIN
+	#define MODS_STATIC(X)  MODS_STATIC_BASE(X) \
+		X(reg, "reg")
+#else
+	#define MODS_STATIC(X)  MODS_STATIC_BASE(X)
+#endif
+
+/** Secondary interfaces requested by "module.symbol"
+X(ID, SYM) */
+#define MODS_STATIC_SYMS(X) \
+	X(crypto, fcom_aes_decrypt) \
+	X(crypto, fcom_aes_encrypt) \
+	X(crypto, sha256) \
+	X(md5, fcom_md5) \
+	X(zip, fcom_crc32) \
+	X(zip, fcom_unzip)
+
+#define X(id, name)  extern const struct fcom_module fcom_module_##id;
+MODS_STATIC(X)
+#undef X
+
+#define X(id, sym)  extern const char fcom_sym_##id##_##sym;
+MODS_STATIC_SYMS(X)
+#undef X
+
+struct mod_static {
+	const char *name;
+	const struct fcom_module *mod;
+};
+
+static const struct mod_static mods_static[] = {
+#define X(id, name)  { name, &fcom_module_##id },
+	MODS_STATIC(X)
+#undef X
+};
+
+struct mod_static_sym {
+	const char *mod, *name;
+	const void *addr;
+};
+
+static const struct mod_static_sym mods_static_syms[] = {
+#define X(id, sym)  { #id, #sym, &fcom_sym_##id##_##sym },
+	MODS_STATIC_SYMS(X)
+#undef X
+};
@@ -2,6 +2,9 @@
 2022, Simon Zolin */
 
 #include <ffsys/dylib.h>
+#ifdef FCOM_STATIC
+#include <core/mods-static.h>
+#endif
 
 struct mod {
 	char *name;
@@ -66,25 +69,79 @@ void mods_free()
 	ffmap_free(&com.mods);
 }
 
-static struct mod* mod_load(ffstr modname)
+#ifdef FCOM_STATIC
+
+/** Find module in the built-in registry */
+static int mod_open(struct mod *m, ffstr modname)
 {
-	struct mod *m = ffmem_new(struct mod);
+	const struct mod_static *ms;
+	FF_FOREACH(mods_static, ms) {
+		if (ffstr_eqz(&modname, ms->name)) {
+			m->mod = (struct fcom_module*)ms->mod;
+			dbglog("module '%S': built in", &modname);
+			return 0;
+		}
+	}
+	errlog("module '%S' isn't built in", &modname);
+	return -1;
+}
+
+static const void* mod_addr(struct mod *m, const char *name)
+{
+	const struct mod_static_sym *s;
+	FF_FOREACH(mods_static_syms, s) {
+		if (ffsz_eq(m->name, s->mod) && ffsz_eq(name, s->name))
+			return s->addr;
+	}
+	errlog("'%s': no registered operation '%s'", m->name, name);
+	return NULL;
+}
+
+#else
+
+static int mod_open(struct mod *m, ffstr modname)
+{
+	int rc = -1;
 	char *name = ffsz_allocfmt("ops%c%S." FFDL_EXT, FFPATH_SLASH, &modname);
 	char *fn = core->path(name);
 
 	dbglog("loading '%s'...", fn);
 	if (NULL == (m->dl = ffdl_open(fn, FFDL_SELFDIR))) {
 		errlog("dl open: %s: %s", fn, ffdl_errstr());
-		goto err;
+		goto end;
 	}
 
 	if (NULL == (m->mod = ffdl_addr(m->dl, "fcom_module"))) {
 		errlog("dl addr '%s': %s: %s", "fcom_module", fn, ffdl_errstr());
-		goto err;
+		goto end;
 	}
 
+	rc = 0;
+
+end:
+	ffmem_free(name);
+	ffmem_free(fn);
+	return rc;
+}
+
+static const void* mod_addr(struct mod *m, const char *name)
+{
+	const void *a;
+	if (NULL == (a = ffdl_addr(m->dl, name)))
+		errlog("'%s': no registered operation '%s': %s", m->name, name, ffdl_errstr());
+	return a;
+}
+
+#endif
+
+static struct mod* mod_load(ffstr modname)
+{
+	struct mod *m = ffmem_new(struct mod);
+	if (mod_open(m, modname))
+		goto err;
+
 	if (m->mod->ver_core != FCOM_CORE_VER) {
-		errlog("module %s is built for another fcom version", fn);
+		errlog("module %S is built for another fcom version", &modname);
 		goto err;
 	}
 
@@ -92,13 +149,9 @@ static struct mod* mod_load(ffstr modname)
 	dbglog("initializing module '%s'...", m->name);
 	m->mod->init(core);
 	dbglog("initialized module '%s' v%s", m->name, m->mod->version);
-	ffmem_free(name);
-	ffmem_free(fn);
 	return m;
 
 err:
-	ffmem_free(name);
-	ffmem_free(fn);
 	mod_free(m);
 	return NULL;
 }
@@ -106,6 +159,7 @@ err:
 /**
 "a" -> "ops/a.so".addr("a")
 "a.b" -> "ops/a.so".addr("b")
+Static build: the modules and their symbols are found in the built-in registry.
 */
 const void* com_provide(const char *operation, uint flags)
 {
@@ -136,10 +190,8 @@ const void* com_provide(const char *operation, uint flags)
 			errlog("'%s': no registered operation '%s'", m->name, opname.ptr);
 			return NULL;
 		}
-		if (NULL == (opif = ffdl_addr(m->dl, opname.ptr))) {
-			errlog("'%s': no registered operation '%s': %s", m->name, opname.ptr, ffdl_errstr());
+		if (NULL == (opif = mod_addr(m, opname.ptr)))
 			return NULL;
-		}
 	}
 
 	return opif;
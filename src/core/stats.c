@@ -0,0 +1,144 @@
+/** fcom: core: performance counters
+2026, Simon Zolin */
+
+/*
+Each operation type (read, write, metadata, codec) has:
+ number of calls, bytes, total time and a latency histogram with log2(usec) buckets.
+The counters are updated atomically from any thread
+ and printed to stderr when the core exits.
+*/
+
+#include <fcom.h>
+#include <ffsys/std.h>
+#include <ffsys/perf.h>
+
+extern fcom_core *core;
+
+#define STAT_HIST_N  24 // [0]: 0usec;  [i]: <2^i usec;  [23]: >=4sec
+
+struct stat_op {
+	uint64 calls, bytes, usec;
+	uint64 hist[STAT_HIST_N];
+};
+
+struct stats {
+	fftime start;
+	uint64 cnt[_FCOM_STAT_N];
+	struct stat_op ops[_FCOM_STAT_OP_N];
+};
+static struct stats gstats;
+
+#define stat_inc(ptr, val)  __atomic_fetch_add(ptr, val, __ATOMIC_RELAXED)
+
+static const char cnt_names[][16] = {
+	"files",
+	"cache_hits",
+	"cache_misses",
+	"buf_new",
+	"buf_reused",
+	"buf_peak_kb",
+};
+
+static const char op_names[][8] = {
+	"read",
+	"write",
+	"meta",
+	"codec",
+};
+
+void stats_init()
+{
+	gstats.start = fftime_monotonic();
+}
+
+void core_stat_add(uint id, uint64 val)
+{
+	stat_inc(&gstats.cnt[id], val);
+}
+
+void core_stat_op(uint op, const fftime *t1, uint64 bytes)
+{
+	fftime t = fftime_monotonic();
+	fftime_sub(&t, t1);
+	uint64 usec = fftime_to_usec(&t);
+
+	struct stat_op *s = &gstats.ops[op];
+	stat_inc(&s->calls, 1);
+	stat_inc(&s->bytes, bytes);
+	stat_inc(&s->usec, usec);
+
+	uint i = 0;
+	if (usec != 0)
+		i = ffmin(64 - __builtin_clzll(usec), STAT_HIST_N - 1);
+	stat_inc(&s->hist[i], 1);
+}
+
+static void stats_text(ffvec *v, uint64 total_usec)
+{
+	ffvec_addfmt(v, "stats:\n  time: %Ums\n", total_usec / 1000);
+
+	ffvec_addfmt(v, "  %s: %U  (%U/sec)\n"
+		, cnt_names[FCOM_STAT_FILES], gstats.cnt[FCOM_STAT_FILES]
+		, gstats.cnt[FCOM_STAT_FILES] * 1000000 / total_usec);
+	for (uint i = FCOM_STAT_FILES + 1;  i != _FCOM_STAT_N;  i++) {
+		ffvec_addfmt(v, "  %s: %U\n", cnt_names[i], gstats.cnt[i]);
+	}
+
+	for (uint i = 0;  i != _FCOM_STAT_OP_N;  i++) {
+		const struct stat_op *s = &gstats.ops[i];
+		if (s->calls == 0)
+			continue;
+
+		ffvec_addfmt(v, "  %s: calls:%U  bytes:%U  time:%Ums (%u%%)  %UMB/sec\n"
+			, op_names[i], s->calls, s->bytes, s->usec / 1000
+			, (uint)(s->usec * 100 / total_usec)
+			, FFINT_DIVSAFE(s->bytes, s->usec));
+
+		ffvec_addfmt(v, "    latency:");
+		for (uint k = 0;  k != STAT_HIST_N;  k++) {
+			if (s->hist[k] != 0)
+				ffvec_addfmt(v, "  <%Uus:%U", (uint64)1 << k, s->hist[k]);
+		}
+		ffvec_addfmt(v, "\n");
+	}
+}
+
+static void stats_json(ffvec *v, uint64 total_usec)
+{
+	ffvec_addfmt(v, "{\"time_usec\":%U", total_usec);
+	for (uint i = 0;  i != _FCOM_STAT_N;  i++) {
+		ffvec_addfmt(v, ",\"%s\":%U", cnt_names[i], gstats.cnt[i]);
+	}
+	ffvec_addfmt(v, ",\"files_per_sec\":%U"
+		, gstats.cnt[FCOM_STAT_FILES] * 1000000 / total_usec);
+
+	for (uint i = 0;  i != _FCOM_STAT_OP_N;  i++) {
+		const struct stat_op *s = &gstats.ops[i];
+		ffvec_addfmt(v, ",\"%s\":{\"calls\":%U,\"bytes\":%U,\"usec\":%U,\"latency_usec\":{"
+			, op_names[i], s->calls, s->bytes, s->usec);
+
+		uint n = 0;
+		for (uint k = 0;  k != STAT_HIST_N;  k++) {
+			if (s->hist[k] != 0)
+				ffvec_addfmt(v, "%s\"%U\":%U", (n++) ? "," : "", (uint64)1 << k, s->hist[k]);
+		}
+		ffvec_addfmt(v, "}}");
+	}
+	ffvec_addfmt(v, "}\n");
+}
+
+/** Print the counters to stderr */
+void stats_print(uint json)
+{
+	fftime t = fftime_monotonic();
+	fftime_sub(&t, &gstats.start);
+	uint64 total_usec = ffmax(fftime_to_usec(&t), 1);
+
+	ffvec v = {};
+	if (json)
+		stats_json(&v, total_usec);
+	else
+		stats_text(&v, total_usec);
+	fffile_write(ffstderr, v.ptr, v.len);
+	ffvec_free(&v);
+}
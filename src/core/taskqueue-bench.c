@@ -0,0 +1,191 @@
+/** fcom: task queue: measure posts/sec with N writer threads and 1 reader;
+ compare the lock-free queue with the previous locked implementation
+2026, Simon Zolin */
+
+/*
+Usage: taskqueue-bench [PRODUCERS] [POSTS_PER_PRODUCER]
+*/
+
+#include <util/taskqueue.h>
+#include <ffsys/thread.h>
+#include <ffsys/time.h>
+#include <ffsys/perf.h>
+#include <ffbase/string.h>
+#include <ffbase/list.h>
+#include <ffbase/lock.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TASKS_PER_PRODUCER  256
+
+
+/* The previous implementation (baseline): a list protected by a spinlock;
+ post() returns 1 each time the queue was empty. */
+
+typedef struct lktask {
+	fftask_handler handler;
+	void *param;
+	ffchain_item sib;
+} lktask;
+
+typedef struct lktaskqueue {
+	fflist tasks; // lktask[]
+	fflock lk;
+} lktaskqueue;
+
+static void lktaskqueue_init(lktaskqueue *tq)
+{
+	fflist_init(&tq->tasks);
+	fflock_init(&tq->lk);
+}
+
+#define lktaskqueue_active(tq, t)  (FFINT_READONCE((t)->sib.next) != NULL)
+
+static ffuint lktaskqueue_post(lktaskqueue *tq, lktask *t)
+{
+	ffuint r = 0;
+
+	fflock_lock(&tq->lk);
+	if (lktaskqueue_active(tq, t))
+		goto done;
+	r = fflist_empty(&tq->tasks);
+	fflist_add(&tq->tasks, &t->sib);
+
+done:
+	fflock_unlock(&tq->lk);
+	return r;
+}
+
+static ffuint lktaskqueue_run(lktaskqueue *tq)
+{
+	ffchain_item *it, *sentl = fflist_sentl(&tq->tasks);
+	ffuint n = 0, nn = tq->tasks.len;
+
+	while (n < nn) {
+
+		it = FFINT_READONCE(fflist_first(&tq->tasks));
+		if (it == sentl)
+			break; // list is empty
+
+		fflock_lock(&tq->lk);
+		fflist_rm(&tq->tasks, it);
+		fflock_unlock(&tq->lk);
+
+		lktask *t = FF_CONTAINER(lktask, sib, it);
+		t->handler(t->param);
+
+		n++;
+	}
+
+	return n;
+}
+
+
+struct producer {
+	ffthread th;
+	ffuint64 wakeups;
+	fftask tasks[TASKS_PER_PRODUCER];
+	lktask lktasks[TASKS_PER_PRODUCER];
+};
+
+static fftaskqueue tq;
+static lktaskqueue lktq;
+static ffuint64 posts_per_producer;
+static ffuint64 handled;
+
+static void task_handler(void *param)
+{
+	handled++;
+}
+
+static int FFTHREAD_PROCCALL producer_proc(void *param)
+{
+	struct producer *p = param;
+	for (ffuint64 i = 0;  i != posts_per_producer;  ) {
+		fftask *t = &p->tasks[i % TASKS_PER_PRODUCER];
+		if (fftaskqueue_active(&tq, t))
+			continue; // the reader hasn't processed this task yet
+
+		fftask_set(t, task_handler, p);
+		if (fftaskqueue_post(&tq, t))
+			p->wakeups++;
+		i++;
+	}
+	return 0;
+}
+
+static int FFTHREAD_PROCCALL lkproducer_proc(void *param)
+{
+	struct producer *p = param;
+	for (ffuint64 i = 0;  i != posts_per_producer;  ) {
+		lktask *t = &p->lktasks[i % TASKS_PER_PRODUCER];
+		if (lktaskqueue_active(&lktq, t))
+			continue;
+
+		fftask_set(t, task_handler, p);
+		if (lktaskqueue_post(&lktq, t))
+			p->wakeups++;
+		i++;
+	}
+	return 0;
+}
+
+/** Run N producers and the reader; print the results */
+static int bench(const char *name, ffuint n, ffuint locked)
+{
+	struct producer *prods = calloc(n, sizeof(struct producer));
+	ffuint64 total = n * posts_per_producer, runs = 0;
+	handled = 0;
+
+	fftime t1 = fftime_monotonic();
+
+	for (ffuint i = 0;  i != n;  i++) {
+		prods[i].th = ffthread_create((locked) ? lkproducer_proc : producer_proc, &prods[i], 0);
+		if (prods[i].th == FFTHREAD_NULL) {
+			printf("ffthread_create failed\n");
+			return 1;
+		}
+	}
+
+	while (FFINT_READONCE(handled) != total) {
+		if (locked)
+			lktaskqueue_run(&lktq);
+		else
+			fftaskqueue_run(&tq);
+		runs++;
+	}
+
+	fftime t2 = fftime_monotonic();
+
+	ffuint64 wakeups = 0;
+	for (ffuint i = 0;  i != n;  i++) {
+		ffthread_join(prods[i].th, -1, NULL);
+		wakeups += prods[i].wakeups;
+	}
+
+	fftime_sub(&t2, &t1);
+	ffuint64 usec = ffmax(fftime_to_usec(&t2), 1);
+	printf("%s:  producers:%u  posts:%llu  time:%llums  posts/sec:%llu  wakeups:%llu  reader-runs:%llu\n"
+		, name, n, (unsigned long long)total, (unsigned long long)usec / 1000
+		, (unsigned long long)(total * 1000000 / usec)
+		, (unsigned long long)wakeups, (unsigned long long)runs);
+
+	free(prods);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	ffuint n = (argc > 1) ? atoi(argv[1]) : 4;
+	posts_per_producer = (argc > 2) ? strtoull(argv[2], NULL, 10) : 1000000;
+	if (n == 0)
+		n = 1;
+
+	fftaskqueue_init(&tq);
+	lktaskqueue_init(&lktq);
+
+	if (bench("locked", n, 1)
+		|| bench("lock-free", n, 0))
+		return 1;
+	return 0;
+}
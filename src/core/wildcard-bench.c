@@ -0,0 +1,140 @@
+/** fcom: compare include/exclude matching: compiled pattern set vs. ffs_wildcard() loop
+2026, Simon Zolin */
+
+/*
+Usage: wildcard-bench [PATTERNS] [NAMES]
+*/
+
+#include <util/wildcard-set.h>
+#include <ffsys/time.h>
+#include <ffsys/perf.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static ffuint rnd_state = 1;
+
+static ffuint rnd()
+{
+	rnd_state = rnd_state * 1103515245 + 12345;
+	return rnd_state >> 8;
+}
+
+/** Generate a pattern of the kind commonly used with -I/-E */
+static void pattern_gen(ffvec *buf, ffuint i)
+{
+	switch (i % 5) {
+	case 0:
+		ffvec_addfmt(buf, "File%u.dat", rnd() % 1000); break;
+	case 1:
+		ffvec_addfmt(buf, "*.ext%u", rnd() % 100); break;
+	case 2:
+		ffvec_addfmt(buf, "dir%u/*", rnd() % 100); break;
+	case 3:
+		ffvec_addfmt(buf, "*tmp%u*", rnd() % 1000); break;
+	case 4:
+		ffvec_addfmt(buf, "f?le%u.*", rnd() % 1000); break;
+	}
+}
+
+static void name_gen(ffvec *buf)
+{
+	switch (rnd() % 3) {
+	case 0:
+		ffvec_addfmt(buf, "dir%u/file%u.ext%u", rnd() % 200, rnd() % 2000, rnd() % 200); break;
+	case 1:
+		ffvec_addfmt(buf, "file%u.DAT", rnd() % 2000); break;
+	case 2:
+		ffvec_addfmt(buf, "dir%u/sub/tmp%u.bin", rnd() % 200, rnd() % 2000); break;
+	}
+}
+
+static ffuint64 usec_since(fftime t1)
+{
+	fftime t2 = fftime_monotonic();
+	fftime_sub(&t2, &t1);
+	return ffmax(fftime_to_usec(&t2), 1);
+}
+
+int main(int argc, char **argv)
+{
+	ffuint npat = (argc > 1) ? atoi(argv[1]) : 500;
+	ffuint nnames = (argc > 2) ? atoi(argv[2]) : 1000000;
+
+	ffvec pat_data = {}, pats = {}; // char[], ffstr[]
+	ffvec name_data = {}, names = {};
+	ffvec offs = {}; // ffsize[]
+
+	for (ffuint i = 0;  i != npat;  i++) {
+		*ffvec_pushT(&offs, ffsize) = pat_data.len;
+		pattern_gen(&pat_data, i);
+	}
+	*ffvec_pushT(&offs, ffsize) = pat_data.len;
+	for (ffuint i = 0;  i != npat;  i++) {
+		ffsize *o = ffslice_itemT(&offs, i, ffsize);
+		ffstr *s = ffvec_pushT(&pats, ffstr);
+		ffstr_set(s, (char*)pat_data.ptr + o[0], o[1] - o[0]);
+	}
+
+	offs.len = 0;
+	for (ffuint i = 0;  i != nnames;  i++) {
+		*ffvec_pushT(&offs, ffsize) = name_data.len;
+		name_gen(&name_data);
+	}
+	*ffvec_pushT(&offs, ffsize) = name_data.len;
+	for (ffuint i = 0;  i != nnames;  i++) {
+		ffsize *o = ffslice_itemT(&offs, i, ffsize);
+		ffstr *s = ffvec_pushT(&names, ffstr);
+		ffstr_set(s, (char*)name_data.ptr + o[0], o[1] - o[0]);
+	}
+
+	// linear loop
+	fftime t = fftime_monotonic();
+	ffuint nmatch_linear = 0;
+	ffstr *name, *p;
+	FFSLICE_WALK(&names, name) {
+		FFSLICE_WALK(&pats, p) {
+			if (0 == ffs_wildcard(p->ptr, p->len, name->ptr, name->len, FFS_WC_ICASE)) {
+				nmatch_linear++;
+				break;
+			}
+		}
+	}
+	ffuint64 usec_linear = usec_since(t);
+
+	// compiled
+	t = fftime_monotonic();
+	wcset w;
+	wcset_init(&w);
+	FFSLICE_WALK(&pats, p) {
+		wcset_add(&w, *p);
+	}
+	if (wcset_compile(&w)) {
+		printf("wcset_compile failed\n");
+		return 1;
+	}
+	ffuint64 usec_compile = usec_since(t);
+
+	t = fftime_monotonic();
+	ffuint nmatch = 0;
+	FFSLICE_WALK(&names, name) {
+		if (wcset_match(&w, *name) >= 0)
+			nmatch++;
+	}
+	ffuint64 usec_set = usec_since(t);
+
+	printf("patterns:%u  names:%u  matched:%u/%u\n"
+		"linear:   %llums  names/sec:%llu\n"
+		"compiled: %llums  names/sec:%llu  compile:%lluus\n"
+		, npat, nnames, nmatch, nmatch_linear
+		, (unsigned long long)usec_linear / 1000, (unsigned long long)nnames * 1000000 / usec_linear
+		, (unsigned long long)usec_set / 1000, (unsigned long long)nnames * 1000000 / usec_set
+		, (unsigned long long)usec_compile);
+
+	wcset_free(&w);
+	ffvec_free(&pat_data);
+	ffvec_free(&pats);
+	ffvec_free(&name_data);
+	ffvec_free(&names);
+	ffvec_free(&offs);
+	return (nmatch != nmatch_linear);
+}
@@ -0,0 +1,205 @@
+/** fcom: core: worker thread pool
+2026, Simon Zolin */
+
+/*
+Jobs are queued in FIFO order and executed by a limited number of worker threads.
+Threads are started on demand: a new thread is created only if there are no idle threads.
+After job.func() returns, job.on_complete() is posted to the main thread's task queue.
+*/
+
+#include <fcom.h>
+#include <ffsys/thread.h>
+#include <ffsys/sysconf.h>
+#ifndef FF_WIN
+	#include <pthread.h>
+#endif
+
+#define syserrlog(fmt, ...)  core->log(FCOM_LOG_ERR | FCOM_LOG_SYSERR, "core: workers: " fmt, ##__VA_ARGS__)
+#define dbglog(fmt, ...)  fcom_dbglog("core: workers: " fmt, ##__VA_ARGS__)
+
+extern fcom_core *core;
+
+/** Mutex + condition variable */
+struct wcond {
+#ifdef FF_WIN
+	CRITICAL_SECTION lk;
+	CONDITION_VARIABLE cv;
+#else
+	pthread_mutex_t lk;
+	pthread_cond_t cv;
+#endif
+};
+
+#ifdef FF_WIN
+
+static void wcond_init(struct wcond *c)
+{
+	InitializeCriticalSection(&c->lk);
+	InitializeConditionVariable(&c->cv);
+}
+
+static void wcond_destroy(struct wcond *c)
+{
+	DeleteCriticalSection(&c->lk);
+}
+
+#define wcond_lock(c)  EnterCriticalSection(&(c)->lk)
+#define wcond_unlock(c)  LeaveCriticalSection(&(c)->lk)
+#define wcond_wait(c)  SleepConditionVariableCS(&(c)->cv, &(c)->lk, INFINITE)
+#define wcond_signal(c)  WakeConditionVariable(&(c)->cv)
+#define wcond_broadcast(c)  WakeAllConditionVariable(&(c)->cv)
+
+#else
+
+static void wcond_init(struct wcond *c)
+{
+	pthread_mutex_init(&c->lk, NULL);
+	pthread_cond_init(&c->cv, NULL);
+}
+
+static void wcond_destroy(struct wcond *c)
+{
+	pthread_cond_destroy(&c->cv);
+	pthread_mutex_destroy(&c->lk);
+}
+
+#define wcond_lock(c)  pthread_mutex_lock(&(c)->lk)
+#define wcond_unlock(c)  pthread_mutex_unlock(&(c)->lk)
+#define wcond_wait(c)  pthread_cond_wait(&(c)->cv, &(c)->lk)
+#define wcond_signal(c)  pthread_cond_signal(&(c)->cv)
+#define wcond_broadcast(c)  pthread_cond_broadcast(&(c)->cv)
+
+#endif
+
+struct workers {
+	struct wcond c;
+	fflist jobs; // fcom_job[]
+	ffthread *threads;
+	uint max, n, idle;
+	uint quit;
+};
+static struct workers *gw;
+
+/** Set the max. number of threads
+n: 0: use the number of CPUs */
+uint workers_init(uint n)
+{
+	gw = ffmem_new(struct workers);
+	wcond_init(&gw->c);
+	fflist_init(&gw->jobs);
+
+	if (n == 0) {
+		ffsysconf sc;
+		ffsysconf_init(&sc);
+		n = ffmax(ffsysconf_get(&sc, FFSYSCONF_NPROCESSORS_ONLN), 1);
+	}
+	gw->max = n;
+	gw->threads = ffmem_calloc(n, sizeof(ffthread));
+	dbglog("max threads: %u", n);
+	return n;
+}
+
+/** Stop and join all threads.
+Jobs that are still in queue are discarded. */
+void workers_destroy()
+{
+	if (gw == NULL)
+		return;
+
+	wcond_lock(&gw->c);
+	gw->quit = 1;
+	wcond_broadcast(&gw->c);
+	wcond_unlock(&gw->c);
+
+	for (uint i = 0;  i != gw->n;  i++) {
+		ffthread_join(gw->threads[i], -1, NULL);
+	}
+	dbglog("stopped %u threads", gw->n);
+
+	wcond_destroy(&gw->c);
+	ffmem_free(gw->threads);
+	ffmem_free(gw);
+	gw = NULL;
+}
+
+static int FFTHREAD_PROCCALL wrk_thread(void *param)
+{
+	wcond_lock(&gw->c);
+	for (;;) {
+		while (fflist_empty(&gw->jobs) && !gw->quit) {
+			gw->idle++;
+			wcond_wait(&gw->c);
+			gw->idle--;
+		}
+		if (gw->quit)
+			break;
+
+		ffchain_item *it = fflist_first(&gw->jobs);
+		fflist_rm(&gw->jobs, it);
+		wcond_unlock(&gw->c);
+
+		fcom_job *j = FF_CONTAINER(fcom_job, sib, it);
+		j->func(j->param);
+		if (j->on_complete != NULL)
+			core->task(&j->task, j->on_complete, j->param);
+
+		wcond_lock(&gw->c);
+	}
+	wcond_unlock(&gw->c);
+	return 0;
+}
+
+void core_job(fcom_job *j)
+{
+	j->cancelled = 0;
+
+	wcond_lock(&gw->c);
+	fflist_add(&gw->jobs, &j->sib);
+
+	if (gw->idle == 0 && gw->n != gw->max) {
+		ffthread t = ffthread_create(wrk_thread, NULL, 0);
+		if (t != FFTHREAD_NULL) {
+			gw->threads[gw->n++] = t;
+			dbglog("started thread #%u", gw->n);
+
+		} else {
+			syserrlog("thread create");
+			if (gw->n == 0) {
+				// no threads: execute the job in the current thread
+				fflist_rm(&gw->jobs, &j->sib);
+				wcond_unlock(&gw->c);
+				j->func(j->param);
+				if (j->on_complete != NULL)
+					core->task(&j->task, j->on_complete, j->param);
+				return;
+			}
+		}
+	}
+
+	wcond_signal(&gw->c);
+	wcond_unlock(&gw->c);
+}
+
+void core_job_cancel(const void *owner)
+{
+	ffchain_item *it, *next;
+	uint n = 0;
+
+	wcond_lock(&gw->c);
+	for (it = fflist_first(&gw->jobs);  it != fflist_sentl(&gw->jobs);  it = next) {
+		next = it->next;
+		fcom_job *j = FF_CONTAINER(fcom_job, sib, it);
+		if (j->owner != owner)
+			continue;
+
+		fflist_rm(&gw->jobs, it);
+		j->cancelled = 1;
+		if (j->on_complete != NULL)
+			core->task(&j->task, j->on_complete, j->param);
+		n++;
+	}
+	wcond_unlock(&gw->c);
+
+	if (n != 0)
+		dbglog("%p: cancelled %u jobs", owner, n);
+}
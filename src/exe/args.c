@@ -52,9 +52,15 @@ static int args_help(struct args *a)
 
 static const struct ffarg exe_args[] = {
 	{ "--Debug",	'1',	O(debug) },
+	{ "--Hugepages",'1',	O(hugepages) },
+	{ "--Stats",	'1',	O(stats) },
+	{ "--Stats-json",'1',	O(stats_json) },
+	{ "--Threads",	'u',	O(threads) },
 	{ "--Verbose",	'1',	O(verbose) },
 
+	{ "--client",	'1',	O(client) },
 	{ "--help",		'0',	args_help },
+	{ "--server",	'1',	O(server) },
 
 	{ "-D",			'1',	O(debug) },
 	{ "-V",			'1',	O(verbose) },
@@ -8,6 +8,10 @@ struct args {
 	char **argv;
 	byte verbose;
 	byte debug;
+	byte stats, stats_json;
+	byte hugepages;
+	byte server, client;
+	uint threads;
 	ffvec args; // const char*[]
 };
 
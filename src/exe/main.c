@@ -30,6 +30,7 @@ struct main {
 static struct main *m;
 
 #include <exe/log.h>
+#include <exe/server.h>
 
 char* path(const char *fn)
 {
@@ -49,6 +50,10 @@ static int load_core()
 		.app_path = m->rootdir.ptr,
 		.debug = m->conf.debug,
 		.verbose = m->conf.verbose,
+		.workers = m->conf.threads,
+		.stats = m->conf.stats | m->conf.stats_json,
+		.stats_json = m->conf.stats_json,
+		.hugepages = m->conf.hugepages,
 		.stdout_color = !ffstd_attr(ffstdout, FFSTD_VTERM, FFSTD_VTERM),
 	};
 	if (!(m->core = fcom_coreinit.conf(&cconf)))
@@ -88,6 +93,9 @@ static void on_signal(struct ffsig_info *i)
 
 static void main_free()
 {
+#ifdef FF_UNIX
+	server_free();
+#endif
 	fcom_coreinit.destroy();
 	args_destroy(&m->conf);
 	ffmem_free(m->cmd_line);
@@ -115,11 +123,31 @@ int main(int argc, char **argv)
 		goto exit;
 	}
 
+#ifdef FF_UNIX
+	if (m->conf.client) {
+		log_init(&m->log);
+		ec = client_run(m->conf.argc, m->conf.argv);
+		goto exit;
+	}
+#else
+	if (m->conf.server || m->conf.client) {
+		log_init(&m->log);
+		exe_log(FCOM_LOG_ERR, "--server, --client: not supported on this OS");
+		goto exit;
+	}
+#endif
+
 	if (load_core())
 		goto exit;
 	m->core->env = (const char**)environ;
 
-	m->core->task(&m->task, operation, NULL);
+#ifdef FF_UNIX
+	if (m->conf.server) {
+		if (server_start())
+			goto exit;
+	} else
+#endif
+		m->core->task(&m->task, operation, NULL);
 
 	static const uint sigs[] = { FFSIG_INT };
 	ffsig_subscribe(on_signal, sigs, FF_COUNT(sigs));
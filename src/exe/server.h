@@ -0,0 +1,515 @@
+/** fcom: server mode: run operations submitted by clients via UNIX socket
+2026, Simon Zolin */
+
+/*
+Client                                 Server
+connect(SOCKET)                  ->    accept()
+send(HDR, DATA) + SCM_RIGHTS(0,1,2) -> chdir(CWD), dup2() the descriptors to 0,1,2
+                                       run operation
+                                 <-    send(EXIT_CODE)
+
+HDR: "fcm1" SIZE(4)
+DATA: CWD \0 ARG1 \0 ... ARGn \0
+EXIT_CODE: int(4)
+
+The server executes operations one by one,
+ because the current directory and the standard descriptors belong to the process.
+The modules stay loaded between requests.
+The client's socket is non-blocking and is read via the core's KQ:
+ a slow client can't block the main thread; it's disconnected after SRV_RECV_TIMEOUT_SEC.
+Only the clients of the same user are accepted:
+ the socket file is created with 0600 mode and the peer's UID is checked.
+*/
+
+#ifdef FF_UNIX
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <signal.h>
+
+#define SRV_MAGIC  "fcm1"
+#define SRV_DATA_MAX  (1*1024*1024)
+#define SRV_RECV_TIMEOUT_SEC  5
+#define SRV_FDS_MAX  16 // receive this many descriptors at most (all are closed if the number isn't 3)
+
+struct srv_hdr {
+	char magic[4];
+	uint size;
+};
+
+struct server {
+	int lsock;
+	char *path;
+	fcom_kevent kev;
+	fcom_task task;
+	uint task_active :1;
+
+	int csock; // the current client;  -1: none
+	fcom_kevent ckev;
+	fcom_timer ctmr;
+	uint recv_st; // enum SRV_RECV
+	uint recv_off;
+	struct srv_hdr hdr;
+	uint ctmr_active :1;
+	int fd_client[3], fd_saved[3];
+	ffvec data;
+};
+
+enum SRV_RECV {
+	SRV_RECV_HDR,
+	SRV_RECV_DATA,
+	SRV_RECV_DONE, // the operation is running
+};
+static struct server *srv;
+
+/** Socket path: $FCOM_SOCKET or $XDG_RUNTIME_DIR/fcom.sock or /tmp/fcom-UID.sock */
+static char* srv_path()
+{
+	const char *s;
+	if (NULL != (s = getenv("FCOM_SOCKET")))
+		return ffsz_dup(s);
+	if (NULL != (s = getenv("XDG_RUNTIME_DIR")))
+		return ffsz_allocfmt("%s/fcom.sock", s);
+	return ffsz_allocfmt("/tmp/fcom-%u.sock", (uint)getuid());
+}
+
+static int srv_addr(struct sockaddr_un *a, const char *path)
+{
+	ffmem_zero_obj(a);
+	a->sun_family = AF_UNIX;
+	if (ffsz_len(path) >= sizeof(a->sun_path)) {
+		exe_log(FCOM_LOG_ERR, "socket path is too long: %s", path);
+		return -1;
+	}
+	ffsz_copyz(a->sun_path, sizeof(a->sun_path), path);
+	return 0;
+}
+
+static void srv_accept(void *param);
+static void srv_accept_task(void *param);
+
+static void srv_client_close()
+{
+	if (srv->ctmr_active) {
+		srv->ctmr_active = 0;
+		m->core->timer(&srv->ctmr, 0, NULL, NULL);
+	}
+	for (uint i = 0;  i != 3;  i++) {
+		if (srv->fd_client[i] < 0)
+			continue;
+		dup2(srv->fd_saved[i], i);
+		close(srv->fd_client[i]);
+		srv->fd_client[i] = -1;
+	}
+	close(srv->csock);
+	srv->csock = -1;
+	srv->recv_st = SRV_RECV_HDR;
+	srv->recv_off = 0;
+	srv->data.len = 0;
+	log_init(&m->log);
+}
+
+static void srv_op_complete(void *param, int result)
+{
+	exe_log(FCOM_LOG_DBG, "server: operation complete: %d", result);
+	int ec = result;
+	if (sizeof(ec) != send(srv->csock, &ec, sizeof(ec), MSG_NOSIGNAL))
+		exe_log(FCOM_LOG_SYSERR, "server: send");
+	srv_client_close();
+
+	// continue with the next client after the operation is destroyed
+	if (!srv->task_active) {
+		srv->task_active = 1;
+		m->core->task(&srv->task, srv_accept_task, NULL);
+	}
+}
+
+/** Take the client's descriptors: exactly 3 in a single message.
+Close all the others. */
+static void srv_fds_take(struct msghdr *msg)
+{
+	for (struct cmsghdr *c = CMSG_FIRSTHDR(msg);  c != NULL;  c = CMSG_NXTHDR(msg, c)) {
+		if (!(c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS))
+			continue;
+
+		uint n = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		n = ffmin(n, SRV_FDS_MAX);
+		int fds[SRV_FDS_MAX];
+		ffmem_copy(fds, CMSG_DATA(c), n * sizeof(int));
+
+		if (n == 3 && srv->fd_client[0] < 0) {
+			ffmem_copy(srv->fd_client, fds, sizeof(srv->fd_client));
+			continue;
+		}
+
+		exe_log(FCOM_LOG_DBG, "server: closing %u unexpected descriptors", n);
+		for (uint i = 0;  i != n;  i++) {
+			close(fds[i]);
+		}
+	}
+}
+
+/** Receive data from the client without blocking.
+Return N of bytes received;  0: no more data yet;  -1: error or disconnected */
+static ssize_t srv_recvmsg(void *buf, ffsize n)
+{
+	union {
+		struct cmsghdr hdr;
+		char buf[CMSG_SPACE(SRV_FDS_MAX * sizeof(int))];
+	} ctl;
+	struct iovec iov = { buf, n };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = ctl.buf,
+		.msg_controllen = sizeof(ctl.buf),
+	};
+
+	ssize_t r = recvmsg(srv->csock, &msg, MSG_CMSG_CLOEXEC);
+	if (r < 0) {
+		if (errno == EAGAIN || errno == EINTR)
+			return 0;
+		exe_log(FCOM_LOG_SYSERR, "server: recvmsg");
+		return -1;
+	}
+	srv_fds_take(&msg);
+	if (r == 0) {
+		exe_log(FCOM_LOG_ERR, "server: client disconnected");
+		return -1;
+	}
+	return r;
+}
+
+/** Receive request header with the client's descriptors, then the data.
+Return 0: complete;  1: need more data;  -1: error */
+static int srv_recv()
+{
+	ssize_t r;
+	switch (srv->recv_st) {
+	case SRV_RECV_HDR:
+		while (srv->recv_off != sizeof(srv->hdr)) {
+			if (0 >= (r = srv_recvmsg((char*)&srv->hdr + srv->recv_off, sizeof(srv->hdr) - srv->recv_off)))
+				return (r == 0) ? 1 : -1;
+			srv->recv_off += r;
+		}
+
+		if (srv->fd_client[0] < 0
+			|| ffmem_cmp(srv->hdr.magic, SRV_MAGIC, 4)
+			|| srv->hdr.size == 0 || srv->hdr.size > SRV_DATA_MAX) {
+			exe_log(FCOM_LOG_ERR, "server: bad request");
+			return -1;
+		}
+
+		ffvec_alloc(&srv->data, srv->hdr.size + 1, 1);
+		srv->data.len = 0;
+		srv->recv_st = SRV_RECV_DATA;
+		// fallthrough
+
+	case SRV_RECV_DATA:
+		while (srv->data.len != srv->hdr.size) {
+			if (0 >= (r = srv_recvmsg((char*)srv->data.ptr + srv->data.len, srv->hdr.size - srv->data.len)))
+				return (r == 0) ? 1 : -1;
+			srv->data.len += r;
+		}
+		((char*)srv->data.ptr)[srv->data.len] = '\0';
+		srv->recv_st = SRV_RECV_DONE;
+		return 0;
+	}
+	return 1; // SRV_RECV_DONE: the operation is running; the client mustn't send anything
+}
+
+/** Switch to the client's environment and start the operation */
+static void srv_op_start()
+{
+	ffstr d = *(ffstr*)&srv->data, cwd;
+	ffstr_splitby(&d, '\0', &cwd, &d);
+
+	ffvec argv = {};
+	while (d.len != 0) {
+		ffstr a;
+		ffstr_splitby(&d, '\0', &a, &d);
+		*ffvec_pushT(&argv, char*) = ffsz_dupstr(&a);
+	}
+	uint argc = argv.len;
+	ffvec_zpushT(&argv, char*);
+
+	for (uint i = 0;  i != 3;  i++) {
+		dup2(srv->fd_client[i], i);
+	}
+	m->core->stdout_busy = 0;
+	m->core->stdout_color = !ffstd_attr(ffstdout, FFSTD_VTERM, FFSTD_VTERM);
+	log_init(&m->log);
+
+	exe_log(FCOM_LOG_DBG, "server: request: '%s' %u args", cwd.ptr, argc);
+
+	fcom_cominfo *cmd = m->core->com->create();
+	cmd->argv = argv.ptr;
+	cmd->argc = argc;
+	cmd->on_complete = srv_op_complete;
+	cmd->opaque = srv;
+
+	if (0 != chdir(cwd.ptr)) {
+		exe_log(FCOM_LOG_SYSERR, "chdir: %s", cwd.ptr);
+		m->core->com->destroy(cmd); // calls srv_op_complete()
+		return;
+	}
+
+	m->core->com->run(cmd); // on failure 'cmd' is destroyed, srv_op_complete() is called
+}
+
+/** Allow only the clients of the same user */
+static int srv_peer_allowed(int sk)
+{
+	uid_t uid;
+#ifdef FF_LINUX
+	struct ucred cr;
+	socklen_t n = sizeof(cr);
+	if (0 != getsockopt(sk, SOL_SOCKET, SO_PEERCRED, &cr, &n)) {
+		exe_log(FCOM_LOG_SYSERR, "server: getsockopt(SO_PEERCRED)");
+		return 0;
+	}
+	uid = cr.uid;
+#else
+	gid_t gid;
+	if (0 != getpeereid(sk, &uid, &gid)) {
+		exe_log(FCOM_LOG_SYSERR, "server: getpeereid");
+		return 0;
+	}
+#endif
+
+	if (uid != getuid()) {
+		exe_log(FCOM_LOG_ERR, "server: rejected client of user %u", (uint)uid);
+		return 0;
+	}
+	return 1;
+}
+
+/** Read the request from the current client; start the operation when it's complete.
+Return 0: the client is done or still sending;  -1: the client is closed */
+static int srv_client_read()
+{
+	int r = srv_recv();
+	if (r < 0) {
+		srv_client_close();
+		return -1;
+	}
+	if (r == 0) {
+		srv->ctmr_active = 0;
+		m->core->timer(&srv->ctmr, 0, NULL, NULL);
+		srv_op_start();
+	}
+	return 0;
+}
+
+/** Client's socket is readable */
+static void srv_client_ev(void *param)
+{
+	if (srv->csock < 0 || srv->recv_st == SRV_RECV_DONE)
+		return;
+	if (srv_client_read())
+		srv_accept(NULL);
+}
+
+static void srv_client_timeout(void *param)
+{
+	srv->ctmr_active = 0;
+	if (srv->csock < 0 || srv->recv_st == SRV_RECV_DONE)
+		return;
+	exe_log(FCOM_LOG_ERR, "server: client timed out");
+	srv_client_close();
+	srv_accept(NULL);
+}
+
+/** Accept the next client (if not busy) */
+static void srv_accept(void *param)
+{
+	while (srv->csock < 0) {
+		int sk = accept4(srv->lsock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (sk < 0) {
+			if (errno != EAGAIN && errno != EINTR)
+				exe_log(FCOM_LOG_SYSERR, "server: accept");
+			if (errno != EINTR)
+				return;
+			continue;
+		}
+
+		if (!srv_peer_allowed(sk)) {
+			close(sk);
+			continue;
+		}
+
+		srv->csock = sk;
+		fcom_kevent_set(&srv->ckev, srv_client_ev, NULL);
+		if (0 != m->core->kq_attach(sk, &srv->ckev, FFKQ_READ)) {
+			exe_log(FCOM_LOG_SYSERR, "server: kq attach");
+			srv_client_close();
+			continue;
+		}
+		srv->ctmr_active = 1;
+		m->core->timer(&srv->ctmr, -SRV_RECV_TIMEOUT_SEC * 1000, srv_client_timeout, NULL);
+
+		srv_client_read();
+	}
+}
+
+static void srv_accept_task(void *param)
+{
+	srv->task_active = 0;
+	srv_accept(NULL);
+}
+
+/** Listen for clients */
+static int server_start()
+{
+	srv = ffmem_new(struct server);
+	srv->lsock = -1;
+	srv->csock = -1;
+	for (uint i = 0;  i != 3;  i++) {
+		srv->fd_client[i] = -1;
+		srv->fd_saved[i] = fcntl(i, F_DUPFD_CLOEXEC, 3);
+	}
+	srv->path = srv_path();
+
+	struct sockaddr_un a;
+	if (srv_addr(&a, srv->path))
+		return -1;
+
+	if (0 > (srv->lsock = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0))) {
+		exe_log(FCOM_LOG_SYSERR, "socket");
+		return -1;
+	}
+
+	unlink(srv->path); // a stale socket file from the previous instance
+	mode_t um = umask(077); // the socket file is never accessible by the other users
+	int r = bind(srv->lsock, (struct sockaddr*)&a, sizeof(a));
+	umask(um);
+	if (r != 0) {
+		exe_log(FCOM_LOG_SYSERR, "bind: %s", srv->path);
+		return -1;
+	}
+
+	if (0 != listen(srv->lsock, 64)) {
+		exe_log(FCOM_LOG_SYSERR, "listen: %s", srv->path);
+		return -1;
+	}
+
+	// a client may disconnect while its operation is writing to the pipe
+	signal(SIGPIPE, SIG_IGN);
+
+	fcom_kevent_set(&srv->kev, srv_accept, NULL);
+	if (0 != m->core->kq_attach(srv->lsock, &srv->kev, FFKQ_READ)) {
+		exe_log(FCOM_LOG_SYSERR, "kq attach");
+		return -1;
+	}
+
+	exe_log(FCOM_LOG_INFO, "server: listening on %s", srv->path);
+	return 0;
+}
+
+static void server_free()
+{
+	if (srv == NULL)
+		return;
+
+	if (srv->csock >= 0)
+		srv_client_close();
+	if (srv->lsock >= 0) {
+		close(srv->lsock);
+		unlink(srv->path);
+	}
+	for (uint i = 0;  i != 3;  i++) {
+		if (srv->fd_saved[i] >= 0)
+			close(srv->fd_saved[i]);
+	}
+	ffvec_free(&srv->data);
+	ffmem_free(srv->path);
+	ffmem_free(srv);
+	srv = NULL;
+}
+
+/** Pass the command line, current directory and standard descriptors to the server
+ and wait until the operation is complete.
+Return operation's exit code */
+static int client_run(uint argc, char **argv)
+{
+	int ec = 1, sk = -1;
+	char *path = srv_path();
+	ffvec d = {};
+	char cwd[4096];
+
+	struct sockaddr_un a;
+	if (srv_addr(&a, path))
+		goto end;
+
+	if (NULL == getcwd(cwd, sizeof(cwd))) {
+		exe_log(FCOM_LOG_SYSERR, "getcwd");
+		goto end;
+	}
+
+	ffvec_addsz(&d, cwd);
+	ffvec_addchar(&d, '\0');
+	for (uint i = 0;  i != argc;  i++) {
+		ffvec_addsz(&d, argv[i]);
+		ffvec_addchar(&d, '\0');
+	}
+	if (d.len > SRV_DATA_MAX) {
+		exe_log(FCOM_LOG_ERR, "command line is too long");
+		goto end;
+	}
+
+	if (0 > (sk = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0))) {
+		exe_log(FCOM_LOG_SYSERR, "socket");
+		goto end;
+	}
+	if (0 != connect(sk, (struct sockaddr*)&a, sizeof(a))) {
+		exe_log(FCOM_LOG_SYSERR, "connect: %s", path);
+		goto end;
+	}
+
+	struct srv_hdr h;
+	ffmem_copy(h.magic, SRV_MAGIC, 4);
+	h.size = d.len;
+	struct iovec iov[2] = {
+		{ &h, sizeof(h) },
+		{ d.ptr, d.len },
+	};
+
+	union {
+		struct cmsghdr hdr;
+		char buf[CMSG_SPACE(3 * sizeof(int))];
+	} ctl = {};
+	struct msghdr msg = {
+		.msg_iov = iov,
+		.msg_iovlen = 2,
+		.msg_control = ctl.buf,
+		.msg_controllen = sizeof(ctl.buf),
+	};
+	struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+	c->cmsg_level = SOL_SOCKET;
+	c->cmsg_type = SCM_RIGHTS;
+	c->cmsg_len = CMSG_LEN(3 * sizeof(int));
+	static const int fds[3] = { 0, 1, 2 };
+	ffmem_copy(CMSG_DATA(c), fds, sizeof(fds));
+
+	if ((ssize_t)(sizeof(h) + d.len) != sendmsg(sk, &msg, MSG_NOSIGNAL)) {
+		exe_log(FCOM_LOG_SYSERR, "sendmsg: %s", path);
+		goto end;
+	}
+
+	int r;
+	if (sizeof(r) != recv(sk, &r, sizeof(r), MSG_WAITALL)) {
+		exe_log(FCOM_LOG_ERR, "server closed the connection");
+		goto end;
+	}
+	ec = r;
+
+end:
+	if (sk >= 0)
+		close(sk);
+	ffvec_free(&d);
+	ffmem_free(path);
+	return ec;
+}
+
+#endif
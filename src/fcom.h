@@ -3,9 +3,12 @@
 #pragma once
 #include <ffsys/error.h>
 #include <util/taskqueue.h>
+#include <ffbase/list.h>
+#include <ffbase/lock.h>
 #include <ffsys/file.h>
 #include <ffsys/timerqueue.h>
 #include <ffsys/time.h>
+#include <ffsys/perf.h>
 #include <ffbase/vector.h>
 #include <ffbase/args.h>
 #include <assert.h>
@@ -13,7 +16,7 @@
 #undef stdout
 
 #define FCOM_VER "1.0.26"
-#define FCOM_CORE_VER 10025
+#define FCOM_CORE_VER 10026
 
 typedef unsigned char byte;
 typedef unsigned char u_char;
@@ -53,9 +56,13 @@ struct fcom_core_conf {
 	char *app_path;
 	fcom_log_func log;
 	uint codepage;
+	uint workers; // max. number of worker threads (0: number of CPUs)
 	uint debug :1;
 	uint verbose :1;
 	uint stdout_color :1;
+	uint stats :1; // print performance counters on exit
+	uint stats_json :1; // print performance counters in JSON format
+	uint hugepages :1; // use huge pages for large I/O buffers
 };
 
 /** Core initializer.
@@ -84,6 +91,53 @@ static inline void fcom_kevent_set(fcom_kevent *kev, fcom_task_func func, void *
 	kev->param = param;
 }
 
+/** Job for the worker thread pool */
+typedef struct fcom_job {
+	fcom_task_func func; // called in a worker thread
+	fcom_task_func on_complete; // [optional] called in the main thread after func() returns
+	void *param;
+	const void *owner; // operation object, for cancellation
+	uint cancelled; // set if the job was cancelled before it started
+
+	fcom_task task;
+	ffchain_item sib;
+} fcom_job;
+
+static inline void fcom_job_set(fcom_job *j, fcom_task_func func, fcom_task_func on_complete, void *param, const void *owner)
+{
+	j->func = func;
+	j->on_complete = on_complete;
+	j->param = param;
+	j->owner = owner;
+}
+
+/** Keystream generator state */
+typedef struct fcom_keystream {
+	uint state[16];
+	u_char rest[64]; // the last block
+	uint rest_off; // unused data in `rest`
+} fcom_keystream;
+
+/** Performance counters */
+enum FCOM_STAT {
+	FCOM_STAT_FILES, // input file names processed
+	FCOM_STAT_CACHE_HITS, // file read: data was found in cache
+	FCOM_STAT_CACHE_MISSES,
+	FCOM_STAT_BUF_NEW, // I/O buffer pool: allocated from system
+	FCOM_STAT_BUF_REUSED, // I/O buffer pool: taken from free list
+	FCOM_STAT_BUF_PEAK_KB, // I/O buffer pool: max. size of buffers in use
+	_FCOM_STAT_N,
+};
+
+/** Performance counters with latency histogram */
+enum FCOM_STAT_OP {
+	FCOM_STAT_READ,
+	FCOM_STAT_WRITE,
+	FCOM_STAT_META, // open, close, get info, create directory, rename, delete, etc.
+	FCOM_STAT_CODEC, // compression, hashing, encryption, etc.
+	_FCOM_STAT_OP_N,
+};
+
 enum FCOM_CORE_CLOCK {
 	FCOM_CORE_MONOTONIC,
 	FCOM_CORE_UTC,
@@ -131,10 +185,41 @@ struct fcom_core {
 	/** Get random number */
 	uint (*random)();
 
+	/** Initialize pseudo-random data generator (ChaCha20 keystream).
+	The same seed produces the same data.
+	seed: 32 bytes;  NULL: random seed from the system */
+	void (*keystream_init)(fcom_keystream *ks, const void *seed);
+
+	/** Fill buffer with the next portion of the keystream.
+	Thread-safe for different objects. */
+	void (*keystream)(fcom_keystream *ks, void *buf, ffsize len);
+
+	/** Add job to the worker thread pool.  Thread-safe.
+	job.func() is called in a worker thread, then job.on_complete() is called in the main thread. */
+	void (*job)(fcom_job *job);
+
+	/** Remove from the queue all jobs of this owner.
+	Cancelled jobs are completed via on_complete() with `cancelled` flag set.
+	The jobs that are already running aren't affected.
+	Called automatically for an operation object before fcom_operation.signal(). */
+	void (*job_cancel)(const void *owner);
+
+	/** Max. number of worker threads */
+	uint workers;
+
+	/** Add value to a performance counter.  Thread-safe.
+	id: enum FCOM_STAT */
+	void (*stat_add)(uint id, uint64 val);
+
+	/** Count an operation that started at `t1` (fftime_monotonic()).  Thread-safe.
+	op: enum FCOM_STAT_OP */
+	void (*stat_op)(uint op, const fftime *t1, uint64 bytes);
+
 	uint debug :1;
 	uint verbose :1;
 	uint stdout_color :1;
 	uint stdout_busy :1;
+	uint stats :1; // performance counters are enabled
 };
 
 #define fcom_sysfatlog(fmt, ...)  (core)->log(FCOM_LOG_FATAL | FCOM_LOG_SYSERR, fmt, ##__VA_ARGS__)
@@ -149,6 +234,16 @@ struct fcom_core {
 #define fcom_dbglog(fmt, ...) \
 	do { if (core->debug) (core)->log(FCOM_LOG_DBG, fmt, ##__VA_ARGS__); } while (0)
 
+/** Measure the time of an operation (if performance counters are enabled):
+fftime t;
+fcom_stat_begin(&t);
+...
+fcom_stat_end(FCOM_STAT_CODEC, &t, bytes); */
+#define fcom_stat_begin(t) \
+	do { if (core->stats) *(t) = fftime_monotonic(); } while (0)
+#define fcom_stat_end(op, t, bytes) \
+	do { if (core->stats) (core)->stat_op(op, t, bytes); } while (0)
+
 
 // COMMAND
 
@@ -214,6 +309,14 @@ enum FCOM_COM_IA {
 	FCOM_COM_IA_AUTO, // detect from file name
 };
 
+enum FCOM_COM_FT {
+	FCOM_COM_FT_UNKNOWN, // get file info to find out
+	FCOM_COM_FT_FILE,
+	FCOM_COM_FT_DIR,
+	FCOM_COM_FT_LINK,
+	FCOM_COM_FT_OTHER,
+};
+
 enum FCOM_COM_AP {
 	/** Use global command-line arguments for input/output. */
 	FCOM_COM_AP_INOUT = 1,
@@ -263,6 +366,10 @@ struct fcom_command {
 	/** Parse command-line arguments
 	flags: enum FCOM_COM_AP */
 	int (*args_parse)(fcom_cominfo *cmd, const struct ffarg *args, void *obj, uint flags);
+
+	/** Get type of the file returned by input_next(), as reported by the directory scan (without stat()).
+	Return enum FCOM_COM_FT */
+	uint (*input_type)(fcom_cominfo *c);
 };
 
 
@@ -353,6 +460,10 @@ enum FCOM_FILE_OPEN {
 	FCOM_FILE_INFO_NOFOLLOW = 0x0200, // info(): don't follow symlinks
 	FCOM_FILE_READAHEAD = 0x0400, // Windows: enable "read-ahead"
 	FCOM_FILE_NOCACHE = 0x0800,
+	/** read(): return data directly from the memory-mapped file, without copying.
+	The data returned by read() remains valid until the read() after the next one.
+	Ignored for stdin, direct I/O and if not supported. */
+	FCOM_FILE_MMAP = 0x2000,
 };
 
 static inline uint fcom_file_cominfo_flags_i(fcom_cominfo *cmd)
@@ -472,6 +583,13 @@ struct fcom_file {
 
 	/** Delete file */
 	int (*del)(const char *name, uint flags);
+
+	/** Copy data from another file inside the kernel, without reading it into user space.
+	src_off: offset in `src`
+	off: -1: use the current offset
+	Return N of bytes copied (<size: the caller writes the rest via write());
+	  <0: error */
+	ffssize (*copy)(fcom_file_obj *f, fcom_file_obj *src, uint64 src_off, uint64 size, int64 off);
 };
 
 static inline fftime fffileinfo_mtime1(const fffileinfo *fi)
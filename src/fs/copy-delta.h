@@ -0,0 +1,348 @@
+/** fcom: copy: rewrite only the changed blocks of the existing target file
+2026, Simon Zolin */
+
+/*
+--delta:
+The output data is split into blocks of DELTA_BLOCK bytes.
+Each block is compared with the same block of the existing target file,
+ and only the blocks that differ are written.
+The target file is read by a separate file object with its own read-ahead,
+ so the source and the target are read at the same time,
+ and the read buffer never sees the data written by us.
+The target isn't preallocated: its size is set after the last block.
+A rolling hash isn't used: the data is written in-place, so a block can't be moved.
+
+--delta-hashes DIR:
+MD5 of each block is saved to DIR/HASH.blkhash, where HASH is the hash of the absolute target path.
+The file is valid while the target's path, size and modification time are the same.
+Next time the blocks are compared with the saved hashes and the target isn't read at all.
+The file is written to a temporary file first and then renamed.
+
+Format (host byte order):
+	struct delta_hdr
+	char path[path_len], padding
+	byte md5[n][16]
+*/
+
+#include <ffbase/murmurhash3.h>
+
+#define DELTA_BLOCK  (1*1024*1024)
+#define DELTA_MAGIC  "fcomblk\x01"
+
+struct delta_hdr {
+	char magic[8];
+	uint64 size;
+	int64 mtime_sec;
+	uint mtime_nsec;
+	uint block;
+	uint64 n;
+	uint path_len;
+	uint reserved;
+};
+
+static int delta_init(struct copy *c)
+{
+	if (c->delta_hashes.len != 0)
+		c->delta = 1;
+	if (!c->delta) return 0;
+
+	if (c->cmd->stdout) {
+		fcom_errlog("STDOUT output can't be used with --delta");
+		return -1;
+	}
+	c->write_into = 1;
+
+	struct fcom_file_conf fc = {};
+	fc.buffer_size = c->cmd->buffer_size;
+	fc.n_buffers = 1;
+	c->dl.t = core->file->create(&fc);
+
+	if (c->delta_hashes.len != 0) {
+		if (!(c->dl.md5 = (fcom_hash*)core->com->provide("md5.fcom_md5", 0)))
+			return -1;
+		struct fcom_file_conf fc = {};
+		c->dl.cache = core->file->create(&fc);
+	}
+
+	ffvec_alloc(&c->dl.buf, DELTA_BLOCK, 1);
+	return 0;
+}
+
+static void delta_reset(struct copy *c)
+{
+	if (c->dl.t == NULL) return;
+
+	c->dl.active = 0;
+	c->dl.cmp = 0;
+	c->dl.written = 0;
+	c->dl.buf.len = 0;
+	c->dl.hashes.len = 0;
+	ffstr_null(&c->dl.old);
+	core->file->close(c->dl.t);
+	if (c->dl.cache != NULL)
+		core->file->close(c->dl.cache);
+	ffmem_free0(c->dl.cache_fn);
+	ffstr_free(&c->dl.path);
+}
+
+static void delta_close(struct copy *c)
+{
+	delta_reset(c);
+	core->file->destroy(c->dl.t);
+	core->file->destroy(c->dl.cache);
+	ffvec_free(&c->dl.buf);
+	ffvec_free(&c->dl.hashes);
+}
+
+/** Get the absolute target path and the hash file name */
+static int delta_cache_name(struct copy *c)
+{
+	ffvec p = {};
+#ifdef FF_UNIX
+	char cwd[4096];
+	if (!ffpath_abs(c->o.name, ffsz_len(c->o.name))
+		&& NULL != getcwd(cwd, sizeof(cwd)))
+		ffvec_addfmt(&p, "%s/", cwd);
+#endif
+	ffvec_addsz(&p, c->o.name);
+	ffvec_grow(&p, 1, 1);
+	int r = ffpath_normalize(p.ptr, p.cap, p.ptr, p.len, 0);
+	if (r <= 0) {
+		ffvec_free(&p);
+		return -1;
+	}
+	p.len = r;
+
+	ffstr_set(&c->dl.path, p.ptr, p.len);
+	c->dl.cache_fn = ffsz_allocfmt("%S%c%08xu.blkhash"
+		, &c->delta_hashes, FFPATH_SLASH, murmurhash3(p.ptr, p.len, 0x626c6b68));
+	return 0;
+}
+
+/** Map the hash file and check that it's valid for the current target */
+static void delta_cache_load(struct copy *c)
+{
+	fffileinfo fi;
+	if (0 != fffile_info_path(c->dl.cache_fn, &fi))
+		return; // no hashes yet
+	if (FCOM_FILE_OK != core->file->open(c->dl.cache, c->dl.cache_fn, FCOM_FILE_READ | FCOM_FILE_MMAP))
+		return;
+
+	ffstr d;
+	if (FCOM_FILE_OK != core->file->read(c->dl.cache, &d, 0)
+		|| d.len != fffileinfo_size(&fi)
+		|| d.len < sizeof(struct delta_hdr))
+		goto fail;
+
+	const struct delta_hdr *h = (void*)d.ptr;
+	fftime mt = fffileinfo_mtime1(&c->o.fi);
+	ffsize off = ffint_align_ceil2(sizeof(struct delta_hdr) + h->path_len, 8);
+	if (ffmem_cmp(h->magic, DELTA_MAGIC, 8)
+		|| h->block != DELTA_BLOCK
+		|| h->size != fffileinfo_size(&c->o.fi)
+		|| h->mtime_sec != mt.sec
+		|| h->mtime_nsec != mt.nsec
+		|| h->path_len != c->dl.path.len
+		|| off > d.len // the path and the padding must be inside the file
+		|| ffmem_cmp(h + 1, c->dl.path.ptr, h->path_len)
+		|| h->n != (h->size + DELTA_BLOCK - 1) / DELTA_BLOCK
+		|| h->n * 16 != d.len - off)
+		goto fail;
+
+	ffstr_set(&c->dl.old, d.ptr + off, h->n * 16);
+	fcom_dbglog("%s: using block hashes: %U blocks", c->dl.cache_fn, h->n);
+	return;
+
+fail:
+	fcom_dbglog("%s: block hashes are stale", c->dl.cache_fn);
+	core->file->close(c->dl.cache);
+}
+
+/** Save the hashes of all blocks of the new target */
+static void delta_cache_save(struct copy *c)
+{
+	if (c->dl.cache_fn == NULL) return;
+
+	fffileinfo fi;
+	if (0 != fffile_info_path(c->o.name, &fi)) {
+		fcom_syswarnlog("fffile_info_path: %s", c->o.name);
+		return;
+	}
+
+	struct delta_hdr h = {};
+	ffmem_copy(h.magic, DELTA_MAGIC, 8);
+	h.size = fffileinfo_size(&fi);
+	fftime mt = fffileinfo_mtime1(&fi);
+	h.mtime_sec = mt.sec;
+	h.mtime_nsec = mt.nsec;
+	h.block = DELTA_BLOCK;
+	h.n = c->dl.hashes.len / 16;
+	h.path_len = c->dl.path.len;
+	if (h.n != (h.size + DELTA_BLOCK - 1) / DELTA_BLOCK)
+		return;
+	ffsize off = ffint_align_ceil2(sizeof(struct delta_hdr) + h.path_len, 8);
+
+	ffvec d = {};
+	ffvec_alloc(&d, off + c->dl.hashes.len, 1);
+	ffmem_zero(d.ptr, off);
+	ffmem_copy(d.ptr, &h, sizeof(h));
+	ffmem_copy((char*)d.ptr + sizeof(h), c->dl.path.ptr, h.path_len);
+	ffmem_copy((char*)d.ptr + off, c->dl.hashes.ptr, c->dl.hashes.len);
+	d.len = off + c->dl.hashes.len;
+
+	char *tmp = ffsz_allocfmt("%s.%xu.tmp", c->dl.cache_fn, core->random());
+	ffstr_null(&c->dl.old);
+	core->file->close(c->dl.cache);
+	if (FCOM_FILE_ERR == core->file->open(c->dl.cache, tmp, FCOM_FILE_WRITE | FCOM_FILE_CREATE_TRUNC | FCOM_FILE_NO_PREALLOC))
+		goto end;
+	ffstr s = FFSTR_INITSTR(&d);
+	int r = core->file->write(c->dl.cache, s, 0);
+	if (r == FCOM_FILE_OK)
+		r = core->file->flush(c->dl.cache, 0);
+	core->file->close(c->dl.cache);
+	if (r != FCOM_FILE_OK
+		|| 0 != core->file->move(FFSTR_Z(tmp), FFSTR_Z(c->dl.cache_fn), 0)) {
+		core->file->del(tmp, 0);
+		goto end;
+	}
+	fcom_dbglog("%s: saved block hashes: %U blocks", c->dl.cache_fn, h.n);
+
+end:
+	ffmem_free(tmp);
+	ffvec_free(&d);
+}
+
+/** Prepare to compare the data with the existing target.
+Return 1: the target must not be preallocated */
+static int delta_open(struct copy *c)
+{
+	if (!c->delta || c->cmd->test) return 0;
+
+	c->dl.active = 1;
+	if (c->delta_hashes.len != 0) {
+		ffvec_grow(&c->dl.hashes, (fffileinfo_size(&c->fi) + DELTA_BLOCK - 1) / DELTA_BLOCK * 16, 1);
+		if (delta_cache_name(c))
+			return -1;
+	}
+
+	if (0 == fffileinfo_size(&c->o.fi))
+		return 0; // new file: write all blocks
+
+	if (c->delta_hashes.len != 0)
+		delta_cache_load(c);
+
+	if (c->dl.old.len == 0) {
+		uint flags = FCOM_FILE_READ | FCOM_FILE_READAHEAD;
+		if (FCOM_FILE_ERR == core->file->open(c->dl.t, c->o.name, flags))
+			return -1;
+		core->file->behaviour(c->dl.t, FCOM_FBEH_SEQ);
+	}
+
+	c->dl.cmp = 1;
+	return 1;
+}
+
+/** Compare the block with the target file's data.
+Return 1: equal;  0: differ;  <0: error */
+static int delta_target_cmp(struct copy *c, ffstr blk, uint64 off)
+{
+	while (blk.len != 0) {
+		ffstr d;
+		int r = core->file->read(c->dl.t, &d, off);
+		if (r == FCOM_FILE_ERR)
+			return -1;
+		if (r == FCOM_FILE_EOF)
+			return 0;
+		ffsize n = ffmin(d.len, blk.len);
+		if (ffmem_cmp(d.ptr, blk.ptr, n))
+			return 0;
+		ffstr_shift(&blk, n);
+		off += n;
+	}
+	return 1;
+}
+
+/** Write the block if it differs from the target's block */
+static int delta_block(struct copy *c, ffstr blk)
+{
+	uint64 off = c->o.off;
+	int same = 0;
+
+	if (c->dl.md5 != NULL) {
+		byte h[16];
+		fcom_hash_obj *ho = c->dl.md5->create();
+		c->dl.md5->update(ho, blk.ptr, blk.len);
+		c->dl.md5->fin(ho, h, 16);
+		c->dl.md5->close(ho);
+		ffvec_add(&c->dl.hashes, h, 16, 1);
+
+		uint64 i = off / DELTA_BLOCK * 16;
+		if (i < c->dl.old.len)
+			same = !ffmem_cmp(c->dl.old.ptr + i, h, 16);
+	}
+
+	if (c->dl.cmp && c->dl.old.len == 0) {
+		if (0 > (same = delta_target_cmp(c, blk, off)))
+			return 0xbad;
+	}
+
+	if (!same) {
+		if (FCOM_FILE_ERR == core->file->write(c->o.f, blk, off))
+			return 0xbad;
+		c->dl.written += blk.len;
+	}
+
+	c->o.off += blk.len;
+	c->o.total += blk.len;
+	return 0;
+}
+
+static int delta_write(struct copy *c, ffstr input)
+{
+	while (input.len != 0) {
+		if (c->dl.buf.len == 0 && input.len >= DELTA_BLOCK) {
+			ffstr blk = FFSTR_INITN(input.ptr, DELTA_BLOCK);
+			if (delta_block(c, blk))
+				return 0xbad;
+			ffstr_shift(&input, DELTA_BLOCK);
+			continue;
+		}
+
+		ffsize n = ffmin(input.len, DELTA_BLOCK - c->dl.buf.len);
+		ffvec_add(&c->dl.buf, input.ptr, n, 1);
+		ffstr_shift(&input, n);
+		if (c->dl.buf.len == DELTA_BLOCK) {
+			ffstr blk = FFSTR_INITSTR(&c->dl.buf);
+			if (delta_block(c, blk))
+				return 0xbad;
+			c->dl.buf.len = 0;
+		}
+	}
+	return 0;
+}
+
+/** Process the last block and set the target's size */
+static int delta_fin(struct copy *c)
+{
+	if (!c->dl.active) return 0;
+
+	if (c->dl.buf.len != 0) {
+		ffstr blk = FFSTR_INITSTR(&c->dl.buf);
+		if (delta_block(c, blk))
+			return 0xbad;
+		c->dl.buf.len = 0;
+	}
+
+	if (c->dl.cmp) {
+		if (FCOM_FILE_ERR == core->file->flush(c->o.f, 0))
+			return 0xbad;
+		if (0 != fffile_trunc(core->file->fd(c->o.f, 0), c->o.off)) {
+			fcom_syserrlog("fffile_trunc: %s", c->o.name);
+			return 0xbad;
+		}
+	}
+
+	fcom_verblog("%s: delta: written %,U of %,U bytes"
+		, c->o.name, c->dl.written, c->o.total);
+	return 0;
+}
@@ -211,7 +211,12 @@ static int output_open(struct copy *c)
 			}
 		}
 
-		if (FCOM_FILE_ERR == core->file->trunc(c->o.f, fffileinfo_size(&c->fi)))
+		r = delta_open(c);
+		if (r < 0)
+			return 0xbad;
+
+		if (r == 0
+			&& FCOM_FILE_ERR == core->file->trunc(c->o.f, fffileinfo_size(&c->fi)))
 			return 0xbad;
 	}
 
@@ -222,6 +227,9 @@ static int output_open(struct copy *c)
 
 static int output_write(struct copy *c, ffstr input)
 {
+	if (c->dl.active)
+		return delta_write(c, input);
+
 	int r = core->file->write(c->o.f, input, c->o.off);
 	if (r == FCOM_FILE_ERR) return 0xbad;
 	c->o.off += input.len;
@@ -27,6 +27,12 @@ OPTIONS:\n\
                           Use with `--update`.\n\
         `--write-into`\n\
                         Overwrite file data instead of deleting the old target\n\
+        `--delta`         Write only the blocks that differ from the existing target.\n\
+                          Implies `--write-into`.\n\
+        `--delta-hashes` DIR\n\
+                        Save the hashes of the target's blocks to DIR,\n\
+                          so the next `--delta` run doesn't read the target.\n\
+                          Implies `--delta`.\n\
 ";
 }
 
@@ -83,7 +89,22 @@ struct copy {
 		byte md5_result_r[16];
 	} vf;
 
+	struct {
+		fcom_file_obj *t; // target file for reading
+		fcom_file_obj *cache;
+		char *cache_fn;
+		ffstr path; // absolute target path
+		const fcom_hash *md5;
+		ffvec buf; // incomplete block
+		ffvec hashes; // new MD5 of each block: byte[16][]
+		ffstr old; // saved MD5 of each block
+		uint64 written;
+		uint active :1;
+		uint cmp :1; // compare with the existing target
+	} dl;
+
 	ffstr encrypt, decrypt;
+	ffstr delta_hashes;
 	u_char verify;
 	u_char print_md5;
 	u_char preserve_date;
@@ -91,6 +112,7 @@ struct copy {
 	u_char replace_date;
 	u_char update;
 	u_char write_into;
+	u_char delta;
 };
 
 static int copy_input_next(struct copy *c)
@@ -149,6 +171,8 @@ static int args_parse(struct copy *c, fcom_cominfo *cmd)
 
 	static const struct ffarg args[] = {
 		{ "--decrypt",		'S',	O(decrypt) },
+		{ "--delta",		'1',	O(delta) },
+		{ "--delta-hashes",	'S',	O(delta_hashes) },
 		{ "--encrypt",		'S',	O(encrypt) },
 		{ "--md5",			'1',	O(print_md5) },
 		{ "--rename-source",'1',	O(rename_source) },
@@ -185,6 +209,7 @@ static int args_parse(struct copy *c, fcom_cominfo *cmd)
 
 static void copy_run(fcom_op *op);
 #include <fs/copy-crypt.h>
+#include <fs/copy-delta.h>
 #include <fs/copy-output.h>
 #include <fs/copy-verify.h>
 
@@ -193,6 +218,7 @@ static void copy_close(fcom_op *op)
 	struct copy *c = (struct copy*)op;
 	crypt_close(c);
 	verify_reset(c);
+	delta_close(c);
 	output_close(c);
 	core->file->destroy(c->input);
 	ffmem_free(c);
@@ -213,6 +239,7 @@ static fcom_op* copy_create(fcom_cominfo *cmd)
 	c->input = core->file->create(&fc);
 	}
 
+	if (delta_init(c)) goto end;
 	if (output_init(c)) goto end;
 	if (crypt_init(c)) goto end;
 	if (verify_init(c)) goto end;
@@ -229,6 +256,7 @@ static void copy_reset(struct copy *c)
 	c->in_off = 0;
 	crypt_reset(c);
 	verify_reset(c);
+	delta_reset(c);
 	output_reset(c);
 	ffmem_free0(c->iname);
 }
@@ -324,6 +352,7 @@ static void copy_run(fcom_op *op)
 			continue;
 
 		case I_RD_DONE:
+			if (delta_fin(c)) goto end;
 			core->file->behaviour(c->o.f, FCOM_FBEH_TRUNC_PREALLOC);
 			if (c->preserve_date) {
 				core->file->mtime_set(c->o.f, fffileinfo_mtime1(&c->fi));
@@ -356,6 +385,8 @@ static void copy_run(fcom_op *op)
 			if (r == 'asyn') return;
 			if (r != 0) goto end;
 
+			if (c->dl.active)
+				delta_cache_save(c);
 			copy_complete(c);
 
 			c->st = I_SRC;
@@ -0,0 +1,219 @@
+/** fcom: list: output formatting and sorting
+2026, Simon Zolin */
+
+/*
+The output data is formatted directly into the output buffer,
+ which is written to stdout when it's 3/4 full.
+The date string is cached for the entries with the same modification time (to the second).
+--sort: the entries are sorted by a compact array of (KEY, INDEX) pairs:
+ KEY for "name" is the first 8 bytes of the name (big-endian), the full names are compared only on a tie;
+ KEY for "mtime" is (UNIX_SECONDS << 30) | NSEC;
+ KEY for "size" is the file size.
+*/
+
+/** Date string "yyyy-mm-dd hh:mm:ss.uuuuuu"
+Return N of bytes written */
+static uint list_date(struct list *l, fftime t, char *dst)
+{
+	if (l->date.len == 0 || l->date.sec != t.sec) {
+		ffdatetime dt;
+		fftime_split1(&dt, &t);
+		l->date.len = fftime_tostr1(&dt, l->date.s, sizeof(l->date.s), FFTIME_DATE_YMD | FFTIME_HMS);
+		l->date.sec = t.sec;
+	}
+
+	char *p = dst;
+	ffmem_copy(p, l->date.s, l->date.len);
+	p += l->date.len;
+	*p++ = '.';
+	p += ffs_fromint(t.nsec / 1000, p, 6, FFS_INTWIDTH(6) | FFS_INTZERO);
+	return p - dst;
+}
+
+/** Add JSON string (without quotes) */
+static void list_json_str(ffvec *b, ffstr s)
+{
+	static const char hex[] = "0123456789abcdef";
+	ffvec_grow(b, s.len * 6, 1);
+	char *p = ffslice_end(b, 1);
+
+	for (ffsize i = 0;  i != s.len;  i++) {
+		uint c = (u_char)s.ptr[i];
+		switch (c) {
+		case '"':
+		case '\\':
+			*p++ = '\\';  *p++ = c;  break;
+		case '\n':
+			*p++ = '\\';  *p++ = 'n';  break;
+		case '\r':
+			*p++ = '\\';  *p++ = 'r';  break;
+		case '\t':
+			*p++ = '\\';  *p++ = 't';  break;
+		default:
+			if (c < 0x20) {
+				*p++ = '\\';  *p++ = 'u';  *p++ = '0';  *p++ = '0';
+				*p++ = hex[c >> 4];  *p++ = hex[c & 0x0f];
+				break;
+			}
+			*p++ = c;
+		}
+	}
+
+	b->len = p - (char*)b->ptr;
+}
+
+/* {"name":"NAME","dir":BOOL[,"size":N,"mtime":UNIX_SECONDS]} */
+static void list_out_json(struct list *l, const struct list_ent *e, ffstr name)
+{
+	ffvec *b = &l->buf;
+	ffvec_addsz(b, "{\"name\":\"");
+	list_json_str(b, name);
+	ffvec_addsz(b, (e->dir) ? "\",\"dir\":true" : "\",\"dir\":false");
+	if (l->need_info && e->have_info) {
+		ffvec_addfmt(b, ",\"size\":%U,\"mtime\":%D"
+			, e->size, e->mtime.sec - FFTIME_1970_SECONDS);
+	}
+	ffvec_addsz(b, "}\n");
+}
+
+/* "size date name" */
+static void list_out_long(struct list *l, const struct list_ent *e, ffstr name)
+{
+	ffvec *b = &l->buf;
+	ffvec_grow(b, 64 + name.len + l->eol.len, 1);
+	char *p = ffslice_end(b, 1), *start = p;
+
+	p += ffs_fromint(e->size, p, 20, FFS_INTWIDTH(12));
+	*p++ = ' ';
+	p += list_date(l, e->mtime, p);
+	*p++ = ' ';
+	ffmem_copy(p, name.ptr, name.len);
+	p += name.len;
+	ffmem_copy(p, l->eol.ptr, l->eol.len);
+	p += l->eol.len;
+
+	b->len += p - start;
+}
+
+static void list_out(struct list *l, const struct list_ent *e)
+{
+	ffstr name = FFSTR_INITN((char*)l->names.ptr + e->name_off, e->name_len);
+	if (l->skip_prefix)
+		ffstr_shift(&name, 2);
+
+	if (l->json) {
+		list_out_json(l, e, name);
+
+	} else if (l->long_fmt) {
+		list_out_long(l, e, name);
+
+	} else if (l->one_line && !l->zero) {
+		if (ffstr_findchar(&name, '"') >= 0)
+			fcom_warnlog("file name '%S' contains double-quote character", &name);
+		ffvec_grow(&l->buf, name.len + 3, 1);
+		ffvec_addchar(&l->buf, '"');
+		ffvec_addstr(&l->buf, &name);
+		ffvec_addsz(&l->buf, "\" ");
+
+	} else {
+		ffvec_grow(&l->buf, name.len + l->eol.len, 1);
+		ffvec_addstr(&l->buf, &name);
+		ffvec_addstr(&l->buf, &l->eol);
+	}
+}
+
+static void list_display(struct list *l, int force)
+{
+	if (l->buf.len != 0
+		&& (force || l->buf.len >= l->out_flush)) {
+		ffstdout_write(l->buf.ptr, l->buf.len);
+		l->buf.len = 0;
+	}
+}
+
+struct list_key {
+	uint64 key;
+	uint i;
+};
+
+static int list_key_cmp(const void *_a, const void *_b, void *udata)
+{
+	const struct list_key *a = _a, *b = _b;
+	const struct list *l = udata;
+
+	if (a->key != b->key)
+		return (a->key < b->key) ? -1 : 1;
+
+	if (l->sort == LIST_SORT_NAME) {
+		const struct list_ent *ea = ffslice_itemT(&l->ents, a->i, struct list_ent);
+		const struct list_ent *eb = ffslice_itemT(&l->ents, b->i, struct list_ent);
+		int r = ffsz_cmp((char*)l->names.ptr + ea->name_off, (char*)l->names.ptr + eb->name_off);
+		if (r != 0)
+			return r;
+	}
+
+	return (a->i < b->i) ? -1 : (a->i > b->i);
+}
+
+static uint64 list_key(struct list *l, const struct list_ent *e)
+{
+	switch (l->sort) {
+	case LIST_SORT_SIZE:
+		return e->size;
+
+	case LIST_SORT_MTIME: {
+		uint64 sec = (e->mtime.sec > FFTIME_1970_SECONDS) ? e->mtime.sec - FFTIME_1970_SECONDS : 0;
+		return (sec << 30) | e->mtime.nsec;
+	}
+	}
+
+	const u_char *s = (u_char*)l->names.ptr + e->name_off;
+	uint64 k = 0;
+	for (uint i = 0;  i != 8;  i++) {
+		k <<= 8;
+		if (i < e->name_len)
+			k |= s[i];
+	}
+	return k;
+}
+
+/** Print all collected entries (sorted) and reset the list */
+static void list_output(struct list *l)
+{
+	const struct list_ent *e;
+
+	if (l->sort != 0) {
+		ffvec keys = {};
+		ffvec_alloc(&keys, l->ents.len, sizeof(struct list_key));
+		uint i = 0;
+		FFSLICE_WALK(&l->ents, e) {
+			if (!e->err) {
+				struct list_key *k = ffvec_pushT(&keys, struct list_key);
+				k->key = list_key(l, e);
+				k->i = i;
+			}
+			i++;
+		}
+
+		ffsort(keys.ptr, keys.len, sizeof(struct list_key), list_key_cmp, l);
+
+		const struct list_key *k;
+		FFSLICE_WALK(&keys, k) {
+			list_out(l, ffslice_itemT(&l->ents, k->i, struct list_ent));
+			list_display(l, 0);
+		}
+		ffvec_free(&keys);
+
+	} else {
+		FFSLICE_WALK(&l->ents, e) {
+			if (!e->err) {
+				list_out(l, e);
+				list_display(l, 0);
+			}
+		}
+	}
+
+	l->ents.len = 0;
+	l->names.len = 0;
+	l->istat = 0;
+}
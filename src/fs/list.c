@@ -11,12 +11,21 @@ Usage:\n\
 OPTIONS:\n\
     `-l`, `--long`          Use long format\n\
           `--oneline`       Display all file names in a single line\n\
+    `-0`, `--zero`          Terminate each entry with NUL character instead of newline\n\
+          `--json`          Print 1 JSON object per line:\n\
+                            {\"name\":\"...\",\"dir\":BOOL,\"size\":N,\"mtime\":UNIX_TIME}\n\
+                            (\"size\" and \"mtime\" with --long or --sort size|mtime)\n\
+          `--sort` STR      Sort by:\n\
+                              name\n\
+                              size\n\
+                              mtime\n\
 ";
 }
 
 #include <fcom.h>
 #include <ffsys/path.h>
 #include <ffsys/std.h>
+#include <ffbase/sort.h>
 
 static const fcom_core *core;
 
@@ -26,6 +35,35 @@ static const fcom_core *core;
 	#define NEWLINE  "\n"
 #endif
 
+/*
+The file type is taken from the directory scan,
+ so file info isn't needed to print just the names.
+The names are collected in batches of LIST_BATCH entries.
+--long: file info for a batch is requested by the worker threads in parallel,
+ each one handles a contiguous range of entries with statx() relative to the parent directory;
+ then the main thread prints the batch.
+--sort: all entries are collected, then sorted and printed.
+*/
+
+#define LIST_BATCH  4096
+#define LIST_JOB_MIN  256 // min. number of entries per job
+
+struct list_ent {
+	uint name_off, name_len; // the name in list.names
+	uint dir_len; // length of the parent directory path;  0: none
+	uint64 size;
+	fftime mtime;
+	uint have_info :1;
+	uint err :1;
+	uint dir :1;
+};
+
+struct list_job {
+	struct list *l;
+	uint i, n; // range of entries
+	fcom_job job;
+};
+
 struct list {
 	fcom_cominfo cominfo;
 
@@ -33,14 +71,43 @@ struct list {
 	fcom_cominfo *cmd;
 	ffstr			name, base;
 	fffileinfo		fi;
+	uint			have_info :1;
+	uint			dir :1;
 	ffvec			buf;
+	ffsize			out_flush;
 	uint stop;
 	uint skip_prefix;
 
+	ffvec names; // char[]
+	ffvec ents; // struct list_ent[]
+	uint istat; // the first entry without file info
+	struct list_job *jobs;
+	uint njobs, nbusy;
+	uint need_info :1;
+	uint input_done :1;
+
+	ffstr eol;
+	struct {
+		int64 sec;
+		char s[32];
+		uint len;
+	} date; // the last date string (to the second)
+
 	u_char	long_fmt;
 	u_char	one_line;
+	u_char	zero;
+	u_char	json;
+	u_char	sort; // enum LIST_SORT
 };
 
+enum LIST_SORT {
+	LIST_SORT_NAME = 1,
+	LIST_SORT_SIZE,
+	LIST_SORT_MTIME,
+};
+
+#include <fs/list-out.h>
+
 static int list_read_input(struct list *l)
 {
 	int r;
@@ -52,10 +119,20 @@ static int list_read_input(struct list *l)
 		}
 	}
 
-	if (fffile_info_path(l->name.ptr, &l->fi))
-		return 'next';
+	unsigned dir;
+	uint t = core->com->input_type(l->cmd);
+	l->have_info = 0;
+	if (t == FCOM_COM_FT_UNKNOWN || t == FCOM_COM_FT_LINK) {
+		// symbolic links are followed
+		if (fffile_info_path(l->name.ptr, &l->fi))
+			return 'next';
+		l->have_info = 1;
+		dir = fffile_isdir(fffileinfo_attr(&l->fi));
+	} else {
+		dir = (t == FCOM_COM_FT_DIR);
+	}
 
-	unsigned dir = fffile_isdir(fffileinfo_attr(&l->fi));
+	l->dir = dir;
 	if (core->com->input_allowed(l->cmd, l->name, dir))
 		return 'next';
 
@@ -70,46 +147,175 @@ static int list_read_input(struct list *l)
 	return 0;
 }
 
-static void list_process(struct list *l)
+/** Add the current file to the batch */
+static void list_add(struct list *l)
 {
-	if (l->skip_prefix)
-		ffstr_shift(&l->name, 2);
+	struct list_ent *e = ffvec_zpushT(&l->ents, struct list_ent);
+	e->name_off = l->names.len;
+	e->name_len = l->name.len;
+	ffvec_addstr(&l->names, &l->name);
+	ffvec_addchar(&l->names, '\0');
+	e->dir = l->dir;
+
+	ffssize i = ffs_rfindchar(l->name.ptr, l->name.len, FFPATH_SLASH);
+	if (i > 0 && (ffsize)i + 1 != l->name.len)
+		e->dir_len = i;
+
+	if (l->have_info) {
+		e->have_info = 1;
+		e->size = fffileinfo_size(&l->fi);
+		e->mtime = fffileinfo_mtime1(&l->fi);
+	}
+}
 
-	if (!l->long_fmt && l->one_line) {
-		if (ffstr_findchar(&l->name, '"') >= 0)
-			fcom_warnlog("file name '%S' contains double-quote character", &l->name);
-		ffvec_addfmt(&l->buf, "\"%S\" ", &l->name);
+#ifdef FF_LINUX
 
-	} else if (!l->long_fmt) {
-		ffvec_addfmt(&l->buf, "%S" NEWLINE, &l->name);
+#include <fcntl.h>
+#include <sys/stat.h>
 
-	} else {
-		ffdatetime dt;
-		fftime t = fffileinfo_mtime1(&l->fi);
-		fftime_split1(&dt, &t);
-		char date[128];
-		int r = fftime_tostr1(&dt, date, sizeof(date), FFTIME_DATE_YMD | FFTIME_HMS_USEC);
-		date[r] = '\0';
-
-		ffvec_addfmt(&l->buf, "%12U %s %S" NEWLINE
-			, fffileinfo_size(&l->fi), date, &l->name);
+/** Worker thread: get file info for the range of entries.
+The parent directory is opened once for all its entries in the range. */
+static void list_stat_proc(void *param)
+{
+	struct list_job *j = param;
+	struct list *l = j->l;
+	int dfd = -1;
+	ffstr dir = {};
+	char path[4096];
+
+	for (uint i = j->i;  i != j->i + j->n;  i++) {
+		struct list_ent *e = ffslice_itemT(&l->ents, i, struct list_ent);
+		if (e->have_info)
+			continue;
+
+		const char *name = (char*)l->names.ptr + e->name_off;
+		int fd = AT_FDCWD;
+		if (e->dir_len != 0 && e->dir_len < sizeof(path)) {
+			if (!(dfd >= 0 && ffstr_eq(&dir, name, e->dir_len))) {
+				if (dfd >= 0)
+					close(dfd);
+				ffmem_copy(path, name, e->dir_len);
+				path[e->dir_len] = '\0';
+				dfd = open(path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+				ffstr_set(&dir, name, e->dir_len);
+			}
+			if (dfd >= 0) {
+				fd = dfd;
+				name += e->dir_len + 1;
+			}
+		}
+
+		struct statx stx;
+		fftime t;
+		fcom_stat_begin(&t);
+		int r = statx(fd, name, 0, STATX_SIZE | STATX_MTIME, &stx);
+		fcom_stat_end(FCOM_STAT_META, &t, 0);
+		if (r != 0) {
+			fcom_syserrlog("statx: %s", (char*)l->names.ptr + e->name_off);
+			e->err = 1;
+			continue;
+		}
+
+		e->size = stx.stx_size;
+		e->mtime.sec = stx.stx_mtime.tv_sec + FFTIME_1970_SECONDS;
+		e->mtime.nsec = stx.stx_mtime.tv_nsec;
+		e->have_info = 1;
+	}
+
+	if (dfd >= 0)
+		close(dfd);
+}
+
+#else
+
+static void list_stat_proc(void *param)
+{
+	struct list_job *j = param;
+	struct list *l = j->l;
+
+	for (uint i = j->i;  i != j->i + j->n;  i++) {
+		struct list_ent *e = ffslice_itemT(&l->ents, i, struct list_ent);
+		if (e->have_info)
+			continue;
+
+		fffileinfo fi;
+		const char *name = (char*)l->names.ptr + e->name_off;
+		if (fffile_info_path(name, &fi)) {
+			fcom_syserrlog("fffile_info_path: %s", name);
+			e->err = 1;
+			continue;
+		}
+		e->size = fffileinfo_size(&fi);
+		e->mtime = fffileinfo_mtime1(&fi);
+		e->have_info = 1;
 	}
 }
 
-static void list_display(struct list *l, int force)
+#endif
+
+static void list_run(fcom_op *op);
+
+/** Main thread: a job is complete */
+static void list_stat_done(void *param)
+{
+	struct list_job *j = param;
+	struct list *l = j->l;
+	if (--l->nbusy == 0)
+		list_run(l);
+}
+
+/** Get file info for the new entries by the worker threads */
+static void list_stat_start(struct list *l)
 {
-	if (force || l->buf.len >= 4096) {
-		ffstdout_write(l->buf.ptr, l->buf.len);
-		l->buf.len = 0;
+	uint n = l->ents.len - l->istat;
+	uint njobs = ffmin(l->njobs, (n + LIST_JOB_MIN - 1) / LIST_JOB_MIN);
+	njobs = ffmax(njobs, 1);
+	uint per_job = (n + njobs - 1) / njobs;
+
+	l->nbusy = 0;
+	for (uint i = 0;  i < n;  i += per_job) {
+		struct list_job *j = &l->jobs[l->nbusy++];
+		j->l = l;
+		j->i = l->istat + i;
+		j->n = ffmin(per_job, n - i);
+		fcom_job_set(&j->job, list_stat_proc, list_stat_done, j, l);
+		core->job(&j->job);
 	}
+	fcom_dbglog("list: getting info for %u files by %u jobs", n, l->nbusy);
+}
+
+static int args_sort(void *obj, ffstr s)
+{
+	struct list *l = obj;
+	static const char keys[][6] = {
+		"mtime",
+		"name",
+		"size",
+	};
+	static const u_char key_ids[] = {
+		LIST_SORT_MTIME,
+		LIST_SORT_NAME,
+		LIST_SORT_SIZE,
+	};
+	int r = ffcharr_findsorted(keys, FF_COUNT(keys), sizeof(keys[0]), s.ptr, s.len);
+	if (r < 0) {
+		fcom_fatlog("--sort: unknown key '%S'", &s);
+		return 1;
+	}
+	l->sort = key_ids[r];
+	return 0;
 }
 
 static int args_parse(struct list *l, fcom_cominfo *cmd)
 {
 	#define O(member)  (void*)FF_OFF(struct list, member)
 	static const struct ffarg args[] = {
+		{ "--json",		'1',	O(json) },
 		{ "--long",		'1',	O(long_fmt) },
 		{ "--oneline",	'1',	O(one_line) },
+		{ "--sort",		'S',	args_sort },
+		{ "--zero",		'1',	O(zero) },
+		{ "-0",			'1',	O(zero) },
 		{ "-l",			'1',	O(long_fmt) },
 		{}
 	};
@@ -130,6 +336,9 @@ static void list_close(fcom_op *op)
 {
 	struct list *l = (struct list*)op;
 	ffvec_free(&l->buf);
+	ffvec_free(&l->names);
+	ffvec_free(&l->ents);
+	ffmem_free(l->jobs);
 	ffmem_free(l);
 }
 
@@ -142,8 +351,21 @@ static fcom_op* list_create(fcom_cominfo *cmd)
 	if (args_parse(l, cmd))
 		goto end;
 
-	cap = (cmd->buffer_size) ? cmd->buffer_size : 64*1024;
+	cap = (cmd->buffer_size) ? cmd->buffer_size : 256*1024;
 	ffvec_alloc(&l->buf, cap, 1);
+	l->out_flush = cap / 4 * 3;
+
+	ffstr_setz(&l->eol, NEWLINE);
+	if (l->zero)
+		ffstr_set(&l->eol, "", 1);
+
+	l->need_info = (l->long_fmt
+		|| l->sort == LIST_SORT_SIZE || l->sort == LIST_SORT_MTIME);
+	if (l->need_info) {
+		l->njobs = ffmax(core->workers, 1);
+		l->jobs = ffmem_calloc(l->njobs, sizeof(struct list_job));
+	}
+	ffvec_alloc(&l->ents, LIST_BATCH, sizeof(struct list_ent));
 	return l;
 
 end:
@@ -155,7 +377,7 @@ static void list_run(fcom_op *op)
 {
 	struct list *l = (struct list*)op;
 	int rc = 1;
-	enum { I_IN, I_PRINT, };
+	enum { I_IN, I_ADD, I_INFO, I_OUTPUT, };
 
 	while (!FFINT_READONCE(l->stop)) {
 		switch (l->state) {
@@ -166,20 +388,42 @@ static void list_run(fcom_op *op)
 				continue;
 
 			case 'done':
-				list_display(l, 1);
-				rc = 0;
-				goto end;
+				l->input_done = 1;
+				l->state = I_INFO;
+				continue;
 
 			case 'erro':
 				goto end;
 			}
 
-			l->state = I_PRINT;
+			l->state = I_ADD;
 			// fallthrough
 
-		case I_PRINT:
-			list_process(l);
-			list_display(l, 0);
+		case I_ADD:
+			list_add(l);
+			l->state = I_IN;
+			if (l->ents.len - l->istat == LIST_BATCH)
+				l->state = I_INFO;
+			continue;
+
+		case I_INFO:
+			l->state = I_OUTPUT;
+			if (l->need_info && l->istat != l->ents.len) {
+				list_stat_start(l);
+				return;
+			}
+			// fallthrough
+
+		case I_OUTPUT:
+			l->istat = l->ents.len;
+			if (!(l->sort && !l->input_done))
+				list_output(l);
+
+			if (l->input_done) {
+				list_display(l, 1);
+				rc = 0;
+				goto end;
+			}
 			l->state = I_IN;
 			continue;
 		}
@@ -318,8 +318,7 @@ end:
 	{
 	fcom_cominfo *cmd = m->cmd;
 	move_close(m);
-	core->com->destroy(cmd);
-	core->exit(rc);
+	core->com->complete(cmd, rc);
 	}
 }
 
@@ -0,0 +1,194 @@
+/** fcom: trash: move files to the user's Trash directory (freedesktop.org Trash specification)
+2026, Simon Zolin */
+
+/*
+Home trash: $XDG_DATA_HOME/Trash (default: ~/.local/share/Trash)
+	files/NAME
+	info/NAME.trashinfo:
+		[Trash Info]
+		Path=/percent-encoded/absolute/path
+		DeletionDate=YYYY-MM-DDThh:mm:ss
+The info file is created first with O_EXCL: it reserves the unique NAME in Trash.
+If it already exists, "NAME.N" is tried with N taken from the counter shared by all threads,
+ so many files with the same name don't probe the same sequence of names.
+Then the file is renamed into files/ relative to the directory descriptor
+ (never replacing an orphaned file there).
+A file on another filesystem can't be renamed (EXDEV): the caller moves it by other means.
+xdgtrash_move() is thread-safe.
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+struct xdg_trash {
+	int files_fd, info_fd;
+	char *cwd; // for relative names
+	char date[32]; // deletion date for all files
+	uint seq; // suffix for the next name conflict
+};
+
+static void xdgtrash_close(struct xdg_trash *x)
+{
+	if (x->files_fd > 0)
+		close(x->files_fd);
+	if (x->info_fd > 0)
+		close(x->info_fd);
+	ffmem_free(x->cwd);
+}
+
+static int xdgtrash_open(struct xdg_trash *x)
+{
+	int rc = -1;
+	ffvec path = {};
+	const char *s;
+	if (NULL != (s = getenv("XDG_DATA_HOME")) && s[0] == '/')
+		ffvec_addfmt(&path, "%s%Z", s);
+	else if (NULL != (s = getenv("HOME")) && s[0] == '/')
+		ffvec_addfmt(&path, "%s/.local/share%Z", s);
+	else
+		goto end;
+
+	if (0 != core->file->dir_create(path.ptr, FCOM_FILE_DIR_RECURSIVE))
+		goto end;
+
+	path.len--;
+	ffsize n = path.len;
+	static const char subdirs[][8] = { "/Trash", "/files", "/info" };
+	for (uint i = 0;  i != FF_COUNT(subdirs);  i++) {
+		path.len = (i == 0) ? n : n + 6; // "/Trash"
+		ffvec_addfmt(&path, "%s%Z", subdirs[i]);
+		if (0 != mkdir(path.ptr, 0700) && errno != EEXIST) {
+			fcom_syserrlog("mkdir: %s", path.ptr);
+			goto end;
+		}
+		if (i == 0)
+			continue;
+
+		int fd = open(path.ptr, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0) {
+			fcom_syserrlog("open: %s", path.ptr);
+			goto end;
+		}
+		if (i == 1)
+			x->files_fd = fd;
+		else
+			x->info_fd = fd;
+	}
+
+	char buf[4096];
+	if (NULL == getcwd(buf, sizeof(buf)))
+		goto end;
+	x->cwd = ffsz_dup(buf);
+
+	ffdatetime dt;
+	fftime t = core->clock(NULL, FCOM_CORE_UTC);
+	t.sec += core->tz.real_offset;
+	fftime_split1(&dt, &t);
+	uint r = fftime_tostr1(&dt, x->date, sizeof(x->date) - 1, FFTIME_DATE_YMD | FFTIME_HMS);
+	x->date[10] = 'T';
+	x->date[r] = '\0';
+
+	x->seq = 2;
+	ffstr dir = FFSTR_INITN(path.ptr, n + 6);
+	fcom_dbglog("trash: using %S", &dir);
+	rc = 0;
+
+end:
+	ffvec_free(&path);
+	return rc;
+}
+
+/** Add path with percent-encoding */
+static void xdgtrash_path_add(ffvec *b, const char *s)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	ffvec_grow(b, ffsz_len(s) * 3, 1);
+	char *p = ffslice_end(b, 1);
+
+	for (;  *s != '\0';  s++) {
+		uint c = (u_char)*s;
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+			|| c == '/' || c == '-' || c == '_' || c == '.' || c == '~') {
+			*p++ = c;
+		} else {
+			*p++ = '%';
+			*p++ = hex[c >> 4];
+			*p++ = hex[c & 0x0f];
+		}
+	}
+
+	b->len = p - (char*)b->ptr;
+}
+
+/** Rename without replacing the existing file */
+static int xdgtrash_rename(const char *path, int dfd, const char *name)
+{
+	int r = renameat2(AT_FDCWD, path, dfd, name, RENAME_NOREPLACE);
+	if (r != 0 && (errno == EINVAL || errno == ENOSYS)) {
+		// the filesystem doesn't support the flag
+		if (0 == faccessat(dfd, name, F_OK, AT_SYMLINK_NOFOLLOW)) {
+			errno = EEXIST;
+			return -1;
+		}
+		r = renameat(AT_FDCWD, path, dfd, name);
+	}
+	return r;
+}
+
+/** Move file to Trash.
+buf: temporary buffer
+Return 0 on success;  errno value on error */
+static int xdgtrash_move(struct xdg_trash *x, const char *path, ffvec *buf)
+{
+	ffstr name;
+	ffpath_splitpath_str(FFSTR_Z(path), NULL, &name);
+	if (name.len == 0 || ffstr_eqz(&name, ".") || ffstr_eqz(&name, ".."))
+		return EINVAL;
+
+	buf->len = 0;
+	ffvec_addsz(buf, "[Trash Info]\nPath=");
+	if (path[0] != '/') {
+		xdgtrash_path_add(buf, x->cwd);
+		if (!(x->cwd[0] == '/' && x->cwd[1] == '\0'))
+			ffvec_addchar(buf, '/');
+		if (path[0] == '.' && path[1] == '/')
+			path += 2;
+	}
+	xdgtrash_path_add(buf, path);
+	ffvec_addfmt(buf, "\nDeletionDate=%s\n", x->date);
+	ffsize info_len = buf->len;
+
+	for (uint i = 0;  ;  i++) {
+		buf->len = info_len;
+		ffvec_addstr(buf, &name);
+		if (i != 0)
+			ffvec_addfmt(buf, ".%u", __atomic_fetch_add(&x->seq, 1, __ATOMIC_RELAXED));
+		ffsize name_len = buf->len - info_len;
+		ffvec_addfmt(buf, ".trashinfo%Z");
+		char *fn = (char*)buf->ptr + info_len;
+
+		int fd = openat(x->info_fd, fn, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+		if (fd < 0) {
+			if (errno == EEXIST && i != 1000)
+				continue;
+			return errno;
+		}
+		int e = 0;
+		if ((ffssize)info_len != write(fd, buf->ptr, info_len))
+			e = (errno != 0) ? errno : EIO;
+		close(fd);
+
+		fn[name_len] = '\0';
+		if (e == 0 && 0 != xdgtrash_rename(path, x->files_fd, fn))
+			e = errno;
+		if (e != 0) {
+			fn[name_len] = '.';
+			unlinkat(x->info_fd, fn, 0);
+			if (e == EEXIST && i != 1000)
+				continue; // files/NAME exists without info file
+		}
+		return e;
+	}
+}
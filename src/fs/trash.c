@@ -9,7 +9,7 @@ Usage:\n\
   `fcom trash` INPUT...\n\
 \n\
 OPTIONS:\n\
-    `-w`, `--wipe`          Overwrite data to hide file content (files-only).\n\
+    `-w`, `--wipe`          Overwrite data with pseudo-random bytes to hide file content (files-only).\n\
                         Additionally, set file modification time to 2000-01-01.\n\
     `-n`, `--rename`        Rename to \"00000000.0000\" before deleting (files-only)\n\
     `-f`                  Delete from disk if moving to Trash has failed (files-only)\n\
@@ -25,6 +25,41 @@ OPTIONS:\n\
 
 static const fcom_core *core;
 
+/*
+Linux: files are moved to the home Trash directory natively (see trash-xdg.h);
+ only the files on other filesystems are moved by libgio.
+Without --wipe and --rename the names are processed in batch by the worker threads,
+ each one handles a contiguous range of names.
+The Trash directories are opened (and created) on the first move.
+-f: the files that weren't moved to Trash are deleted in the same way:
+ unlinkat() relative to the parent directory; directories, "." and ".." are never deleted.
+*/
+
+#define TRASH_JOB_MIN  256 // min. number of names per job
+
+#ifdef FF_LINUX
+#include <fs/trash-xdg.h>
+#endif
+
+enum TRASH_ST {
+	TRASH_ST_NONE,
+	TRASH_ST_TRASHED,
+	TRASH_ST_DELETED,
+	TRASH_ST_ERR,
+};
+
+struct trash_ent {
+	u_char st; // enum TRASH_ST
+	int err; // errno
+};
+
+struct trash_job {
+	struct trash *t;
+	uint i, n; // range of names
+	uint del :1;
+	fcom_job job;
+};
+
 struct trash {
 	fcom_cominfo cominfo;
 
@@ -35,6 +70,16 @@ struct trash {
 	uint stop;
 	ffvec names; //char*[]
 	uint n_trashed, n_deleted;
+	fcom_keystream ks;
+
+	struct trash_ent *ents;
+	struct trash_job *jobs;
+	uint njobs, nbusy;
+#ifdef FF_LINUX
+	struct xdg_trash xdg;
+	uint xdg_opened :1;
+	uint xdg_ok :1;
+#endif
 
 	byte wipe;
 	byte rename;
@@ -66,6 +111,9 @@ static fcom_op* trash_create(fcom_cominfo *cmd)
 	struct fcom_file_conf fc = {};
 	fc.buffer_size = cmd->buffer_size;
 	t->in = core->file->create(&fc);
+
+	if (t->wipe)
+		core->keystream_init(&t->ks, NULL);
 	return t;
 
 end:
@@ -85,24 +133,71 @@ static void trash_close(fcom_op *op)
 	ffvec_free(&t->names);
 
 	ffvec_free(&t->buf);
+	ffmem_free(t->ents);
+	ffmem_free(t->jobs);
+#ifdef FF_LINUX
+	xdgtrash_close(&t->xdg);
+#endif
 	ffmem_free(t);
 }
 
 /** Fill buffer with pseudo-random data */
-static void data_rnd(ffvec *d, uint chunk)
+static void data_rnd(struct trash *t, ffvec *d, uint chunk)
 {
-	FF_ASSERT((chunk & 3) == 0);
-	char *p = d->ptr;
 	d->len = ffint_align_ceil(d->len, chunk);
-	const char *end = d->ptr + d->len;
+	core->keystream(&t->ks, d->ptr, d->len);
+}
 
-	while (p < end) {
-		uint rnd = core->random();
-		*(uint*)p = rnd;
-		p += 4;
+#ifdef FF_LINUX
+
+#include <fcntl.h>
+
+#define WIPE_WB_WINDOW  (8*1024*1024)
+
+/** Write-behind.
+When a window of data is written to the page cache, start writing it to disk;
+ wait until the previous window is on disk and drop it from the page cache.
+So the device is always busy, and the amount of dirty pages stays small.
+fin: wait until all data is on disk
+Return 0 on success;  -1: I/O error */
+static int wipe_writebehind(const char *fn, fffd fd, uint64 *wb_off, uint64 off, uint fin)
+{
+	while (off - *wb_off >= WIPE_WB_WINDOW) {
+		if (0 != sync_file_range(fd, *wb_off, WIPE_WB_WINDOW, SYNC_FILE_RANGE_WRITE)) {
+			fcom_syserrlog("sync_file_range: %s", fn);
+			return -1;
+		}
+		if (*wb_off != 0) {
+			uint64 prev = *wb_off - WIPE_WB_WINDOW;
+			if (0 != sync_file_range(fd, prev, WIPE_WB_WINDOW
+				, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER)) {
+				fcom_syserrlog("sync_file_range: %s", fn);
+				return -1;
+			}
+			posix_fadvise(fd, prev, WIPE_WB_WINDOW, POSIX_FADV_DONTNEED);
+		}
+		*wb_off += WIPE_WB_WINDOW;
+	}
+
+	if (fin) {
+		if (0 != fdatasync(fd)) {
+			fcom_syserrlog("fdatasync: %s", fn);
+			return -1;
+		}
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
 	}
+	return 0;
 }
 
+#else
+
+static int wipe_writebehind(const char *fn, fffd fd, uint64 *wb_off, uint64 off, uint fin)
+{
+	return 0;
+}
+
+#endif
+
 static void f_wipe_mtime(struct trash *t, fcom_file_obj *f)
 {
 	fftime mtime;
@@ -124,7 +219,7 @@ static int f_wipe(struct trash *t, const char *fn)
 	struct fcom_file_conf conf = {};
 	fcom_file_obj *f = core->file->create(&conf);
 
-	uint flags = FCOM_FILE_WRITE | FCOM_FILE_NO_PREALLOC;
+	uint flags = FCOM_FILE_WRITE | FCOM_FILE_NO_PREALLOC | FCOM_FILE_NOCACHE;
 	if (t->cmd->directio)
 		flags |= FCOM_FILE_DIRECTIO;
 
@@ -134,16 +229,17 @@ static int f_wipe(struct trash *t, const char *fn)
 	fffileinfo fi = {};
 	r = core->file->info(f, &fi);
 	if (r == FCOM_FILE_ERR) goto end;
-	uint64 fsize = fffileinfo_size(&fi);
+	uint64 fsize = fffileinfo_size(&fi), off = 0, wb_off = 0;
+	fffd fd = core->file->fd(f, FCOM_FILE_GET);
 
 	if (t->cmd->buffer_size == 0)
-		t->cmd->buffer_size = 64*1024;
+		t->cmd->buffer_size = 1*1024*1024;
 	t->cmd->buffer_size = ffmax(t->cmd->buffer_size, 4096);
 	ffvec_alloc(&d, t->cmd->buffer_size, 1);
 
 	while ((int64)fsize > 0) {
 		d.len = ffmin(fsize, d.cap);
-		data_rnd(&d, 4096);
+		data_rnd(t, &d, 4096);
 		fsize -= d.len;
 
 		if (FFINT_READONCE(t->stop))
@@ -151,8 +247,17 @@ static int f_wipe(struct trash *t, const char *fn)
 
 		r = core->file->write(f, *(ffstr*)&d, -1);
 		if (r == FCOM_FILE_ERR) goto end;
+		off += d.len;
+
+		if (!t->cmd->directio
+			&& 0 != wipe_writebehind(fn, fd, &wb_off, off, 0))
+			goto end;
 	}
 
+	r = core->file->flush(f, 0); // the buffered data must reach the page cache before fdatasync()
+	if (r == FCOM_FILE_ERR) goto end;
+	if (0 != wipe_writebehind(fn, fd, &wb_off, off, 1))
+		goto end;
 	f_wipe_mtime(t, f);
 
 	core->file->close(f);
@@ -166,20 +271,256 @@ end:
 	return rc;
 }
 
+#ifdef FF_LINUX
+
+/** Open the home Trash directory (once) */
+static uint trash_xdg_ok(struct trash *t)
+{
+	if (!t->xdg_opened) {
+		t->xdg_opened = 1;
+		t->xdg_ok = (0 == xdgtrash_open(&t->xdg));
+	}
+	return t->xdg_ok;
+}
+
+/** Move file to Trash */
+static int f_trash1(struct trash *t, const char *name)
+{
+	if (trash_xdg_ok(t)) {
+		ffvec buf = {};
+		int e = xdgtrash_move(&t->xdg, name, &buf);
+		ffvec_free(&buf);
+		if (e == 0)
+			return 0;
+		if (e != EXDEV) {
+			if (!t->cmd->overwrite) {
+				errno = e;
+				fcom_sysfatlog("%s: can't move file to trash", name);
+			}
+			return -1;
+		}
+	}
+
+	const char *err;
+	if (0 != ffui_glib_trash(name, &err)) {
+		if (!t->cmd->overwrite) {
+			fcom_fatlog("%s: can't move file to trash: %s"
+				, name, err);
+		}
+		return -1;
+	}
+	return 0;
+}
+
+/** Delete file relative to the directory descriptor.
+Directories, "." and ".." are not deleted. */
+static int f_del_at(int dfd, const char *name)
+{
+	const char *base = name;
+	for (const char *p = name;  *p != '\0';  p++) {
+		if (*p == '/')
+			base = p + 1;
+	}
+	if (base[0] == '.'
+		&& (base[1] == '\0' || (base[1] == '.' && base[2] == '\0'))) {
+		errno = EINVAL;
+		return -1;
+	}
+	return unlinkat(dfd, name, 0);
+}
+
+/** Worker thread: move the range of names to Trash, or delete the files that weren't moved */
+static void trash_job_proc(void *param)
+{
+	struct trash_job *j = param;
+	struct trash *t = j->t;
+	const char **names = t->names.ptr;
+	ffvec buf = {};
+	int dfd = -1;
+	ffstr dir = {};
+	char path[4096];
+
+	for (uint i = j->i;  i != j->i + j->n;  i++) {
+		struct trash_ent *e = &t->ents[i];
+
+		if (!j->del) {
+			if (0 == (e->err = xdgtrash_move(&t->xdg, names[i], &buf)))
+				e->st = TRASH_ST_TRASHED;
+			else
+				e->st = TRASH_ST_ERR;
+			continue;
+		}
+
+		if (e->st != TRASH_ST_ERR)
+			continue;
+
+		const char *name = names[i];
+		int fd = AT_FDCWD;
+		ffssize k = ffs_rfindchar(name, ffsz_len(name), '/');
+		if (k > 0 && (ffsize)k < sizeof(path)) {
+			if (!(dfd >= 0 && ffstr_eq(&dir, name, k))) {
+				if (dfd >= 0)
+					close(dfd);
+				ffmem_copy(path, name, k);
+				path[k] = '\0';
+				dfd = open(path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+				ffstr_set(&dir, name, k);
+			}
+			if (dfd >= 0) {
+				fd = dfd;
+				name += k + 1;
+			}
+		}
+
+		fftime tm;
+		fcom_stat_begin(&tm);
+		if (0 == f_del_at(fd, name))
+			e->st = TRASH_ST_DELETED;
+		else
+			e->err = errno;
+		fcom_stat_end(FCOM_STAT_META, &tm, 0);
+	}
+
+	if (dfd >= 0)
+		close(dfd);
+	ffvec_free(&buf);
+}
+
+static void trash_run(fcom_op *op);
+
+/** Main thread: a job is complete */
+static void trash_job_done(void *param)
+{
+	struct trash_job *j = param;
+	struct trash *t = j->t;
+	if (--t->nbusy == 0)
+		trash_run(t);
+}
+
+/** Process all names by the worker threads */
+static void trash_jobs_start(struct trash *t, uint del)
+{
+	uint n = t->names.len;
+	uint njobs = ffmin(t->njobs, (n + TRASH_JOB_MIN - 1) / TRASH_JOB_MIN);
+	njobs = ffmax(njobs, 1);
+	uint per_job = (n + njobs - 1) / njobs;
+
+	t->nbusy = 0;
+	for (uint i = 0;  i < n;  i += per_job) {
+		struct trash_job *j = &t->jobs[t->nbusy++];
+		j->t = t;
+		j->i = i;
+		j->n = ffmin(per_job, n - i);
+		j->del = del;
+		fcom_job_set(&j->job, trash_job_proc, trash_job_done, j, t);
+		core->job(&j->job);
+	}
+	fcom_dbglog("trash: %s %u files by %u jobs"
+		, (del) ? "deleting" : "moving", n, t->nbusy);
+}
+
+/** Start moving all files to Trash.
+Return 0: wait for the jobs;  1: use libgio */
+static int trash_all_start(struct trash *t)
+{
+	if (!trash_xdg_ok(t))
+		return 1;
+
+	t->ents = ffmem_calloc(t->names.len, sizeof(struct trash_ent));
+	t->njobs = ffmax(core->workers, 1);
+	t->jobs = ffmem_calloc(t->njobs, sizeof(struct trash_job));
+	trash_jobs_start(t, 0);
+	return 0;
+}
+
+/** Move the files on other filesystems by libgio.
+Return 0: done;  1: wait for the delete jobs;  <0: error */
+static int trash_all_complete(struct trash *t)
+{
+	const char **names = t->names.ptr;
+	uint nerr = 0;
+	for (uint i = 0;  i != t->names.len;  i++) {
+		struct trash_ent *e = &t->ents[i];
+		if (e->st == TRASH_ST_ERR && e->err == EXDEV) {
+			const char *err;
+			if (0 == ffui_glib_trash(names[i], &err)) {
+				e->st = TRASH_ST_TRASHED;
+			} else if (!t->cmd->overwrite) {
+				fcom_fatlog("%s: can't move file to trash: %s", names[i], err);
+			}
+		} else if (e->st == TRASH_ST_ERR && !t->cmd->overwrite) {
+			errno = e->err;
+			fcom_sysfatlog("%s: can't move file to trash", names[i]);
+		}
+
+		if (e->st == TRASH_ST_TRASHED) {
+			t->n_trashed++;
+			fcom_verblog("trash: %s", names[i]);
+		} else {
+			nerr++;
+		}
+	}
+
+	if (nerr == 0)
+		return 0;
+	if (!(t->cmd->overwrite && !t->cmd->test))
+		return -1;
+
+	fcom_verblog("%u files weren't moved to trash.  Trying to delete them.", nerr);
+	trash_jobs_start(t, 1);
+	return 1;
+}
+
+static int trash_del_complete(struct trash *t)
+{
+	const char **names = t->names.ptr;
+	uint nerr = 0;
+	for (uint i = 0;  i != t->names.len;  i++) {
+		struct trash_ent *e = &t->ents[i];
+		if (e->st == TRASH_ST_DELETED) {
+			t->n_deleted++;
+			fcom_verblog("file deleted: %s", names[i]);
+		} else if (e->st == TRASH_ST_ERR) {
+			errno = e->err;
+			fcom_syserrlog("file delete: %s", names[i]);
+			nerr++;
+		}
+	}
+
+	if (nerr != 0) {
+		fcom_fatlog("%u files were not deleted", nerr);
+		if (t->n_deleted == 0)
+			return -1;
+	}
+	return 0;
+}
+
+#else // !FF_LINUX
+
+static int f_trash1(struct trash *t, const char *name)
+{
+	if (0 != ffui_file_del(&name, 1, FFUI_FILE_TRASH)) {
+		if (!t->cmd->overwrite)
+			fcom_sysfatlog("can't move files to trash");
+		return -1;
+	}
+	return 0;
+}
+
+static int trash_all_start(struct trash *t) { return 1; }
+static int trash_all_complete(struct trash *t) { return 0; }
+static int trash_del_complete(struct trash *t) { return 0; }
+
+#endif
+
 /** Move files to Trash */
 static int f_trash(struct trash *t, const char **names, ffsize names_n)
 {
 #ifdef FF_LINUX
 	int e = 0;
 	for (ffsize i = 0;  i != names_n;  i++) {
-		const char *err;
-		if (0 != ffui_glib_trash(names[i], &err)) {
-			if (!t->cmd->overwrite) {
-				fcom_fatlog("%s: can't move file to trash: %s"
-					, names[i], err);
-			}
+		if (0 != f_trash1(t, names[i]))
 			e = 1;
-		}
 	}
 	if (e)
 		return -1;
@@ -272,7 +613,7 @@ static int trash_process(struct trash *t)
 			fn = _new.ptr;
 		}
 
-		if (0 != f_trash(t, &fn, 1)) {
+		if (0 != f_trash1(t, fn)) {
 			if (t->cmd->overwrite && !t->cmd->test) {
 				fcom_verblog("%s: can't move to trash.  Deleting."
 					, fn);
@@ -305,7 +646,7 @@ static void trash_done(struct trash *t)
 
 static void trash_run(fcom_op *op)
 {
-	enum { I_IN, I_ALL, I_OBO, I_DONE };
+	enum { I_IN, I_ALL, I_ALL_DONE, I_DEL_DONE, I_OBO, I_DONE };
 	struct trash *t = op;
 	int r, rc = 1;
 	ffstr name;
@@ -328,10 +669,28 @@ static void trash_run(fcom_op *op)
 		}
 
 		case I_ALL:
+			if (0 == trash_all_start(t)) {
+				t->st = I_ALL_DONE;
+				return;
+			}
 			if (trash_all(t)) goto end;
 			t->st = I_DONE;
 			continue;
 
+		case I_ALL_DONE:
+			if (0 > (r = trash_all_complete(t))) goto end;
+			t->st = I_DONE;
+			if (r == 1) {
+				t->st = I_DEL_DONE;
+				return;
+			}
+			continue;
+
+		case I_DEL_DONE:
+			if (trash_del_complete(t)) goto end;
+			t->st = I_DONE;
+			continue;
+
 		case I_OBO:
 			if (trash_process(t)) goto end;
 			t->st = I_DONE;
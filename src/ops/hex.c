@@ -25,6 +25,7 @@ struct hex {
 	ffstr data;
 	ffvec buf;
 	uint64 off;
+	uint chunk; // max. input data to print at once
 };
 
 static int args_parse(struct hex *h, fcom_cominfo *cmd)
@@ -62,6 +63,7 @@ static fcom_op* hex_create(fcom_cominfo *cmd)
 	fc.buffer_size = cmd->buffer_size;
 	h->in = core->file->create(&fc);
 	h->out = core->file->create(&fc);
+	h->chunk = ffmax(cmd->buffer_size, 64*1024); // >= the size of the file's read buffer
 
 	return h;
 
@@ -101,6 +103,7 @@ static void hex_run(fcom_op *op)
 				continue;
 
 			uint iflags = fcom_file_cominfo_flags_i(h->cmd);
+			iflags |= FCOM_FILE_MMAP;
 			r = core->file->open(h->in, in.ptr, iflags);
 			if (r == FCOM_FILE_ERR) goto end;
 
@@ -112,7 +115,7 @@ static void hex_run(fcom_op *op)
 		}
 
 		case I_READ: {
-			r = core->file->read(h->in, &h->data, -1);
+			r = core->file->read(h->in, &h->data, h->off);
 			if (r == FCOM_FILE_ERR) goto end;
 			if (r == FCOM_FILE_EOF) {
 				h->off = 0;
@@ -123,6 +126,8 @@ static void hex_run(fcom_op *op)
 				h->st = I_IN;
 				continue;
 			}
+			// a mapped file view may be very large: the output buffer is ~4.5x the input
+			h->data.len = ffmin(h->data.len, h->chunk);
 
 			uint flags = 16 | FFMEM_PRINT_ZEROSPACE;
 			ffsize n = ffmem_print(NULL, 0, h->data.ptr, h->data.len, h->off, flags);
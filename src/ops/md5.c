@@ -170,7 +170,10 @@ static int md5_process(struct md5 *m)
 		return 'done';
 	}
 
+	fftime t;
+	fcom_stat_begin(&t);
 	fcom_md5.update(m->hash, m->data.ptr, m->data.len);
+	fcom_stat_end(FCOM_STAT_CODEC, &t, m->data.len);
 	return 0;
 }
 
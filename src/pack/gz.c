@@ -124,7 +124,10 @@ static char* out_name(struct gz *z, ffstr in, ffstr base)
 static int gzcomp(struct gz *z, ffstr *in, ffstr *out)
 {
 	ffsize n = in->len;
+	fftime t;
+	fcom_stat_begin(&t);
 	int r = ffgzwrite_process(&z->gz, in, out);
+	fcom_stat_end(FCOM_STAT_CODEC, &t, n - in->len);
 	z->in_total += n - in->len;
 
 	switch ((enum FFGZWRITE_R)r) {
@@ -18,6 +18,8 @@ Usage:\n\
 
 const fcom_core *core;
 
+#include <pack/zcopy.h>
+
 struct iso {
 	fcom_cominfo cominfo;
 
@@ -28,6 +30,7 @@ struct iso {
 	//input:
 	ffstr			iname, base;
 	ffstr			plain;
+	uint64			in_off;
 	fcom_file_obj*	in;
 	fffileinfo		fi;
 	uint			in_file_notfound :1;
@@ -37,6 +40,7 @@ struct iso {
 	ffstr			isodata;
 	fcom_file_obj*	out;
 	int64			woff;
+	struct zcopy	zc;
 	uint			del_on_close :1;
 
 	ffvec fnames; // char*[]
@@ -108,6 +112,7 @@ static fcom_op* iso_create(fcom_cominfo *cmd)
 	fcom_cmd_file_conf(&fc, cmd);
 	c->in = core->file->create(&fc);
 	c->out = core->file->create(&fc);
+	c->zc.off = cmd->stdin;
 	return c;
 
 end:
@@ -182,6 +187,7 @@ static void iso_run(fcom_op *op)
 		case I_INFO: {
 			uint flags = fcom_file_cominfo_flags_i(c->cmd);
 			flags |= FCOM_FILE_READ;
+			zcopy_reset(&c->zc);
 			r = core->file->open(c->in, c->iname.ptr, flags);
 			if (r == FCOM_FILE_ERR) {
 				if (fferr_notexist(fferr_last())) {
@@ -225,9 +231,11 @@ static void iso_run(fcom_op *op)
 			c->fnames_i++;
 
 			uint flags = fcom_file_cominfo_flags_i(c->cmd);
-			flags |= FCOM_FILE_READ;
+			flags |= FCOM_FILE_READ | FCOM_FILE_MMAP;
+			zcopy_reset(&c->zc);
 			r = core->file->open(c->in, fn, flags);
 			if (r == FCOM_FILE_ERR) goto end;
+			c->in_off = 0;
 
 			ffisowrite_filenext(&c->iso);
 			c->st = I_FILEREAD;
@@ -235,6 +243,7 @@ static void iso_run(fcom_op *op)
 			// fallthrough
 
 		case I_FILEREAD:
+			zcopy_reset(&c->zc);
 			r = core->file->read(c->in, &c->plain, -1);
 			if (r == FCOM_FILE_ERR) goto end;
 			if (r == FCOM_FILE_ASYNC) {
@@ -245,6 +254,8 @@ static void iso_run(fcom_op *op)
 				c->st = I_IN_NEXT_OPEN;
 				continue;
 			}
+			zcopy_read(&c->zc, c->in, c->plain, c->in_off);
+			c->in_off += c->plain.len;
 			c->st = I_PROC;
 			// fallthrough
 
@@ -269,7 +280,17 @@ static void iso_run(fcom_op *op)
 			}
 			continue;
 
-		case I_WRITE:
+		case I_WRITE: {
+			ffssize n = zcopy_write(&c->zc, c->out, c->in, &c->isodata, c->woff);
+			if (n < 0) goto end;
+			if (c->woff != -1)
+				c->woff += n;
+			if (c->isodata.len == 0) {
+				c->woff = -1;
+				c->st = I_PROC;
+				continue;
+			}
+
 			r = core->file->write(c->out, c->isodata, c->woff);
 			if (r == FCOM_FILE_ERR) goto end;
 			if (r == FCOM_FILE_ASYNC) {
@@ -279,6 +300,7 @@ static void iso_run(fcom_op *op)
 			c->woff = -1;
 			c->st = I_PROC;
 			continue;
+		}
 
 		case I_DONE:
 			core->file->close(c->out);
@@ -16,6 +16,8 @@ Usage:\n\
 
 const fcom_core *core;
 
+#include <pack/zcopy.h>
+
 struct tar {
 	fcom_cominfo cominfo;
 
@@ -27,11 +29,13 @@ struct tar {
 	fcom_file_obj*	in;
 	fffileinfo		fi;
 	ffstr			plain;
+	uint64			in_off;
 	uint			link :1;
 
 	fftarwrite		wtar;
 	ffstr			tardata;
 	fcom_file_obj*	out;
+	struct zcopy	zc;
 	uint			del_on_close :1;
 };
 
@@ -81,6 +85,7 @@ static fcom_op* tar_create(fcom_cominfo *cmd)
 	fcom_cmd_file_conf(&fc, cmd);
 	t->in = core->file->create(&fc);
 	t->out = core->file->create(&fc);
+	t->zc.off = cmd->stdin;
 	return t;
 
 end:
@@ -185,10 +190,12 @@ static void tar_run(fcom_op *op)
 
 		case I_INFO: {
 			uint flags = fcom_file_cominfo_flags_i(t->cmd);
-			flags |= FCOM_FILE_READ;
+			flags |= FCOM_FILE_READ | FCOM_FILE_MMAP;
 			flags |= FCOM_FILE_INFO_NOFOLLOW;
+			zcopy_reset(&t->zc);
 			r = core->file->open(t->in, t->iname.ptr, flags);
 			if (r == FCOM_FILE_ERR) goto end;
+			t->in_off = 0;
 
 			r = core->file->info(t->in, &t->fi);
 			if (r == FCOM_FILE_ERR) goto end;
@@ -232,6 +239,7 @@ static void tar_run(fcom_op *op)
 			// fallthrough
 
 		case I_FILEREAD:
+			zcopy_reset(&t->zc);
 			r = core->file->read(t->in, &t->plain, -1);
 			if (r == FCOM_FILE_ERR) goto end;
 			if (r == FCOM_FILE_ASYNC) {
@@ -240,6 +248,8 @@ static void tar_run(fcom_op *op)
 			}
 			if (r == FCOM_FILE_EOF)
 				fftarwrite_filefinish(&t->wtar);
+			zcopy_read(&t->zc, t->in, t->plain, t->in_off);
+			t->in_off += t->plain.len;
 			t->st = I_PROC;
 			// fallthrough
 
@@ -265,6 +275,13 @@ static void tar_run(fcom_op *op)
 			continue;
 
 		case I_WRITE:
+			if (0 > zcopy_write(&t->zc, t->out, t->in, &t->tardata, -1))
+				goto end;
+			if (t->tardata.len == 0) {
+				t->st = I_PROC;
+				continue;
+			}
+
 			r = core->file->write(t->out, t->tardata, -1);
 			if (r == FCOM_FILE_ERR) goto end;
 			if (r == FCOM_FILE_ASYNC) {
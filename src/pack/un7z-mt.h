@@ -0,0 +1,337 @@
+/** fcom: un7z: extract 7z folders in parallel
+2026, Simon Zolin */
+
+/*
+--workers N:
+A .7z archive consists of folders (solid blocks), each one is compressed independently from its own offset.
+1. The main thread finds the first file of each folder without decoding any data:
+ after a file header the reader either asks to seek to the data of a new folder
+ (SEEK to an offset different from the current folder's),
+ or it continues with the data of the current folder.
+ The reader never receives the data, so nothing is decoded.
+2. The jobs are started, each one with its own reader and file objects over the same input file.
+ A job claims the next folder (the counter is shared by all jobs),
+ skips the files before it and extracts the folder's files in order.
+ The counter only grows, so a reader only moves forward and never decodes the skipped folders.
+The mtime of each directory is stored by the job
+ and is set in the final pass (unpack-meta.h) after all jobs are complete.
+An archive with 1 folder is extracted by the main thread as usual.
+*/
+
+struct un7z_job {
+	struct un7z *z;
+	ff7zread z7;
+	fcom_file_obj *in, *out;
+	char *oname;
+	const ff7zread_fileinfo *curfile;
+	uint64 total_uncomp;
+	ffvec dir_mtimes; // struct unmeta_dirtime[]
+	uint del_on_close :1;
+	uint err :1;
+	fcom_job job;
+};
+
+/** Read input data for the reader.  Any thread.
+off: -1: continue */
+static int un7z_mt_read(fcom_file_obj *in, ffstr *d, int64 off)
+{
+	int r = core->file->read(in, d, off);
+	if (r == FCOM_FILE_EOF) {
+		fcom_errlog("incomplete archive");
+		return -1;
+	} else if (r != FCOM_FILE_OK) {
+		return -1;
+	}
+	return 0;
+}
+
+/** Get the index of the first file of each folder.
+Return N of folders;  0: error */
+static uint un7z_mt_folders(struct un7z *z)
+{
+	ff7zread z7 = {};
+	ff7zread_open(&z7);
+	z7.log = un7z_log;
+	z7.udata = z;
+	ffstr zdata = {}, plain;
+	int64 cur = -1; // data offset of the current folder
+	uint n = 0;
+	z->mt_folders.len = 0;
+
+	// parse the archive header
+	for (;;) {
+		int r = ff7zread_process(&z7, &zdata, &plain);
+		switch ((enum FF7ZREAD_R)r) {
+		case FF7ZREAD_FILEHEADER:
+			goto files;
+
+		case FF7ZREAD_SEEK:
+			if (un7z_mt_read(z->in, &zdata, ff7zread_offset(&z7)))
+				goto end;
+			continue;
+
+		case FF7ZREAD_MORE:
+			if (un7z_mt_read(z->in, &zdata, -1))
+				goto end;
+			continue;
+
+		case FF7ZREAD_ERROR:
+			fcom_errlog("%s", ff7zread_error(&z7));
+			// fallthrough
+		default:
+			goto end;
+		}
+	}
+
+files:
+	for (uint i = 0;  ;  i++) {
+		const ff7zread_fileinfo *zf = ff7zread_nextfile(&z7);
+		if (zf == NULL) {
+			z->mt_nfiles = i;
+			break;
+		}
+		if ((zf->attr & FFFILE_WIN_DIR) || zf->size == 0)
+			continue; // no data
+
+		ffstr empty = {};
+		int r = ff7zread_process(&z7, &empty, &plain);
+		if (r == FF7ZREAD_SEEK
+			&& ff7zread_offset(&z7) != cur) {
+			cur = ff7zread_offset(&z7);
+			// the first folder also creates the directories and empty files listed before it
+			uint first = (z->mt_folders.len == 0) ? 0 : i;
+			*ffvec_pushT(&z->mt_folders, uint) = first;
+		} else if (r == FF7ZREAD_ERROR) {
+			fcom_errlog("%s", ff7zread_error(&z7));
+			goto end;
+		}
+	}
+
+	n = z->mt_folders.len;
+	fcom_dbglog("%S: %u files in %u folders", &z->iname, z->mt_nfiles, n);
+
+end:
+	ff7zread_close(&z7);
+	return n;
+}
+
+/** Worker thread: open output file or create directory */
+static int un7z_job_out_open(struct un7z_job *j, const ff7zread_fileinfo *zf)
+{
+	struct un7z *z = j->z;
+	j->curfile = zf;
+	ffmem_free(j->oname);
+	j->oname = un7z_outname(z, zf->name, z->cmd->chdir);
+
+	if (zf->attr & FFFILE_WIN_DIR) {
+		if (FCOM_FILE_ERR == core->file->dir_create(j->oname, FCOM_FILE_DIR_RECURSIVE))
+			return -1;
+		return 0;
+	}
+
+	uint flags = FCOM_FILE_WRITE;
+	flags |= fcom_file_cominfo_flags_o(z->cmd);
+	if (FCOM_FILE_ERR == core->file->open(j->out, j->oname, flags))
+		return -1;
+
+	core->file->trunc(j->out, zf->size);
+	j->del_on_close = !z->cmd->stdout && !z->cmd->test;
+	return 0;
+}
+
+static void un7z_job_file_done(struct un7z_job *j)
+{
+	fcom_verblog("%S: %U", &j->curfile->name, j->curfile->size);
+
+	fftime t = j->curfile->mtime;
+	t.sec += FFTIME_1970_SECONDS;
+
+	if (j->curfile->attr & FFFILE_WIN_DIR) {
+		struct unmeta_dirtime *d = ffvec_pushT(&j->dir_mtimes, struct unmeta_dirtime);
+		d->name = ffsz_dup(j->oname);
+		d->mtime = t;
+
+	} else {
+		core->file->mtime_set(j->out, t);
+#ifdef FF_WIN
+		if (j->curfile->attr != 0)
+			core->file->attr_set(j->out, j->curfile->attr);
+#endif
+
+		core->file->close(j->out);
+		j->del_on_close = 0;
+	}
+}
+
+/** Worker thread: extract the files of the claimed folders */
+static void un7z_job_proc(void *param)
+{
+	struct un7z_job *j = param;
+	struct un7z *z = j->z;
+	const uint *folders = z->mt_folders.ptr;
+	ffstr zdata = {}, plain;
+	uint ifile = 0; // index of the next file from ff7zread_nextfile()
+	uint first = 0, end = 0; // files of the current folder
+
+	ff7zread_open(&j->z7);
+	j->z7.log = un7z_log;
+	j->z7.udata = z;
+
+	while (!FFINT_READONCE(z->stop)) {
+		int r = ff7zread_process(&j->z7, &zdata, &plain);
+		switch ((enum FF7ZREAD_R)r) {
+
+		case FF7ZREAD_FILEHEADER: {
+			const ff7zread_fileinfo *zf;
+			for (;;) {
+				if (ifile == end) {
+					uint k = __atomic_fetch_add(&z->mt_ifolder, 1, __ATOMIC_RELAXED);
+					if (k >= z->mt_folders.len)
+						goto end;
+					first = folders[k];
+					end = (k + 1 != z->mt_folders.len) ? folders[k + 1] : z->mt_nfiles;
+				}
+
+				if (NULL == (zf = ff7zread_nextfile(&j->z7)))
+					goto end;
+				uint i = ifile++;
+				if (i >= first && un7z_f_info(z, zf))
+					break;
+			}
+
+			if (un7z_job_out_open(j, zf))
+				goto err;
+			continue;
+		}
+
+		case FF7ZREAD_DATA:
+			if (FCOM_FILE_OK != core->file->write(j->out, plain, -1))
+				goto err;
+			j->total_uncomp += plain.len;
+			continue;
+
+		case FF7ZREAD_FILEDONE:
+			un7z_job_file_done(j);
+			continue;
+
+		case FF7ZREAD_MORE:
+			if (un7z_mt_read(j->in, &zdata, -1))
+				goto err;
+			continue;
+
+		case FF7ZREAD_SEEK:
+			if (un7z_mt_read(j->in, &zdata, ff7zread_offset(&j->z7)))
+				goto err;
+			continue;
+
+		case FF7ZREAD_ERROR:
+			fcom_errlog("%s", ff7zread_error(&j->z7));
+			goto err;
+		}
+	}
+
+err:
+	j->err = 1;
+
+end:
+	ff7zread_close(&j->z7);
+}
+
+static void un7z_run(fcom_op *op);
+
+/** Main thread: a job is complete */
+static void un7z_job_done(void *param)
+{
+	struct un7z_job *j = param;
+	struct un7z *z = j->z;
+	if (j->job.cancelled)
+		j->err = 1;
+	if (j->del_on_close) {
+		core->file->close(j->out);
+		core->file->del(j->oname, 0);
+		j->del_on_close = 0;
+	}
+	z->total_uncomp += j->total_uncomp;
+	if (--z->mt_nbusy == 0)
+		un7z_run(z);
+}
+
+static void un7z_job_dirs_free(struct un7z_job *j)
+{
+	struct unmeta_dirtime *d;
+	FFSLICE_WALK(&j->dir_mtimes, d) {
+		ffmem_free(d->name);
+	}
+	ffvec_free(&j->dir_mtimes);
+}
+
+static void un7z_mt_free(struct un7z *z)
+{
+	for (uint i = 0;  i != z->mt_njobs;  i++) {
+		struct un7z_job *j = &z->mt_jobs[i];
+		core->file->destroy(j->in);
+		core->file->destroy(j->out);
+		ffmem_free(j->oname);
+		un7z_job_dirs_free(j);
+	}
+	ffmem_free(z->mt_jobs);
+	z->mt_jobs = NULL;
+	z->mt_njobs = 0;
+}
+
+/** Start extracting the folders by the worker threads.
+Return 0: wait for the jobs;  1: the archive must be extracted by the main thread;  <0: error */
+static int un7z_mt_start(struct un7z *z)
+{
+	uint nfolders = un7z_mt_folders(z);
+	if (nfolders <= 1)
+		return 1;
+
+	un7z_mt_free(z);
+	z->mt_njobs = ffmin(z->workers, nfolders);
+	z->mt_jobs = ffmem_calloc(z->mt_njobs, sizeof(struct un7z_job));
+	z->mt_ifolder = 0;
+
+	struct fcom_file_conf fc = {};
+	fcom_cmd_file_conf(&fc, z->cmd);
+	uint flags = fcom_file_cominfo_flags_i(z->cmd);
+	flags |= FCOM_FILE_READ | FCOM_FILE_MMAP;
+
+	for (uint i = 0;  i != z->mt_njobs;  i++) {
+		struct un7z_job *j = &z->mt_jobs[i];
+		j->z = z;
+		j->in = core->file->create(&fc);
+		j->out = core->file->create(&fc);
+		if (FCOM_FILE_ERR == core->file->open(j->in, z->iname.ptr, flags))
+			return -1;
+	}
+
+	fcom_dbglog("%S: extracting %u folders by %u jobs", &z->iname, nfolders, z->mt_njobs);
+	z->mt_nbusy = z->mt_njobs;
+	for (uint i = 0;  i != z->mt_njobs;  i++) {
+		struct un7z_job *j = &z->mt_jobs[i];
+		fcom_job_set(&j->job, un7z_job_proc, un7z_job_done, j, z);
+		core->job(&j->job);
+	}
+	return 0;
+}
+
+/** Main thread: all jobs are complete.
+Return 0: success */
+static int un7z_mt_complete(struct un7z *z)
+{
+	int rc = 0;
+	for (uint i = 0;  i != z->mt_njobs;  i++) {
+		struct un7z_job *j = &z->mt_jobs[i];
+		if (j->err)
+			rc = -1;
+		core->file->close(j->in);
+
+		const struct unmeta_dirtime *d;
+		FFSLICE_WALK(&j->dir_mtimes, d) {
+			unmeta_dir_mtime(&z->meta, d->name, d->mtime);
+		}
+		un7z_job_dirs_free(j);
+	}
+	return rc;
+}
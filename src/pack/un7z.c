@@ -16,6 +16,8 @@ OPTIONS:\n\
     `-l`, `--list`      Just show the file list\n\
         `--autodir`   Add to OUTPUT_DIR a directory with name = input archive name.\n\
                      Same as manual 'un7z arc.7z -C odir/arc'.\n\
+        `--workers` N Extract N folders (solid blocks) in parallel\n\
+                     (0: use all worker threads; default: 1)\n\
 ";
 }
 
@@ -27,6 +29,8 @@ OPTIONS:\n\
 
 const fcom_core *core;
 
+#include <pack/unpack-meta.h>
+
 struct un7z {
 	fcom_cominfo cominfo;
 
@@ -43,10 +47,19 @@ struct un7z {
 	uint del_on_close :1;
 	uint64 total_uncomp;
 	int64 roff;
+	struct unmeta meta;
+
+	// --workers
+	ffvec mt_folders; // index of the first file of each folder: uint[]
+	uint mt_nfiles;
+	uint mt_ifolder; // the next folder for a job
+	struct un7z_job *mt_jobs;
+	uint mt_njobs, mt_nbusy;
 
 	// conf:
 	byte list;
 	byte autodir;
+	uint workers;
 	ffvec members_data;
 	ffmap members; // char*[]
 };
@@ -108,6 +121,7 @@ static int un7z_args_parse(struct un7z *z, fcom_cominfo *cmd)
 		{ "--autodir",				'1',	O(autodir) },
 		{ "--list",					'1',	O(list) },
 		{ "--members-from-file",	's',	un7z_args_members_from_file },
+		{ "--workers",				'u',	O(workers) },
 		{ "-l",						'1',	O(list) },
 		{ "-m",						's',	un7z_args_members_from_file },
 		{}
@@ -124,6 +138,9 @@ static int un7z_args_parse(struct un7z *z, fcom_cominfo *cmd)
 	if (cmd->chdir.len == 0)
 		ffstr_dupz(&cmd->chdir, ".");
 
+	if (z->workers == 0)
+		z->workers = ffmax(core->workers, 1);
+
 	return 0;
 }
 
@@ -134,6 +151,8 @@ static void un7z_log(void *udata, uint level, ffstr msg)
 	fcom_dbglog("%S", &msg);
 }
 
+static void un7z_mt_free(struct un7z *z);
+
 static void un7z_close(fcom_op *op)
 {
 	struct un7z *z = op;
@@ -146,6 +165,9 @@ static void un7z_close(fcom_op *op)
 	ffmem_free(z->oname);
 	ffvec_free(&z->members_data);
 	ffmap_free(&z->members);
+	un7z_mt_free(z);
+	ffvec_free(&z->mt_folders);
+	unmeta_destroy(&z->meta);
 	ffmem_free(z);
 }
 
@@ -153,6 +175,8 @@ static fcom_op* un7z_create(fcom_cominfo *cmd)
 {
 	struct un7z *z = ffmem_new(struct un7z);
 	z->cmd = cmd;
+	z->workers = 1;
+	unmeta_init(&z->meta, cmd);
 
 	if (0 != un7z_args_parse(z, cmd))
 		goto end;
@@ -292,6 +316,8 @@ static int un7z_read(struct un7z *z, ffstr *input, ffstr *output)
 	}
 }
 
+#include <pack/un7z-mt.h>
+
 static void un7z_reset(struct un7z *z)
 {
 	z->total_uncomp = 0;
@@ -302,7 +328,7 @@ static void un7z_run(fcom_op *op)
 {
 	struct un7z *z = op;
 	int r, rc = 1;
-	enum { I_IN, I_INFO, I_PARSE, I_FILEREAD, I_OUT_OPEN, I_WRITE };
+	enum { I_IN, I_INFO, I_PARSE, I_FILEREAD, I_OUT_OPEN, I_WRITE, I_MT_DONE };
 
 	while (!FFINT_READONCE(z->stop)) {
 		switch (z->state) {
@@ -320,7 +346,7 @@ static void un7z_run(fcom_op *op)
 
 		case I_INFO: {
 			uint flags = fcom_file_cominfo_flags_i(z->cmd);
-			flags |= FCOM_FILE_READ;
+			flags |= FCOM_FILE_READ | FCOM_FILE_MMAP;
 			r = core->file->open(z->in, z->iname.ptr, flags);
 			if (r == FCOM_FILE_ERR) goto end;
 
@@ -341,6 +367,17 @@ static void un7z_run(fcom_op *op)
 
 			un7z_reset(z);
 
+			if (z->workers > 1 && !z->list && !z->cmd->stdout) {
+				r = un7z_mt_start(z);
+				if (r < 0)
+					goto end;
+				if (r == 0) {
+					z->state = I_MT_DONE;
+					return;
+				}
+				z->roff = 0;
+			}
+
 			ff7zread_open(&z->z7);
 			z->z7.log = un7z_log;
 			z->z7.udata = z;
@@ -371,15 +408,15 @@ static void un7z_run(fcom_op *op)
 			case FF7ZREAD_FILEDONE: {
 				fftime t = z->curfile->mtime;
 				t.sec += FFTIME_1970_SECONDS;
-				core->file->mtime_set(z->out, t);
 
-				if (!(z->curfile->attr & FFFILE_WIN_DIR)) {
+				if (z->curfile->attr & FFFILE_WIN_DIR) {
+					unmeta_dir_mtime(&z->meta, z->oname, t);
+				} else {
+					uint attr = 0;
 #ifdef FF_WIN
-					if (z->curfile->attr != 0)
-						core->file->attr_set(z->out, z->curfile->attr);
+					attr = z->curfile->attr;
 #endif
-
-					core->file->close(z->out);
+					unmeta_file_close(&z->meta, z->out, z->oname, t, attr);
 					z->del_on_close = 0;
 				}
 				break;
@@ -404,12 +441,16 @@ static void un7z_run(fcom_op *op)
 
 		case I_OUT_OPEN: {
 			if (z->curfile->attr & FFFILE_WIN_DIR) {
-				r = core->file->dir_create(z->oname, FCOM_FILE_DIR_RECURSIVE);
-				if (r == FCOM_FILE_ERR) goto end;
+				if (unmeta_dir_create(&z->meta, FFSTR_Z(z->oname)))
+					goto end;
 				z->state = I_PARSE;
 				continue;
 			}
 
+			if (!z->cmd->stdout
+				&& unmeta_parent_create(&z->meta, z->oname))
+				goto end;
+
 			uint flags = FCOM_FILE_WRITE;
 			flags |= fcom_file_cominfo_flags_o(z->cmd);
 			r = core->file->open(z->out, z->oname, flags);
@@ -422,6 +463,12 @@ static void un7z_run(fcom_op *op)
 			continue;
 		}
 
+		case I_MT_DONE:
+			if (un7z_mt_complete(z))
+				goto end;
+			z->state = I_IN;
+			continue;
+
 		case I_WRITE:
 			r = core->file->write(z->out, z->plain, -1);
 			if (r == FCOM_FILE_ERR) goto end;
@@ -437,6 +484,8 @@ static void un7z_run(fcom_op *op)
 	}
 
 end:
+	if (unmeta_finish(&z->meta, z, un7z_close, z->cmd, rc))
+		return;
 	{
 	fcom_cominfo *cmd = z->cmd;
 	un7z_close(z);
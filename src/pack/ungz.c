@@ -121,7 +121,10 @@ static int gzread(struct ungz *z, ffstr *in, ffstr *out)
 	}
 
 	ffsize n = in->len;
+	fftime t;
+	fcom_stat_begin(&t);
 	int r = ffgzread_process(&z->ungz, in, out);
+	fcom_stat_end(FCOM_STAT_CODEC, &t, n - in->len);
 	z->in_total += n - in->len;
 
 	switch ((enum FFGZREAD_R)r) {
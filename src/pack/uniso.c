@@ -26,6 +26,9 @@ OPTIONS:\n\
 
 extern const fcom_core *core;
 
+#include <pack/zcopy.h>
+#include <pack/unpack-meta.h>
+
 struct file {
 	uint64 off;
 	uint attr_unix, attr_win;
@@ -49,6 +52,8 @@ struct uniso {
 	uint del_on_close :1;
 	uint64 total_comp, total_uncomp;
 	uint64 roff;
+	struct zcopy zc;
+	struct unmeta meta;
 
 	ffvec files; // struct file[]
 	ffsize ifile;
@@ -156,6 +161,7 @@ static void uniso_close(fcom_op *op)
 	ffmem_free(c->oname);
 	ffvec_free(&c->members_data);
 	ffmap_free(&c->members);
+	unmeta_destroy(&c->meta);
 	ffmem_free(c);
 }
 
@@ -171,6 +177,8 @@ static fcom_op* uniso_create(fcom_cominfo *cmd)
 	fcom_cmd_file_conf(&fc, cmd);
 	c->in = core->file->create(&fc);
 	c->out = core->file->create(&fc);
+	c->zc.off = cmd->stdin;
+	unmeta_init(&c->meta, cmd);
 
 	ffsize cap = (cmd->buffer_size != 0) ? cmd->buffer_size : 64*1024;
 	ffvec_alloc(&c->buf, cap, 1);
@@ -286,7 +294,8 @@ static void uniso_run(fcom_op *op)
 
 		case I_INFO: {
 			uint flags = fcom_file_cominfo_flags_i(c->cmd);
-			flags |= FCOM_FILE_READ;
+			flags |= FCOM_FILE_READ | FCOM_FILE_MMAP;
+			zcopy_reset(&c->zc);
 			r = core->file->open(c->in, c->iname.ptr, flags);
 			if (r == FCOM_FILE_ERR) goto end;
 
@@ -315,6 +324,7 @@ static void uniso_run(fcom_op *op)
 		}
 
 		case I_FILEREAD:
+			zcopy_reset(&c->zc);
 			r = core->file->read(c->in, &c->isodata, c->roff);
 			if (r == FCOM_FILE_ERR) goto end;
 			if (r == FCOM_FILE_ASYNC) {
@@ -325,6 +335,7 @@ static void uniso_run(fcom_op *op)
 				fcom_errlog("incomplete archive");
 				goto end;
 			}
+			zcopy_read(&c->zc, c->in, c->isodata, c->roff);
 			c->roff += c->isodata.len;
 			c->state = I_PARSE;
 			// fallthrough
@@ -343,10 +354,11 @@ static void uniso_run(fcom_op *op)
 			case FFISOREAD_FILEDONE: {
 				fftime t = c->curfile->mtime;
 				t.sec += FFTIME_1970_SECONDS;
-				core->file->mtime_set(c->out, t);
 
-				if (!(c->curfile->attr & ISO_FILE_DIR)) {
-					core->file->close(c->out);
+				if (c->curfile->attr & ISO_FILE_DIR) {
+					unmeta_dir_mtime(&c->meta, c->oname, t);
+				} else {
+					unmeta_file_close(&c->meta, c->out, c->oname, t, 0);
 					c->del_on_close = 0;
 					fcom_verblog("%s", c->oname);
 				}
@@ -379,12 +391,16 @@ static void uniso_run(fcom_op *op)
 			c->oname = outname(c, f->name, c->cmd->chdir);
 
 			if (f->attr & ISO_FILE_DIR) {
-				r = core->file->dir_create(c->oname, FCOM_FILE_DIR_RECURSIVE);
-				if (r == FCOM_FILE_ERR) goto end;
+				if (unmeta_dir_create(&c->meta, FFSTR_Z(c->oname)))
+					goto end;
 				c->state = I_PARSE;
 				continue;
 			}
 
+			if (!c->cmd->stdout
+				&& unmeta_parent_create(&c->meta, c->oname))
+				goto end;
+
 			uint flags = FCOM_FILE_WRITE;
 			flags |= fcom_file_cominfo_flags_o(c->cmd);
 			r = core->file->open(c->out, c->oname, flags);
@@ -397,7 +413,15 @@ static void uniso_run(fcom_op *op)
 			continue;
 		}
 
-		case I_WRITE:
+		case I_WRITE: {
+			ffssize n = zcopy_write(&c->zc, c->out, c->in, &c->plain, -1);
+			if (n < 0) goto end;
+			c->total_uncomp += n;
+			if (c->plain.len == 0) {
+				c->state = I_PARSE;
+				continue;
+			}
+
 			r = core->file->write(c->out, c->plain, -1);
 			if (r == FCOM_FILE_ERR) goto end;
 			if (r == FCOM_FILE_ASYNC) {
@@ -409,9 +433,12 @@ static void uniso_run(fcom_op *op)
 			c->state = I_PARSE;
 			continue;
 		}
+		}
 	}
 
 end:
+	if (unmeta_finish(&c->meta, c, uniso_close, c->cmd, rc))
+		return;
 	{
 	fcom_cominfo *cmd = c->cmd;
 	uniso_close(c);
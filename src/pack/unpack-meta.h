@@ -0,0 +1,257 @@
+/** fcom: pack: create directories and set file properties for the extracted files
+2026, Simon Zolin */
+
+/*
+The directories created by the extractor are remembered,
+ so a directory entry or the parent directory of the next file doesn't cost a syscall,
+ and the output file is never opened for a missing directory (failed open(), then mkdir(), then open() again).
+After a file is written, its descriptor is moved to a batch along with the file's mtime and attributes.
+A full batch is passed to a worker thread which sets the properties and closes the files,
+ so the main thread only reads and writes the data.
+The directory mtimes are set in the final pass, after all files inside are created.
+The operation completes after all batches are processed.
+*/
+
+#include <ffsys/dir.h>
+
+#define UNMETA_BATCH  64
+#define UNMETA_JOBS_MAX  4 // otherwise a batch is processed by the main thread
+
+struct unmeta_file {
+	fffd fd;
+	char *name;
+	fftime mtime;
+	uint attr;
+};
+
+struct unmeta_batch {
+	struct unmeta *m;
+	uint n;
+	struct unmeta_file files[UNMETA_BATCH];
+	fcom_job job;
+};
+
+struct unmeta_dirtime {
+	char *name;
+	fftime mtime;
+};
+
+struct unmeta {
+	ffmap dirs; // created directories: char*
+	ffvec dir_names; // char*[]
+	ffvec dir_mtimes; // struct unmeta_dirtime[]
+	struct unmeta_batch *batch;
+	uint nbusy;
+	uint sync :1; // the data is written to stdout
+
+	// complete the operation after all batches are processed
+	uint wait :1;
+	int rc;
+	fcom_op *op;
+	void (*op_close)(fcom_op *op);
+	fcom_cominfo *cmd;
+};
+
+static int unmeta_keyeq(void *opaque, const void *key, ffsize keylen, void *val)
+{
+	const char *v = val;
+	return !ffmem_cmp(key, v, keylen) && v[keylen] == '\0';
+}
+
+static void unmeta_init(struct unmeta *m, fcom_cominfo *cmd)
+{
+	ffmap_init(&m->dirs, unmeta_keyeq);
+	m->sync = cmd->stdout;
+}
+
+/** Worker thread: set file properties and close the files */
+static void unmeta_batch_proc(void *param)
+{
+	struct unmeta_batch *b = param;
+	for (uint i = 0;  i != b->n;  i++) {
+		struct unmeta_file *f = &b->files[i];
+
+		if (f->attr != 0 && 0 != fffile_set_attr(f->fd, f->attr))
+			fcom_syswarnlog("fffile_set_attr: %s", f->name);
+
+		if (f->mtime.sec != 0) {
+			fftime t = f->mtime;
+			t.sec -= FFTIME_1970_SECONDS;
+			if (0 != fffile_set_mtime(f->fd, &t))
+				fcom_syswarnlog("file set mtime: %s", f->name);
+		}
+
+		if (0 != fffile_close(f->fd))
+			fcom_syserrlog("%s: fffile_close", f->name);
+		f->fd = FFFILE_NULL;
+	}
+}
+
+static void unmeta_batch_free(struct unmeta_batch *b)
+{
+	for (uint i = 0;  i != b->n;  i++) {
+		ffmem_free(b->files[i].name);
+	}
+	ffmem_free(b);
+}
+
+/** Main thread: a batch is processed */
+static void unmeta_batch_done(void *param)
+{
+	struct unmeta_batch *b = param;
+	struct unmeta *m = b->m;
+	if (b->job.cancelled)
+		unmeta_batch_proc(b);
+	unmeta_batch_free(b);
+
+	if (--m->nbusy == 0 && m->wait) {
+		fcom_cominfo *cmd = m->cmd;
+		int rc = m->rc;
+		m->op_close(m->op);
+		core->com->complete(cmd, rc);
+	}
+}
+
+static void unmeta_submit(struct unmeta *m)
+{
+	struct unmeta_batch *b = m->batch;
+	if (b == NULL || b->n == 0)
+		return;
+	m->batch = NULL;
+
+	if (m->nbusy == UNMETA_JOBS_MAX) {
+		unmeta_batch_proc(b);
+		unmeta_batch_free(b);
+		return;
+	}
+
+	m->nbusy++;
+	fcom_job_set(&b->job, unmeta_batch_proc, unmeta_batch_done, b, m);
+	core->job(&b->job);
+}
+
+/** Close the output file; set its mtime and attributes in background.
+mtime: 0: don't set
+attr: 0: don't set */
+static void unmeta_file_close(struct unmeta *m, fcom_file_obj *f, const char *name, fftime mtime, uint attr)
+{
+	if (m->sync) {
+		if (mtime.sec != 0)
+			core->file->mtime_set(f, mtime);
+		if (attr != 0)
+			core->file->attr_set(f, attr);
+		core->file->close(f);
+		return;
+	}
+
+	core->file->behaviour(f, FCOM_FBEH_TRUNC_PREALLOC);
+	fffd fd = core->file->fd(f, FCOM_FILE_ACQUIRE);
+	core->file->close(f);
+	if (fd == FFFILE_NULL)
+		return; // fake write
+
+	if (m->batch == NULL)
+		m->batch = ffmem_new(struct unmeta_batch);
+	struct unmeta_batch *b = m->batch;
+	b->m = m;
+	struct unmeta_file *uf = &b->files[b->n++];
+	uf->fd = fd;
+	uf->name = ffsz_dup(name);
+	uf->mtime = mtime;
+	uf->attr = attr;
+
+	if (b->n == UNMETA_BATCH)
+		unmeta_submit(m);
+}
+
+/** Create directory (once) */
+static int unmeta_dir_create(struct unmeta *m, ffstr name)
+{
+	if (name.len > 1
+		&& (name.ptr[name.len - 1] == '/' || name.ptr[name.len - 1] == FFPATH_SLASH))
+		name.len--;
+
+	if (name.len == 0
+		|| NULL != ffmap_find(&m->dirs, name.ptr, name.len, NULL))
+		return 0;
+
+	char *s = ffsz_dupstr(&name);
+	if (FCOM_FILE_ERR == core->file->dir_create(s, FCOM_FILE_DIR_RECURSIVE)) {
+		ffmem_free(s);
+		return -1;
+	}
+	*ffvec_pushT(&m->dir_names, char*) = s;
+	ffmap_add(&m->dirs, s, name.len, s);
+	return 0;
+}
+
+/** Create the parent directory of the output file */
+static int unmeta_parent_create(struct unmeta *m, const char *fn)
+{
+	ffstr dir;
+	ffpath_splitpath_str(FFSTR_Z(fn), &dir, NULL);
+	return unmeta_dir_create(m, dir);
+}
+
+/** Set directory mtime in the final pass */
+static void unmeta_dir_mtime(struct unmeta *m, const char *name, fftime mtime)
+{
+	if (m->sync || mtime.sec == 0)
+		return;
+	struct unmeta_dirtime *d = ffvec_pushT(&m->dir_mtimes, struct unmeta_dirtime);
+	d->name = ffsz_dup(name);
+	d->mtime = mtime;
+}
+
+static void unmeta_dirs_apply(struct unmeta *m)
+{
+	struct unmeta_dirtime *d;
+	FFSLICE_WALK(&m->dir_mtimes, d) {
+		fftime t = d->mtime;
+		t.sec -= FFTIME_1970_SECONDS;
+		if (0 != fffile_set_mtime_path(d->name, &t))
+			fcom_syswarnlog("fffile_set_mtime_path: %s", d->name);
+	}
+}
+
+/** Finish all pending work.
+Return 1: the operation will be completed after all batches are processed;
+ 0: the caller completes the operation */
+static int unmeta_finish(struct unmeta *m, fcom_op *op, void (*op_close)(fcom_op *op), fcom_cominfo *cmd, int rc)
+{
+	unmeta_submit(m);
+	if (rc == 0)
+		unmeta_dirs_apply(m);
+
+	if (m->nbusy == 0)
+		return 0;
+
+	m->op = op;
+	m->op_close = op_close;
+	m->cmd = cmd;
+	m->rc = rc;
+	m->wait = 1;
+	return 1;
+}
+
+static void unmeta_destroy(struct unmeta *m)
+{
+	if (m->batch != NULL) {
+		unmeta_batch_proc(m->batch);
+		unmeta_batch_free(m->batch);
+		m->batch = NULL;
+	}
+
+	char **ps;
+	FFSLICE_WALK(&m->dir_names, ps) {
+		ffmem_free(*ps);
+	}
+	ffvec_free(&m->dir_names);
+	ffmap_free(&m->dirs);
+
+	struct unmeta_dirtime *d;
+	FFSLICE_WALK(&m->dir_mtimes, d) {
+		ffmem_free(d->name);
+	}
+	ffvec_free(&m->dir_mtimes);
+}
@@ -14,6 +14,7 @@ OPTIONS:\n\
         `--autodir`   Add to OUTPUT_DIR a directory with name = input archive name.\n\
                      Same as manual 'unpack arc.xxx -C odir/arc'.\n\
     `-k`, `--skip`      Skip files on error\n\
+        `--workers` N Use N worker threads for .7z and .xz (see 'un7z' and 'unxz')\n\
 ";
 }
 
@@ -38,6 +39,7 @@ struct unpack {
 	u_char list, list_plain;
 	u_char autodir;
 	u_char skip;
+	uint workers;
 };
 
 /** Find operation name by file extension */
@@ -117,6 +119,14 @@ static int unpack_child(struct unpack *u, const char *opname, uint level)
 	else
 		ffstr_dupz(p, "");
 
+	ffvec a = {};
+
+	if (u->workers != 1
+		&& (ffsz_eq(opname, "unxz") || ffsz_eq(opname, "un7z"))) {
+		*ffvec_pushT(&a, char*) = ffsz_dup("--workers");
+		*ffvec_pushT(&a, char*) = ffsz_allocfmt("%u", u->workers);
+	}
+
 	if (level == 1) {
 		c->stdout = 1;
 		c->fd_stdout = u->pw;
@@ -128,8 +138,6 @@ static int unpack_child(struct unpack *u, const char *opname, uint level)
 		ffstrz_dup_str0(&c->output, u->cmd->output);
 		ffstr_dup_str0(&c->chdir, u->cmd->chdir);
 
-		ffvec a = {};
-
 		if (u->autodir)
 			*ffvec_pushT(&a, char*) = ffsz_dup("--autodir");
 
@@ -142,12 +150,6 @@ static int unpack_child(struct unpack *u, const char *opname, uint level)
 		if (u->skip)
 			*ffvec_pushT(&a, char*) = ffsz_dup("--skip");
 
-		if (a.len) {
-			ffvec_zpushT(&a, char*);
-			c->argv = a.ptr;
-			c->argc = a.len - 1;
-		}
-
 		c->on_complete = unpack_op_complete;
 		c->opaque = u;
 
@@ -157,6 +159,12 @@ static int unpack_child(struct unpack *u, const char *opname, uint level)
 		}
 	}
 
+	if (a.len) {
+		ffvec_zpushT(&a, char*);
+		c->argv = a.ptr;
+		c->argc = a.len - 1;
+	}
+
 	c->test = u->cmd->test;
 	c->buffer_size = u->cmd->buffer_size;
 	c->directio = u->cmd->directio;
@@ -199,6 +207,7 @@ static int unpack_args_parse(struct unpack *u, fcom_cominfo *cmd)
 		{ "--list",					'1',	O(list) },
 		{ "--plain",				'1',	O(list_plain) },
 		{ "--skip",					'1',	O(skip) },
+		{ "--workers",				'u',	O(workers) },
 		{ "-k",						'1',	O(skip) },
 		{ "-l",						'1',	O(list) },
 		{}
@@ -225,6 +234,7 @@ static fcom_op* unpack_create(fcom_cominfo *cmd)
 	struct unpack *u = ffmem_new(struct unpack);
 	u->cmd = cmd;
 	u->pr = u->pw = FFPIPE_NULL;
+	u->workers = 1;
 
 	if (0 != unpack_args_parse(u, cmd))
 		goto end;
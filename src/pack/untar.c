@@ -27,6 +27,9 @@ OPTIONS:\n\
 
 extern const fcom_core *core;
 
+#include <pack/zcopy.h>
+#include <pack/unpack-meta.h>
+
 struct untar {
 	fcom_cominfo cominfo;
 
@@ -36,6 +39,9 @@ struct untar {
 	ffstr iname, base;
 	ffstr tardata, plain;
 	fcom_file_obj *in, *out;
+	uint64 in_off;
+	struct zcopy zc;
+	struct unmeta meta;
 	char *oname;
 	ffvec buf;
 	uint stop;
@@ -139,6 +145,7 @@ static void untar_close(fcom_op *op)
 	ffmem_free(t->oname);
 	ffvec_free(&t->members_data);
 	ffmap_free(&t->members);
+	unmeta_destroy(&t->meta);
 	ffmem_free(t);
 }
 
@@ -154,6 +161,8 @@ static fcom_op* untar_create(fcom_cominfo *cmd)
 	fcom_cmd_file_conf(&fc, cmd);
 	t->in = core->file->create(&fc);
 	t->out = core->file->create(&fc);
+	t->zc.off = cmd->stdin;
+	unmeta_init(&t->meta, cmd);
 
 	ffsize cap = (cmd->buffer_size != 0) ? cmd->buffer_size : 64*1024;
 	ffvec_alloc(&t->buf, cap, 1);
@@ -299,9 +308,11 @@ static void untar_run(fcom_op *op)
 
 		case I_INFO: {
 			uint flags = fcom_file_cominfo_flags_i(t->cmd);
-			flags |= FCOM_FILE_READ;
+			flags |= FCOM_FILE_READ | FCOM_FILE_MMAP;
+			zcopy_reset(&t->zc);
 			r = core->file->open(t->in, t->iname.ptr, flags);
 			if (r == FCOM_FILE_ERR) goto end;
+			t->in_off = 0;
 
 			fffileinfo fi = {};
 			r = core->file->info(t->in, &fi);
@@ -327,6 +338,7 @@ static void untar_run(fcom_op *op)
 		}
 
 		case I_FILEREAD:
+			zcopy_reset(&t->zc);
 			r = core->file->read(t->in, &t->tardata, -1);
 			if (r == FCOM_FILE_ERR) goto end;
 			if (r == FCOM_FILE_ASYNC) {
@@ -337,6 +349,8 @@ static void untar_run(fcom_op *op)
 				fcom_errlog("incomplete archive");
 				goto end;
 			}
+			zcopy_read(&t->zc, t->in, t->tardata, t->in_off);
+			t->in_off += t->tardata.len;
 			t->state = I_PARSE;
 			// fallthrough
 
@@ -349,19 +363,23 @@ static void untar_run(fcom_op *op)
 
 				fftime t1 = tf->mtime;
 				t1.sec += FFTIME_1970_SECONDS;
-				core->file->mtime_set(t->out, t1);
 
+				if (tf->type == TAR_DIR) {
+					unmeta_dir_mtime(&t->meta, t->oname, t1);
+					continue;
+				}
+
+				if (tf->type == TAR_FILE || tf->type == TAR_FILE0) {
+					uint attr = 0;
 #ifdef FF_UNIX
-				if (tf->type == TAR_FILE)
-					core->file->attr_set(t->out, tf->attr_unix);
+					if (tf->type == TAR_FILE)
+						attr = tf->attr_unix;
 #endif
-
-				if (tf->type != TAR_DIR) {
-					core->file->close(t->out);
+					unmeta_file_close(&t->meta, t->out, t->oname, t1, attr);
 					t->del_on_close = 0;
-					fcom_verblog("%s", t->oname);
-					ffmem_free(t->oname);  t->oname = NULL;
 				}
+				fcom_verblog("%s", t->oname);
+				ffmem_free(t->oname);  t->oname = NULL;
 				continue;
 			}
 
@@ -391,13 +409,15 @@ static void untar_run(fcom_op *op)
 				break;
 
 			case TAR_DIR:
-				r = core->file->dir_create(t->oname, FCOM_FILE_DIR_RECURSIVE);
-				if (r == FCOM_FILE_ERR) goto end;
+				if (unmeta_dir_create(&t->meta, FFSTR_Z(t->oname)))
+					goto end;
 				t->state = I_PARSE;
 				continue;
 
 			case TAR_HLINK:
 			case TAR_SLINK: {
+				if (unmeta_parent_create(&t->meta, t->oname))
+					goto end;
 				char *old = ffsz_dupstr(&tf->link_to);
 
 				uint flags = (t->cmd->overwrite) ? FCOM_FILE_CREATE : 0;
@@ -413,6 +433,10 @@ static void untar_run(fcom_op *op)
 			}
 			}
 
+			if (!t->cmd->stdout
+				&& unmeta_parent_create(&t->meta, t->oname))
+				goto end;
+
 			uint flags = FCOM_FILE_WRITE;
 			flags |= fcom_file_cominfo_flags_o(t->cmd);
 			r = core->file->open(t->out, t->oname, flags);
@@ -426,6 +450,13 @@ static void untar_run(fcom_op *op)
 		}
 
 		case I_WRITE:
+			if (0 > zcopy_write(&t->zc, t->out, t->in, &t->plain, -1))
+				goto end;
+			if (t->plain.len == 0) {
+				t->state = I_PARSE;
+				continue;
+			}
+
 			r = core->file->write(t->out, t->plain, -1);
 			if (r == FCOM_FILE_ERR) goto end;
 			if (r == FCOM_FILE_ASYNC) {
@@ -439,6 +470,8 @@ static void untar_run(fcom_op *op)
 	}
 
 end:
+	if (unmeta_finish(&t->meta, t, untar_close, t->cmd, rc))
+		return;
 	{
 	fcom_cominfo *cmd = t->cmd;
 	untar_close(t);
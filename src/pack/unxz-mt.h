@@ -0,0 +1,317 @@
+/** fcom: unxz: decode .xz blocks in parallel
+2026, Simon Zolin */
+
+/*
+--workers N:
+.xz file consists of streams:
+	STREAM_HEADER(12) BLOCK... INDEX STREAM_FOOTER(12) [STREAM_PADDING(4*N)]
+INDEX holds (UNPADDED_SIZE, UNCOMPRESSED_SIZE) of each block;
+ its size is stored in STREAM_FOOTER, so the file is parsed from the end.
+Each block is compressed independently (e.g. by 'xz -T'),
+ so a job decodes it with its own reader: STREAM_HEADER is passed first, then the block data.
+Block N is decoded by job N%JOBS into its own buffer,
+ and the main thread writes the buffers in order, so the output may be a pipe.
+A job is restarted for the next block after its buffer is written.
+A file with 1 block, an unknown index or the data from stdin are decoded by the main thread as usual.
+*/
+
+#define UNXZ_MT_MEM  (1*1024*1024*1024ULL) // max. memory for the decoded blocks
+
+struct unxz_block {
+	uint64 off, size; // block data within the file
+	uint64 usize; // uncompressed size
+	u_char hdr[12]; // header of the stream
+};
+
+struct unxz_job {
+	struct unxz *z;
+	fcom_file_obj *in;
+	uint iblock;
+	ffvec data; // decoded block
+	uint ready :1;
+	uint err :1;
+	fcom_job job;
+};
+
+/** Read N bytes at offset */
+static int unxz_mt_read(fcom_file_obj *f, ffvec *buf, uint64 off, ffsize n)
+{
+	buf->len = 0;
+	ffvec_grow(buf, n, 1);
+	while (buf->len != n) {
+		ffstr d;
+		if (FCOM_FILE_OK != core->file->read(f, &d, off + buf->len))
+			return -1;
+		ffvec_add(buf, d.ptr, ffmin(d.len, n - buf->len), 1);
+	}
+	return 0;
+}
+
+/** Read variable-length integer */
+static int unxz_varint(ffstr *d, uint64 *val)
+{
+	uint64 v = 0;
+	for (uint i = 0;  i != 9 && i != d->len;  i++) {
+		uint c = (u_char)d->ptr[i];
+		v |= (uint64)(c & 0x7f) << (i * 7);
+		if (!(c & 0x80)) {
+			ffstr_shift(d, i + 1);
+			*val = v;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static int unxz_block_cmp(const void *_a, const void *_b, void *udata)
+{
+	const struct unxz_block *a = _a, *b = _b;
+	return (a->off < b->off) ? -1 : (a->off > b->off);
+}
+
+/** Get the list of blocks from the indexes of all streams.
+Return N of blocks;  0: not supported */
+static uint unxz_index(struct unxz *z)
+{
+	static const u_char magic[6] = { 0xfd, '7', 'z', 'X', 'Z', 0 };
+	ffvec buf = {};
+	uint64 end = z->isize;
+	uint n = 0;
+	z->mt_blocks.len = 0;
+
+	while (end != 0) {
+		if (end < 32 || (end & 3))
+			goto end;
+
+		if (unxz_mt_read(z->in, &buf, end - 4, 4))
+			goto end;
+		if (0 == ffint_le_cpu32_ptr(buf.ptr)) {
+			end -= 4; // stream padding
+			continue;
+		}
+
+		// footer: CRC32(4) BACKWARD_SIZE(4) FLAGS(2) "YZ"
+		if (unxz_mt_read(z->in, &buf, end - 12, 12))
+			goto end;
+		const u_char *f = buf.ptr;
+		if (!(f[10] == 'Y' && f[11] == 'Z'))
+			goto end;
+		uint flags = ffint_le_cpu16_ptr(f + 8);
+		uint64 isize = ((uint64)ffint_le_cpu32_ptr(f + 4) + 1) * 4;
+		if (isize + 12 + 12 > end)
+			goto end;
+		uint64 ioff = end - 12 - isize;
+
+		// index: 0x00 N_RECORDS (UNPADDED_SIZE UNCOMPRESSED_SIZE)... PADDING CRC32
+		if (unxz_mt_read(z->in, &buf, ioff, isize))
+			goto end;
+		ffstr d = FFSTR_INITN(buf.ptr, isize - 4);
+		uint64 nrec, unpadded, usize, csize = 0;
+		if (d.ptr[0] != 0)
+			goto end;
+		ffstr_shift(&d, 1);
+		if (unxz_varint(&d, &nrec) || nrec > d.len / 2)
+			goto end;
+
+		ffsize first = z->mt_blocks.len;
+		for (uint64 i = 0;  i != nrec;  i++) {
+			if (unxz_varint(&d, &unpadded) || unxz_varint(&d, &usize))
+				goto end;
+			struct unxz_block *b = ffvec_pushT(&z->mt_blocks, struct unxz_block);
+			b->off = csize;
+			b->size = ffint_align_ceil2(unpadded, 4);
+			b->usize = usize;
+			csize += b->size;
+		}
+		if (csize + 12 > ioff)
+			goto end;
+		uint64 soff = ioff - csize - 12;
+
+		if (unxz_mt_read(z->in, &buf, soff, 12))
+			goto end;
+		const u_char *h = buf.ptr;
+		if (ffmem_cmp(h, magic, 6) || ffint_le_cpu16_ptr(h + 6) != flags)
+			goto end;
+
+		for (ffsize i = first;  i != z->mt_blocks.len;  i++) {
+			struct unxz_block *b = ffslice_itemT(&z->mt_blocks, i, struct unxz_block);
+			b->off += soff + 12;
+			ffmem_copy(b->hdr, h, 12);
+		}
+		end = soff;
+	}
+
+	// the streams were added from the last one
+	ffsort(z->mt_blocks.ptr, z->mt_blocks.len, sizeof(struct unxz_block), unxz_block_cmp, NULL);
+	n = z->mt_blocks.len;
+	fcom_dbglog("%S: %u blocks", &z->iname, n);
+
+end:
+	ffvec_free(&buf);
+	return n;
+}
+
+/** Worker thread: decode 1 block */
+static void unxz_job_proc(void *param)
+{
+	struct unxz_job *j = param;
+	struct unxz *z = j->z;
+	const struct unxz_block *b = ffslice_itemT(&z->mt_blocks, j->iblock, struct unxz_block);
+	uint64 off = b->off, end = b->off + b->size;
+	ffstr in = FFSTR_INITN(b->hdr, 12), out;
+	ffxzread x = {};
+	j->err = 1;
+	j->data.len = 0;
+	ffvec_grow(&j->data, b->usize, 1);
+
+	if (0 != ffxzread_open(&x, 0)) {
+		fcom_errlog("ffxzread_open");
+		return;
+	}
+
+	while (!FFINT_READONCE(z->stop)) {
+		int r = ffxzread_process(&x, &in, &out);
+		switch ((enum FFXZREAD_R)r) {
+		case FFXZREAD_INFO:
+			continue;
+
+		case FFXZREAD_DATA:
+			if (out.len > b->usize - j->data.len)
+				goto size_err;
+			ffvec_addstr(&j->data, &out);
+			continue;
+
+		case FFXZREAD_MORE:
+			if (off == end) {
+				if (j->data.len != b->usize)
+					goto size_err;
+				j->err = 0;
+				goto end;
+			}
+			if (FCOM_FILE_OK != core->file->read(j->in, &in, off))
+				goto end;
+			in.len = ffmin(in.len, end - off);
+			off += in.len;
+			continue;
+
+		case FFXZREAD_ERROR:
+			fcom_errlog("ffxzread_process: %s  offset:0x%xU", ffxzread_error(&x), off);
+			goto end;
+
+		default:
+			fcom_errlog("block at 0x%xU: unexpected reader state %d", b->off, r);
+			goto end;
+		}
+	}
+	goto end;
+
+size_err:
+	fcom_errlog("block at 0x%xU: uncompressed size doesn't match the index", b->off);
+
+end:
+	ffxzread_close(&x);
+}
+
+static void unxz_run(fcom_op *op);
+
+/** Main thread: a job is complete */
+static void unxz_job_done(void *param)
+{
+	struct unxz_job *j = param;
+	struct unxz *z = j->z;
+	if (j->job.cancelled)
+		j->err = 1;
+	if (j->err)
+		z->mt_fail = 1;
+	j->ready = 1;
+	z->mt_nbusy--;
+
+	if (!z->mt_wait)
+		return;
+	if ((z->mt_fail || FFINT_READONCE(z->stop)) && z->mt_nbusy != 0)
+		return; // wait for all jobs
+	z->mt_wait = 0;
+	unxz_run(z);
+}
+
+/** Main thread: start decoding the next blocks by the free jobs */
+static void unxz_mt_schedule(struct unxz *z)
+{
+	while (z->mt_istart != z->mt_blocks.len
+		&& z->mt_istart < z->mt_iwrite + z->mt_njobs) {
+		struct unxz_job *j = &z->mt_jobs[z->mt_istart % z->mt_njobs];
+		j->iblock = z->mt_istart++;
+		j->ready = 0;
+		z->mt_nbusy++;
+		fcom_job_set(&j->job, unxz_job_proc, unxz_job_done, j, z);
+		core->job(&j->job);
+	}
+}
+
+static void unxz_mt_free(struct unxz *z)
+{
+	for (uint i = 0;  i != z->mt_njobs;  i++) {
+		struct unxz_job *j = &z->mt_jobs[i];
+		core->file->destroy(j->in);
+		ffvec_free(&j->data);
+	}
+	ffmem_free(z->mt_jobs);
+	z->mt_jobs = NULL;
+	z->mt_njobs = 0;
+}
+
+/** Prepare decoding the blocks by the worker threads.
+Return 0: success;  1: the file must be decoded by the main thread;  <0: error */
+static int unxz_mt_start(struct unxz *z)
+{
+	uint n = unxz_index(z);
+	if (n <= 1)
+		return 1;
+
+	uint64 umax = 0;
+	z->mt_isize = z->mt_osize = 0;
+	const struct unxz_block *b;
+	FFSLICE_WALK(&z->mt_blocks, b) {
+		umax = ffmax(umax, b->usize);
+		z->mt_isize += b->size;
+		z->mt_osize += b->usize;
+	}
+
+	uint njobs = ffmin(z->workers, n);
+	njobs = ffmin(njobs, ffmax(UNXZ_MT_MEM / ffmax(umax, 1), 1));
+	if (njobs <= 1)
+		return 1;
+
+	unxz_mt_free(z);
+	z->mt_njobs = njobs;
+	z->mt_jobs = ffmem_calloc(z->mt_njobs, sizeof(struct unxz_job));
+
+	struct fcom_file_conf fc = {};
+	fcom_cmd_file_conf(&fc, z->cmd);
+	uint flags = fcom_file_cominfo_flags_i(z->cmd);
+	flags |= FCOM_FILE_READ | FCOM_FILE_MMAP;
+
+	for (uint i = 0;  i != z->mt_njobs;  i++) {
+		struct unxz_job *j = &z->mt_jobs[i];
+		j->z = z;
+		j->in = core->file->create(&fc);
+		if (FCOM_FILE_ERR == core->file->open(j->in, z->iname.ptr, flags))
+			return -1;
+	}
+
+	fcom_dbglog("%S: decoding %u blocks by %u jobs", &z->iname, n, z->mt_njobs);
+	z->mt_istart = z->mt_iwrite = 0;
+	z->mt_fail = 0;
+	z->mt = 1;
+	return 0;
+}
+
+/** Main thread: all blocks are written */
+static void unxz_mt_complete(struct unxz *z)
+{
+	for (uint i = 0;  i != z->mt_njobs;  i++) {
+		core->file->close(z->mt_jobs[i].in);
+	}
+	z->in_total += z->mt_isize;
+	z->mt = 0;
+}
@@ -7,6 +7,10 @@ static const char* unxz_help()
 Decompress file from .xz.\n\
 Usage:\n\
   `fcom unxz` INPUT [OPTIONS] [-o OUTPUT]\n\
+\n\
+OPTIONS:\n\
+        `--workers` N Decode N blocks in parallel (for a file compressed by 'xz -T')\n\
+                     (0: use all worker threads; default: 1)\n\
 ";
 }
 
@@ -35,11 +39,26 @@ struct unxz {
 	uint del_on_close :1;
 
 	uint64 in_total, out_total;
+
+	// --workers
+	ffvec mt_blocks; // struct unxz_block[]
+	uint64 mt_isize, mt_osize;
+	struct unxz_job *mt_jobs;
+	uint mt_njobs, mt_nbusy;
+	uint mt_istart, mt_iwrite; // the next block to decode, to write
+	uint mt :1; // the current file is decoded by the jobs
+	uint mt_wait :1; // waiting for a job
+	uint mt_fail :1;
+
+	uint workers;
 };
 
+#define O(member)  (void*)FF_OFF(struct unxz, member)
+
 static int args_parse(struct unxz *z, fcom_cominfo *cmd)
 {
 	static const struct ffarg args[] = {
+		{ "--workers",				'u',	O(workers) },
 		{}
 	};
 	int r = core->com->args_parse(cmd, args, z, FCOM_COM_AP_INOUT);
@@ -48,9 +67,16 @@ static int args_parse(struct unxz *z, fcom_cominfo *cmd)
 
 	if (cmd->chdir.len == 0)
 		ffstr_dupz(&cmd->chdir, ".");
+
+	if (z->workers == 0)
+		z->workers = ffmax(core->workers, 1);
 	return 0;
 }
 
+#undef O
+
+static void unxz_mt_free(struct unxz *z);
+
 static void unxz_close(fcom_op *op)
 {
 	struct unxz *z = op;
@@ -60,6 +86,8 @@ static void unxz_close(fcom_op *op)
 		core->file->del(z->oname, 0);
 	core->file->destroy(z->out);
 	ffmem_free(z->oname);
+	unxz_mt_free(z);
+	ffvec_free(&z->mt_blocks);
 	ffmem_free(z);
 }
 
@@ -67,6 +95,7 @@ static fcom_op* unxz_create(fcom_cominfo *cmd)
 {
 	struct unxz *z = ffmem_new(struct unxz);
 	z->cmd = cmd;
+	z->workers = 1;
 
 	if (0 != args_parse(z, cmd))
 		goto end;
@@ -150,11 +179,13 @@ static int xzread(struct unxz *z, ffstr *in, ffstr *out)
 	return 'erro';
 }
 
+#include <pack/unxz-mt.h>
+
 static void unxz_run(fcom_op *op)
 {
 	struct unxz *z = op;
 	int r, rc = 1;
-	enum { I_IN, I_IN_OPEN, I_OUT_OPEN, I_READ, I_DECOMP, I_WRITE, };
+	enum { I_IN, I_IN_OPEN, I_OUT_OPEN, I_READ, I_DECOMP, I_WRITE, I_MT, I_MT_WRITE, I_MT_DONE, };
 
 	while (!FFINT_READONCE(z->stop)) {
 		switch (z->st) {
@@ -182,6 +213,21 @@ static void unxz_run(fcom_op *op)
 			z->isize = fffileinfo_size(&fi);
 
 			z->st = I_READ;
+			if (z->workers > 1 && z->isize != 0 && !z->cmd->stdin) {
+				r = unxz_mt_start(z);
+				if (r < 0)
+					goto end;
+				if (r == 0) {
+					z->st = I_MT;
+					if (!z->out_opened) {
+						z->out_opened = 1;
+						if (!z->cmd->stdout)
+							z->oname = out_name(z, z->iname, z->basename);
+						z->st = I_OUT_OPEN;
+					}
+					continue;
+				}
+			}
 		}
 			// fallthrough
 
@@ -194,6 +240,7 @@ static void unxz_run(fcom_op *op)
 			}
 			if (r == FCOM_FILE_EOF) {
 				r = core->file->flush(z->out, 0);
+				if (r == FCOM_FILE_ERR) goto end;
 				if (r == FCOM_FILE_ASYNC) {
 					core->com->async(z->cmd);
 					return;
@@ -252,6 +299,11 @@ static void unxz_run(fcom_op *op)
 			core->file->mtime_set(z->out, fffileinfo_mtime1(&fi));
 
 			z->st = I_WRITE;
+			if (z->mt) {
+				if (!z->cmd->stdout)
+					core->file->trunc(z->out, z->mt_osize);
+				z->st = I_MT;
+			}
 			continue;
 		}
 
@@ -265,10 +317,65 @@ static void unxz_run(fcom_op *op)
 
 			z->st = I_DECOMP;
 			continue;
+
+		case I_MT: {
+			if (z->mt_fail)
+				goto end;
+			unxz_mt_schedule(z);
+			if (z->mt_iwrite == z->mt_blocks.len) {
+				z->st = I_MT_DONE;
+				continue;
+			}
+			const struct unxz_job *j = &z->mt_jobs[z->mt_iwrite % z->mt_njobs];
+			if (!j->ready) {
+				z->mt_wait = 1;
+				return;
+			}
+			ffstr_set(&z->data, j->data.ptr, j->data.len);
+			z->st = I_MT_WRITE;
+		}
+			// fallthrough
+
+		case I_MT_WRITE:
+			r = core->file->write(z->out, z->data, -1);
+			if (r == FCOM_FILE_ERR) goto end;
+			if (r == FCOM_FILE_ASYNC) {
+				core->com->async(z->cmd);
+				return;
+			}
+
+			z->out_total += z->data.len;
+			z->mt_iwrite++;
+			z->st = I_MT;
+			continue;
+
+		case I_MT_DONE:
+			r = core->file->flush(z->out, 0);
+			if (r == FCOM_FILE_ERR) goto end;
+			if (r == FCOM_FILE_ASYNC) {
+				core->com->async(z->cmd);
+				return;
+			}
+
+			unxz_mt_complete(z);
+			fcom_verblog("%s: %U => %U (%u%%)"
+				, z->oname, z->in_total, z->out_total, (uint)FFINT_DIVSAFE(z->out_total * 100, z->in_total));
+			z->del_on_close = 0;
+			z->st = I_IN;
+			continue;
 		}
 	}
 
 end:
+	if (z->mt_nbusy != 0) {
+		// wait for all jobs, then finish:
+		//  don't re-enter the previous state (e.g. I_MT_WRITE would write the same data again)
+		z->mt_fail = 1;
+		z->mt_wait = 1;
+		z->st = I_MT; // -> end
+		return;
+	}
+
 	{
 	fcom_cominfo *cmd = z->cmd;
 	unxz_close(z);
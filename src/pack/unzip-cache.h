@@ -0,0 +1,316 @@
+/** fcom: unzip: central directory cache
+2026, Simon Zolin */
+
+/*
+--cdir-cache DIR:
+After the central directory of an archive is parsed, the table of its members is saved to
+ DIR/HASH.zipcd, where HASH is the hash of the absolute archive path.
+The file is valid while the archive's path, size and modification time are the same.
+Next time the file is mapped into memory and used instead of reading the central directory:
+ --list prints the members directly;
+ -m with full names looks up each name by binary search (the names are pre-sorted);
+ -m with wildcards walks the names without parsing anything.
+The file is written to a temporary file first and then renamed, so a reader never sees a partial file.
+
+Format (host byte order, the entries are 8-byte aligned):
+	struct zcd_hdr
+	char path[path_len], padding
+	struct zcd_ent[n] // in the archive order
+	uint sorted[n], padding // indexes of the entries sorted by name
+	char names[names_len]
+*/
+
+#include <ffbase/murmurhash3.h>
+
+#define ZCD_MAGIC  "fcomzcd\x01"
+
+struct zcd_hdr {
+	char magic[8];
+	uint64 size;
+	int64 mtime_sec;
+	uint mtime_nsec;
+	uint n;
+	uint64 names_len;
+	uint path_len;
+	uint reserved;
+};
+
+struct zcd_ent {
+	uint64 off, zsize, size;
+	int64 mtime_sec;
+	uint mtime_nsec;
+	uint attr_unix, attr_win;
+	uint name_len;
+	uint64 name_off;
+};
+
+static ffsize zcd_layout(const struct zcd_hdr *h, ffsize *ents_off, ffsize *sorted_off, ffsize *names_off)
+{
+	*ents_off = ffint_align_ceil2(sizeof(struct zcd_hdr) + h->path_len, 8);
+	*sorted_off = *ents_off + (ffsize)h->n * sizeof(struct zcd_ent);
+	*names_off = ffint_align_ceil2(*sorted_off + (ffsize)h->n * sizeof(uint), 8);
+	return *names_off + h->names_len;
+}
+
+/** Get the absolute archive path and the cache file name */
+static int unzip_cache_name(struct unzip *z)
+{
+	ffvec p = {};
+#ifdef FF_UNIX
+	char cwd[4096];
+	if (!ffpath_abs(z->iname.ptr, z->iname.len)
+		&& NULL != getcwd(cwd, sizeof(cwd)))
+		ffvec_addfmt(&p, "%s/", cwd);
+#endif
+	ffvec_addstr(&p, &z->iname);
+	ffvec_grow(&p, 1, 1);
+	int r = ffpath_normalize(p.ptr, p.cap, p.ptr, p.len, 0);
+	if (r <= 0) {
+		ffvec_free(&p);
+		return -1;
+	}
+	p.len = r;
+
+	ffstr_free(&z->cache_path);
+	ffstr_set(&z->cache_path, p.ptr, p.len);
+	ffmem_free(z->cache_fn);
+	z->cache_fn = ffsz_allocfmt("%S%c%08xu.zipcd"
+		, &z->cdir_cache, FFPATH_SLASH, murmurhash3(p.ptr, p.len, 0x7a697063));
+	return 0;
+}
+
+/** Map the cache file and check that it's valid for the current archive.
+Return 0: cache hit */
+static int unzip_cache_load(struct unzip *z)
+{
+	if (unzip_cache_name(z))
+		return -1;
+
+	struct fcom_file_conf fc = {};
+	if (z->cache == NULL)
+		z->cache = core->file->create(&fc);
+
+	uint flags = FCOM_FILE_READ | FCOM_FILE_MMAP;
+	fffileinfo fi;
+	if (0 != fffile_info_path(z->cache_fn, &fi))
+		return -1; // no cache yet
+	if (FCOM_FILE_OK != core->file->open(z->cache, z->cache_fn, flags))
+		return -1;
+
+	ffstr d;
+	if (FCOM_FILE_OK != core->file->read(z->cache, &d, 0)
+		|| d.len != fffileinfo_size(&fi)
+		|| d.len < sizeof(struct zcd_hdr))
+		goto fail;
+
+	const struct zcd_hdr *h = (void*)d.ptr;
+	ffsize ents_off, sorted_off, names_off;
+	if (ffmem_cmp(h->magic, ZCD_MAGIC, 8)
+		|| h->size != z->f_size
+		|| h->mtime_sec != z->f_mtime.sec
+		|| h->mtime_nsec != z->f_mtime.nsec
+		|| h->path_len != z->cache_path.len
+		|| ffmem_cmp(h + 1, z->cache_path.ptr, h->path_len)
+		|| h->n > d.len / sizeof(struct zcd_ent)
+		|| d.len != zcd_layout(h, &ents_off, &sorted_off, &names_off))
+		goto fail;
+
+	z->zcd_ents = (void*)(d.ptr + ents_off);
+	z->zcd_sorted = (void*)(d.ptr + sorted_off);
+	z->zcd_names = d.ptr + names_off;
+	z->zcd_n = h->n;
+
+	for (uint i = 0;  i != h->n;  i++) {
+		const struct zcd_ent *e = &z->zcd_ents[i];
+		if (e->name_off > h->names_len
+			|| e->name_len > h->names_len - e->name_off
+			|| z->zcd_sorted[i] >= h->n)
+			goto fail;
+	}
+
+	fcom_dbglog("%s: using central directory cache: %u members", z->cache_fn, h->n);
+	return 0;
+
+fail:
+	fcom_dbglog("%s: cache is stale", z->cache_fn);
+	core->file->close(z->cache);
+	return -1;
+}
+
+/** Add the central directory entry for the cache */
+static void unzip_cache_add(struct unzip *z, const struct file *f, ffstr name)
+{
+	struct zcd_ent *e = ffvec_pushT(&z->cd_ents, struct zcd_ent);
+	e->off = f->off;
+	e->zsize = f->zsize;
+	e->size = f->size;
+	e->mtime_sec = f->mtime.sec;
+	e->mtime_nsec = f->mtime.nsec;
+	e->attr_unix = f->attr_unix;
+	e->attr_win = f->attr_win;
+	e->name_off = z->cd_names.len;
+	e->name_len = name.len;
+	ffvec_addstr(&z->cd_names, &name);
+}
+
+static int zcd_name_cmp(ffstr a, ffstr b)
+{
+	int r = ffmem_cmp(a.ptr, b.ptr, ffmin(a.len, b.len));
+	if (r == 0)
+		r = (a.len < b.len) ? -1 : (a.len > b.len);
+	return r;
+}
+
+static ffstr zcd_name(const struct zcd_ent *ents, const char *names, uint i)
+{
+	ffstr s = FFSTR_INITN(names + ents[i].name_off, ents[i].name_len);
+	return s;
+}
+
+static int zcd_sort_cmp(const void *_a, const void *_b, void *udata)
+{
+	const struct unzip *z = udata;
+	uint a = *(uint*)_a, b = *(uint*)_b;
+	int r = zcd_name_cmp(zcd_name(z->cd_ents.ptr, z->cd_names.ptr, a)
+		, zcd_name(z->cd_ents.ptr, z->cd_names.ptr, b));
+	if (r == 0)
+		r = (a < b) ? -1 : 1;
+	return r;
+}
+
+/** Save the central directory entries to the cache file */
+static void unzip_cache_save(struct unzip *z)
+{
+	ffvec sorted = {}, d = {};
+	char *tmp = NULL;
+	uint n = z->cd_ents.len;
+
+	ffvec_alloc(&sorted, n, sizeof(uint));
+	for (uint i = 0;  i != n;  i++) {
+		*ffvec_pushT(&sorted, uint) = i;
+	}
+	ffsort(sorted.ptr, n, sizeof(uint), zcd_sort_cmp, z);
+
+	struct zcd_hdr h = {};
+	ffmem_copy(h.magic, ZCD_MAGIC, 8);
+	h.size = z->f_size;
+	h.mtime_sec = z->f_mtime.sec;
+	h.mtime_nsec = z->f_mtime.nsec;
+	h.n = n;
+	h.names_len = z->cd_names.len;
+	h.path_len = z->cache_path.len;
+	ffsize ents_off, sorted_off, names_off;
+	ffsize total = zcd_layout(&h, &ents_off, &sorted_off, &names_off);
+
+	ffvec_alloc(&d, total, 1);
+	ffmem_zero(d.ptr, total);
+	ffmem_copy(d.ptr, &h, sizeof(h));
+	ffmem_copy((char*)d.ptr + sizeof(h), z->cache_path.ptr, h.path_len);
+	ffmem_copy((char*)d.ptr + ents_off, z->cd_ents.ptr, n * sizeof(struct zcd_ent));
+	ffmem_copy((char*)d.ptr + sorted_off, sorted.ptr, n * sizeof(uint));
+	ffmem_copy((char*)d.ptr + names_off, z->cd_names.ptr, z->cd_names.len);
+	d.len = total;
+
+	tmp = ffsz_allocfmt("%s.%xu.tmp", z->cache_fn, core->random());
+	struct fcom_file_conf fc = {};
+	fcom_file_obj *f = core->file->create(&fc);
+	if (FCOM_FILE_ERR == core->file->open(f, tmp, FCOM_FILE_WRITE | FCOM_FILE_CREATE_TRUNC | FCOM_FILE_NO_PREALLOC))
+		goto end;
+	ffstr s = FFSTR_INITSTR(&d);
+	int r = core->file->write(f, s, 0);
+	if (r == FCOM_FILE_OK)
+		r = core->file->flush(f, 0);
+	core->file->close(f);
+	if (r != FCOM_FILE_OK) {
+		core->file->del(tmp, 0);
+		goto end;
+	}
+	if (0 != core->file->move(FFSTR_Z(tmp), FFSTR_Z(z->cache_fn), 0)) {
+		core->file->del(tmp, 0);
+		goto end;
+	}
+	fcom_dbglog("%s: saved central directory cache: %u members", z->cache_fn, n);
+
+end:
+	core->file->destroy(f);
+	ffmem_free(tmp);
+	ffvec_free(&d);
+	ffvec_free(&sorted);
+}
+
+/** Find the range of the sorted entries with this name */
+static uint zcd_find(struct unzip *z, ffstr name, uint *end)
+{
+	uint lo = 0, hi = z->zcd_n;
+	while (lo < hi) {
+		uint mid = lo + (hi - lo) / 2;
+		if (zcd_name_cmp(zcd_name(z->zcd_ents, z->zcd_names, z->zcd_sorted[mid]), name) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	uint i = lo;
+	while (i != z->zcd_n
+		&& 0 == zcd_name_cmp(zcd_name(z->zcd_ents, z->zcd_names, z->zcd_sorted[i]), name)) {
+		i++;
+	}
+	*end = i;
+	return lo;
+}
+
+static int uint_cmp(const void *_a, const void *_b, void *udata)
+{
+	uint a = *(uint*)_a, b = *(uint*)_b;
+	return (a < b) ? -1 : (a > b);
+}
+
+/** Process the cached entries that match the list of archive members */
+static void unzip_cache_files(struct unzip *z)
+{
+	ffvec sel = {}; // uint[]
+
+	if (z->members.len != 0 && z->members_wildcard.len == 0) {
+		ffstr d = FFSTR_INITSTR(&z->members_data);
+		while (d.len) {
+			ffstr ln;
+			ffstr_splitby(&d, '\n', &ln, &d);
+			if (!ln.len)
+				continue;
+			uint end, i = zcd_find(z, ln, &end);
+			for (;  i != end;  i++) {
+				*ffvec_pushT(&sel, uint) = z->zcd_sorted[i];
+			}
+		}
+		// keep the archive order
+		ffsort(sel.ptr, sel.len, sizeof(uint), uint_cmp, NULL);
+
+	} else {
+		for (uint i = 0;  i != z->zcd_n;  i++) {
+			if (members_find(z, zcd_name(z->zcd_ents, z->zcd_names, i)))
+				*ffvec_pushT(&sel, uint) = i;
+		}
+	}
+
+	const uint *it;
+	uint prev = ~0U;
+	FFSLICE_WALK(&sel, it) {
+		if (*it == prev)
+			continue; // the same name is specified twice
+		prev = *it;
+
+		const struct zcd_ent *e = &z->zcd_ents[*it];
+		struct file f = {
+			.off = e->off,
+			.attr_unix = e->attr_unix,
+			.attr_win = e->attr_win,
+			.zsize = e->zsize,
+			.size = e->size,
+			.mtime = { e->mtime_sec, e->mtime_nsec },
+		};
+		unzip_file_add(z, &f, zcd_name(z->zcd_ents, z->zcd_names, *it));
+	}
+
+	ffvec_free(&sel);
+	core->file->close(z->cache);
+}
@@ -22,6 +22,10 @@ OPTIONS:\n\
         `--autodir`   Add to OUTPUT_DIR a directory with name = input archive name.\n\
                      Same as manual 'unzip arc.zip -C odir/arc'.\n\
         `--recovery`  Recovery mode\n\
+        `--cdir-cache` DIR\n\
+                    Save the table of archive members to DIR\n\
+                     and use it next time instead of reading the central directory\n\
+                     (while the archive's path, size and modification time are the same)\n\
     `-k`, `--skip`      Skip files on error\n\
 ";
 }
@@ -34,6 +38,7 @@ OPTIONS:\n\
 extern const fcom_core *core;
 
 #include <pack/unzip-if.h>
+#include <pack/unpack-meta.h>
 
 struct file {
 	uint64 off;
@@ -64,8 +69,22 @@ struct unzip {
 
 	ffvec files; // struct file[]
 	size_t ifile;
+	struct unmeta meta;
 
 	uint64 f_size;
+	fftime f_mtime;
+
+	// --cdir-cache
+	char *cache_fn;
+	ffstr cache_path; // absolute archive path
+	fcom_file_obj *cache;
+	const struct zcd_ent *zcd_ents;
+	const uint *zcd_sorted;
+	const char *zcd_names;
+	uint zcd_n;
+	ffvec cd_ents; // struct zcd_ent[]
+	ffvec cd_names;
+	uint cache_save :1;
 
 	// conf:
 	u_char	list, list_plain;
@@ -75,6 +94,7 @@ struct unzip {
 	ffvec	members_data;
 	ffvec	members_wildcard; // ffstr[]
 	ffmap	members; // char*[]
+	ffstr	cdir_cache;
 };
 
 static int unzip_recovery_list(struct unzip *z, ffstr *input, ffstr *output);
@@ -155,6 +175,7 @@ static int unzip_args_parse(struct unzip *z, fcom_cominfo *cmd)
 {
 	static const struct ffarg args[] = {
 		{ "--autodir",				'1',	O(autodir) },
+		{ "--cdir-cache",			'S',	O(cdir_cache) },
 		{ "--list",					'1',	O(list) },
 		{ "--member",				'+S',	unzip_args_members },
 		{ "--members-from-file",	's',	unzip_args_members_from_file },
@@ -206,6 +227,12 @@ static void unzip_close(fcom_op *op)
 	ffvec_free(&z->members_data);
 	ffmap_free(&z->members);
 	ffvec_free(&z->members_wildcard);
+	core->file->destroy(z->cache);
+	ffmem_free(z->cache_fn);
+	ffstr_free(&z->cache_path);
+	ffvec_free(&z->cd_ents);
+	ffvec_free(&z->cd_names);
+	unmeta_destroy(&z->meta);
 	ffmem_free(z);
 }
 
@@ -221,6 +248,7 @@ static fcom_op* unzip_create(fcom_cominfo *cmd)
 	fcom_cmd_file_conf(&fc, cmd);
 	z->in = core->file->create(&fc);
 	z->out = core->file->create(&fc);
+	unmeta_init(&z->meta, cmd);
 
 	size_t cap = (cmd->buffer_size != 0) ? cmd->buffer_size : 64*1024;
 	ffvec_alloc(&z->buf, cap, 1);
@@ -240,6 +268,9 @@ static void unzip_reset(struct unzip *z)
 	z->roff = -1;
 	z->zipdata.len = 0;
 	z->recovery_list = z->recovery;
+	z->cd_ents.len = 0;
+	z->cd_names.len = 0;
+	z->cache_save = 0;
 }
 
 static int unzip_input_open_next(struct unzip *z)
@@ -253,7 +284,7 @@ static int unzip_input_open_next(struct unzip *z)
 	}
 
 	uint flags = fcom_file_cominfo_flags_i(z->cmd);
-	flags |= FCOM_FILE_READ;
+	flags |= FCOM_FILE_READ | FCOM_FILE_MMAP;
 	r = core->file->open(z->in, z->iname.ptr, flags);
 	if (r == FCOM_FILE_ERR)
 		goto err;
@@ -273,10 +304,14 @@ static int unzip_input_open_next(struct unzip *z)
 		core->com->input_dir(z->cmd, fd);
 	}
 
+	if (z->list && !fffile_isdir(fffileinfo_attr(&fi)))
+		core->file->behaviour(z->in, FCOM_FBEH_RANDOM); // only the central directory is needed
+
 	unzip_reset(z);
 
 	ffzipread_open(&z->rzip, fffileinfo_size(&fi));
 	z->f_size = fffileinfo_size(&fi);
+	z->f_mtime = fffileinfo_mtime1(&fi);
 	z->rzip.log = unzip_log;
 	z->rzip.timezone_offset = core->tz.real_offset;
 	return 0;
@@ -314,35 +349,49 @@ static int unzip_file_write(struct unzip *z, ffstr data)
 }
 
 /* "size zsize(%) date name" */
-static void unzip_showinfo(struct unzip *z, const ffzipread_fileinfo_t *zf)
+static void unzip_showinfo(struct unzip *z, const struct file *f, ffstr name)
 {
 	ffvec *b = &z->buf;
 	b->len = 0;
 
 	if (!z->list_plain) {
-		if (zip_fileinfo_isdir(zf)) {
+		if (f_isdir(f)) {
 			ffvec_addsz(b, "       <DIR>                  ");
 		} else {
-			uint percent = FFINT_DIVSAFE(zf->compressed_size * 100, zf->uncompressed_size);
+			uint percent = FFINT_DIVSAFE(f->zsize * 100, f->size);
 			ffvec_addfmt(b, "%12U%12U(%3u%%)"
-				, zf->uncompressed_size, zf->compressed_size, percent);
+				, f->size, f->zsize, percent);
 		}
 		ffvec_addchar(b, ' ');
 
 		ffdatetime dt;
-		fftime m = zf->mtime;
-		m.sec += FFTIME_1970_SECONDS + core->tz.real_offset;
+		fftime m = f->mtime;
+		m.sec += core->tz.real_offset;
 
 		fftime_split1(&dt, &m);
 		b->len += fftime_tostr1(&dt, ffslice_end(b, 1), ffvec_unused(b), FFTIME_DATE_YMD | FFTIME_HMS);
 		ffvec_addchar(b, ' ');
 	}
 
-	ffvec_addstr(b, &zf->name);
+	ffvec_addstr(b, &name);
 	ffvec_addchar(b, '\n');
 	ffstdout_write(b->ptr, b->len);
 }
 
+static void unzip_file_add(struct unzip *z, const struct file *f, ffstr name)
+{
+	if (z->list) {
+		unzip_showinfo(z, f, name);
+		z->total_comp += f->zsize;
+		z->total_uncomp += f->size;
+		return;
+	}
+
+	*ffvec_pushT(&z->files, struct file) = *f;
+}
+
+#include <pack/unzip-cache.h>
+
 static void unzip_f_info(struct unzip *z)
 {
 	const ffzipread_fileinfo_t *zf = ffzipread_fileinfo(&z->rzip);
@@ -354,24 +403,22 @@ static void unzip_f_info(struct unzip *z)
 		&& (zf->compressed_size != 0 || zf->uncompressed_size != 0))
 		fcom_infolog("directory %S has non-zero size", &zf->name);
 
+	struct file f = {};
+	f.attr_unix = zf->attr_unix;
+	f.attr_win = zf->attr_win;
+	f.size = zf->uncompressed_size;
+	f.zsize = zf->compressed_size;
+	f.mtime = zf->mtime;
+	f.mtime.sec += FFTIME_1970_SECONDS;
+	f.off = zf->hdr_offset;
+
+	if (z->cache_save)
+		unzip_cache_add(z, &f, zf->name);
+
 	if (!members_find(z, zf->name))
 		return;
 
-	if (z->list) {
-		unzip_showinfo(z, zf);
-		z->total_comp += zf->compressed_size;
-		z->total_uncomp += zf->uncompressed_size;
-		return;
-	}
-
-	struct file *f = ffvec_pushT(&z->files, struct file);
-	f->attr_unix = zf->attr_unix;
-	f->attr_win = zf->attr_win;
-	f->size = zf->uncompressed_size;
-	f->zsize = zf->compressed_size;
-	f->mtime = zf->mtime;
-	f->mtime.sec += FFTIME_1970_SECONDS;
-	f->off = zf->hdr_offset;
+	unzip_file_add(z, &f, zf->name);
 }
 
 /*
@@ -420,6 +467,10 @@ static int unzip_read(struct unzip *z, ffstr *input, ffstr *output)
 		}
 
 		case FFZIPREAD_DONE:
+			if (z->cache_save) {
+				unzip_cache_save(z);
+				z->cache_save = 0;
+			}
 			ffzipread_close(&z->rzip);
 			// fallthrough
 		case FFZIPREAD_DATA:
@@ -522,17 +573,15 @@ static void unzip_file_done(struct unzip *z)
 	const struct file *f = ffslice_itemT(&z->files, z->ifile, struct file);
 	z->total_comp += f->zsize;
 
-	core->file->mtime_set(z->out, f->mtime);
+	if (f_isdir(f)) {
+		unmeta_dir_mtime(&z->meta, z->oname, f->mtime);
 
-	if (!f_isdir(f)) {
+	} else {
 		uint attr = f->attr_unix;
 #ifdef FF_WIN
 		attr = f->attr_win;
 #endif
-		if (attr != 0)
-			core->file->attr_set(z->out, attr);
-
-		core->file->close(z->out);
+		unmeta_file_close(&z->meta, z->out, z->oname, f->mtime, attr);
 		z->del_on_close = 0;
 		fcom_verblog("unzip: %s", z->oname);
 	}
@@ -560,12 +609,12 @@ static int unzip_out_open(struct unzip *z)
 	int r;
 	const struct file *f = ffslice_itemT(&z->files, z->ifile, struct file);
 
-	if (f_isdir(f)) {
-		r = core->file->dir_create(z->oname, FCOM_FILE_DIR_RECURSIVE);
-		if (r == FCOM_FILE_ERR)
-			return -1;
-		return 0;
-	}
+	if (f_isdir(f))
+		return unmeta_dir_create(&z->meta, FFSTR_Z(z->oname));
+
+	if (!z->cmd->stdout
+		&& unmeta_parent_create(&z->meta, z->oname))
+		return -1;
 
 	uint flags = FCOM_FILE_WRITE;
 	flags |= fcom_file_cominfo_flags_o(z->cmd);
@@ -598,6 +647,15 @@ static void unzip_run(fcom_op *op)
 			case 'erro': goto end;
 			}
 			z->state = I_PARSE;
+
+			if (z->cdir_cache.len != 0 && !z->recovery) {
+				if (0 == unzip_cache_load(z)) {
+					unzip_cache_files(z);
+					z->state = I_FILE_NEXT;
+				} else {
+					z->cache_save = 1;
+				}
+			}
 			continue;
 
 		case I_READ:
@@ -677,6 +735,8 @@ static void unzip_run(fcom_op *op)
 	}
 
 end:
+	if (unmeta_finish(&z->meta, z, unzip_close, z->cmd, rc))
+		return;
 	{
 	fcom_cominfo *cmd = z->cmd;
 	unzip_close(z);
@@ -110,7 +110,10 @@ static int zst_read(struct unzst *z, ffstr *input, ffstr *output)
 	zstd_buf in, out;
 	zstd_buf_set(&in, input->ptr, input->len);
 	zstd_buf_set(&out, z->buf.ptr, z->buf.cap);
+	fftime t;
+	fcom_stat_begin(&t);
 	int r = zstd_decode(z->zst, &in, &out);
+	fcom_stat_end(FCOM_STAT_CODEC, &t, in.pos);
 	ffstr_shift(input, in.pos);
 	ffstr_set(output, z->buf.ptr, out.pos);
 	z->in_total += in.pos;
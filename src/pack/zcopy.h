@@ -0,0 +1,64 @@
+/** fcom: pack: write the contents of container files via fcom_file.copy()
+2026, Simon Zolin */
+
+/*
+.tar and .iso store file data as is,
+ so the chunks produced by the writer/reader point to the data returned by read().
+Such chunk is copied from the input file to the output by the kernel;
+ headers and padding are written from user space as usual.
+The input file is opened with FCOM_FILE_MMAP,
+ so its data isn't even touched by the CPU.
+The saved range is valid only until the input file is re-opened or read again
+ (the same address may be reused by another view):
+ the user calls zcopy_reset() before each open() and read() of the input file.
+The input file's descriptor is stored along with the range.
+*/
+
+struct zcopy {
+	ffstr rd; // the data returned by the last read()
+	uint64 rd_off; // its offset in the input file
+	fffd rd_fd; // the input file
+	uint off :1; // not supported for these files
+};
+
+/** Forget the data returned by read() */
+static inline void zcopy_reset(struct zcopy *z)
+{
+	ffstr_null(&z->rd);
+	z->rd_fd = FFFILE_NULL;
+}
+
+/** Remember the data returned by read() */
+static inline void zcopy_read(struct zcopy *z, fcom_file_obj *in, ffstr d, uint64 off)
+{
+	z->rd = d;
+	z->rd_off = off;
+	z->rd_fd = core->file->fd(in, 0);
+}
+
+/** Copy the output data chunk from the input file (if it's a part of the input data).
+Shift `d` by the number of bytes copied.
+off: output offset;  -1: current
+Return N of bytes copied;  <0: error */
+static inline ffssize zcopy_write(struct zcopy *z, fcom_file_obj *out, fcom_file_obj *in, ffstr *d, int64 off)
+{
+	if (z->off
+		|| d->len == 0
+		|| z->rd.len == 0
+		|| !(d->ptr >= z->rd.ptr && d->ptr + d->len <= z->rd.ptr + z->rd.len)
+		|| z->rd_fd == FFFILE_NULL
+		|| z->rd_fd != core->file->fd(in, 0))
+		return 0;
+
+	uint64 src_off = z->rd_off + (d->ptr - z->rd.ptr);
+	ffssize r = core->file->copy(out, in, src_off, d->len, off);
+	if (r < 0)
+		return -1;
+	if (r == 0) {
+		fcom_dbglog("zero-copy isn't supported");
+		z->off = 1;
+		return 0;
+	}
+	ffstr_shift(d, r);
+	return r;
+}
@@ -187,7 +187,10 @@ static void zst_run(fcom_op *op)
 			zstd_buf in, out;
 			zstd_buf_set(&in, z->data.ptr, z->data.len);
 			zstd_buf_set(&out, z->buf.ptr, z->buf.cap);
+			fftime t;
+			fcom_stat_begin(&t);
 			r = zstd_encode(z->zst, &in, &out, z->zst_flags);
+			fcom_stat_end(FCOM_STAT_CODEC, &t, in.pos);
 			ffstr_shift(&z->data, in.pos);
 			ffstr_set(&z->zdata, z->buf.ptr, out.pos);
 			z->in_total += in.pos;
@@ -62,6 +62,32 @@ static int pic_jpg_read(struct pic *p, ffstr *input, ffstr *output)
 	return 0;
 }
 
+/** Use DCT scaling to decode the image with the smallest size not less than the target size */
+static int pic_jpg_scale(struct pic *p, uint width, uint height)
+{
+	uint w = p->in_info.width, h = p->in_info.height, num;
+	for (num = 1;  num < 8;  num++) {
+		if ((w * num + 7) / 8 >= width
+			&& (h * num + 7) / 8 >= height)
+			break;
+	}
+	if (num == 8)
+		return 0;
+
+	struct jpeg_conf conf = {};
+	if (0 != jpeg_scale(p->jpegr, num, 8, &conf)) {
+		fcom_errlog("jpeg_scale: %s", jpeg_errstr(p->jpegr));
+		return -1;
+	}
+	fcom_dbglog("jpeg: DCT scaling %u/8: %u/%u", num, conf.width, conf.height);
+
+	p->in_line_size = conf.width * 24 / 8;
+	ffvec_realloc(&p->jpg_buf, p->in_line_size, 1);
+	p->in_info.width = conf.width;
+	p->in_info.height = conf.height;
+	return 0;
+}
+
 static int pic_jpg_write(struct pic *p, ffstr *input, ffstr *output)
 {
 	if (p->jpegw == NULL) {
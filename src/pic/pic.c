@@ -13,10 +13,19 @@ OUTPUT\n\
       If only an extension is given, use source file name automatically.\n\
 \n\
 OPTIONS:\n\
+        `--resize` WxH\n\
+                        Resize image to WIDTHxHEIGHT.\n\
+                        Use `W` or `xH` to preserve aspect ratio.\n\
+        `--max-side` INT\n\
+                        Downscale image so that its largest side is not larger than INT\n\
+        `--resize-filter` STR\n\
+                        Resampling filter: `box`, `bilinear` (default), `lanczos`\n\
     `-q`, `--jpeg-quality` INT\n\
                         Set JPEG quality: 1..100 (default: 85)\n\
         `--png-compression` INT\n\
                         Set PNG compression level: 0..9 (default: 9)\n\
+    `-j`, `--jobs` INT\n\
+                        Convert N files in parallel (0: use all worker threads; default: 1)\n\
     `-k`, `--skip-errors`\n\
                         Skip errors\n\
           `--delete-source`\n\
@@ -26,6 +35,7 @@ OPTIONS:\n\
 
 #include <fcom.h>
 #include <util/pixel-conv.h>
+#include <util/pic-resize.h>
 #include <avpack/bmp-read.h>
 #include <avpack/bmp-write.h>
 #include <../3pt-pic/jpeg-turbo/jpeg-ff.h>
@@ -34,8 +44,10 @@ OPTIONS:\n\
 
 static const fcom_core *core;
 static void pic_run(fcom_op *op);
+static void pic_close(fcom_op *op);
 
 struct pic;
+static void pic_par_free(struct pic *p);
 typedef int (*pic_io)(struct pic *p, ffstr *input, ffstr *output);
 
 struct pic {
@@ -69,18 +81,35 @@ struct pic {
 	struct png_writer *pngw;
 	ffvec png_buf;
 
+	struct pic_resize rs;
+	ffstr rdata;
+
+	// --jobs
+	struct pic_worker *workers;
+	struct pic_result *results;
+	uint64 iseq, oseq;
+	uint nbusy;
+	uint input_done :1;
+	uint failed :1;
+	uint trashing :1;
+
 	uint stop;
 	uint out_opened :1;
 	uint r_done :1;
 	uint writer_opened :1;
 	uint reader_opened :1;
 	uint conv :1;
+	uint resize :1;
 
 	struct {
 		u_char skip_errors;
 		u_char delete_source;
 		uint jpeg_quality;
 		uint png_comp;
+		uint width, height;
+		uint max_side;
+		uint resize_filter; // enum PIC_RESIZE_FILTER
+		uint jobs;
 	} conf;
 };
 
@@ -120,16 +149,59 @@ static inline ffstr ffstr_sub(ffstr s, ffsize from, ffssize len)
 
 #define O(member)  (void*)FF_OFF(struct pic, member)
 
+/** "W" | "WxH" | "xH" */
+static int args_resize(void *obj, ffstr s)
+{
+	struct pic *p = obj;
+	ffstr w, h;
+	ffstr_splitby(&s, 'x', &w, &h);
+	if ((w.len && !ffstr_to_uint32(&w, &p->conf.width))
+		|| (h.len && !ffstr_to_uint32(&h, &p->conf.height))
+		|| (p->conf.width == 0 && p->conf.height == 0)) {
+		fcom_fatlog("--resize: bad value: '%S'", &s);
+		return 1;
+	}
+	return 0;
+}
+
+static int args_resize_filter(void *obj, ffstr s)
+{
+	struct pic *p = obj;
+	static const char filters[][9] = {
+		"bilinear",
+		"box",
+		"lanczos",
+	};
+	static const u_char filter_ids[] = {
+		PIC_RESIZE_BILINEAR,
+		PIC_RESIZE_BOX,
+		PIC_RESIZE_LANCZOS,
+	};
+	int r = ffcharr_findsorted(filters, FF_COUNT(filters), sizeof(filters[0]), s.ptr, s.len);
+	if (r < 0) {
+		fcom_fatlog("--resize-filter: unknown filter '%S'", &s);
+		return 1;
+	}
+	p->conf.resize_filter = filter_ids[r];
+	return 0;
+}
+
 static int args_parse(struct pic *p, fcom_cominfo *cmd)
 {
 	p->conf.jpeg_quality = 85;
 	p->conf.png_comp = 9;
+	p->conf.jobs = 1;
 
 	static const struct ffarg args[] = {
 		{ "--delete-source",	'1',	O(conf.delete_source) },
+		{ "--jobs",				'u',	O(conf.jobs) },
 		{ "--jpeg-quality",		'u',	O(conf.jpeg_quality) },
+		{ "--max-side",			'u',	O(conf.max_side) },
 		{ "--png-compression",	'u',	O(conf.png_comp) },
+		{ "--resize",			'S',	args_resize },
+		{ "--resize-filter",	'S',	args_resize_filter },
 		{ "--skip-errors",		'1',	O(conf.skip_errors) },
+		{ "-j",					'u',	O(conf.jobs) },
 		{ "-k",					'1',	O(conf.skip_errors) },
 		{ "-q",					'u',	O(conf.jpeg_quality) },
 		{}
@@ -162,6 +234,11 @@ static int args_parse(struct pic *p, fcom_cominfo *cmd)
 	}
 	p->write = get_format_w(oext);
 
+	if (p->conf.jobs == 0)
+		p->conf.jobs = core->workers;
+	if (cmd->stdin || cmd->stdout)
+		p->conf.jobs = 1;
+
 	return 0;
 }
 
@@ -172,6 +249,8 @@ static void pic_reset(struct pic *p)
 	bmp_free(p);
 	pic_jpeg_free(p);
 	png_free(p);
+	pic_resize_free(&p->rs);
+	p->resize = 0;
 	p->writer_opened = 0;
 	p->reader_opened = 0;
 	p->conv = 0;
@@ -179,10 +258,8 @@ static void pic_reset(struct pic *p)
 	ffmem_zero_obj(&p->in_info);
 	ffmem_zero_obj(&p->out_info);
 
-	if (p->out != NULL) {
+	if (p->out != NULL)
 		core->file->close(p->out);
-		fcom_verblog("%s", p->oname);
-	}
 	p->out_opened = 0;
 	p->in_off = 0;
 	p->out_off = 0;
@@ -191,6 +268,7 @@ static void pic_reset(struct pic *p)
 static void pic_close(fcom_op *op)
 {
 	struct pic *p = op;
+	pic_par_free(p);
 	pic_reset(p);
 	core->file->destroy(p->in);
 	core->file->destroy(p->out);
@@ -202,14 +280,12 @@ static void pic_close(fcom_op *op)
 	ffmem_free(p);
 }
 
-static fcom_op* pic_create(fcom_cominfo *cmd)
+/** Create conversion context */
+static struct pic* pic_ctx_create(fcom_cominfo *cmd)
 {
 	struct pic *p = ffmem_new(struct pic);
 	p->cmd = cmd;
 
-	if (0 != args_parse(p, cmd))
-		goto end;
-
 	struct fcom_file_conf fc = {};
 	fc.buffer_size = cmd->buffer_size;
 	p->in = core->file->create(&fc);
@@ -218,6 +294,20 @@ static fcom_op* pic_create(fcom_cominfo *cmd)
 	ffsize cap = (cmd->buffer_size != 0) ? cmd->buffer_size : 64*1024;
 	ffvec_alloc(&p->buf, cap, 1);
 	return p;
+}
+
+static void pic_par_init(struct pic *p);
+
+static fcom_op* pic_create(fcom_cominfo *cmd)
+{
+	struct pic *p = pic_ctx_create(cmd);
+
+	if (0 != args_parse(p, cmd))
+		goto end;
+
+	if (p->conf.jobs > 1)
+		pic_par_init(p);
+	return p;
 
 end:
 	pic_close(p);
@@ -239,6 +329,66 @@ static int pic_conv(struct pic *p, ffstr *input, ffstr *output)
 	return 0;
 }
 
+/** Get the target image size */
+static void pic_resize_dims(struct pic *p, uint *width, uint *height)
+{
+	uint w = p->in_info.width, h = p->in_info.height;
+
+	if (p->conf.width && p->conf.height) {
+		w = p->conf.width;
+		h = p->conf.height;
+	} else if (p->conf.width) {
+		h = ffmax((uint64)h * p->conf.width / w, 1);
+		w = p->conf.width;
+	} else if (p->conf.height) {
+		w = ffmax((uint64)w * p->conf.height / h, 1);
+		h = p->conf.height;
+	}
+
+	uint m = p->conf.max_side;
+	if (m && (w > m || h > m)) {
+		if (w >= h) {
+			h = ffmax((uint64)h * m / w, 1);
+			w = m;
+		} else {
+			w = ffmax((uint64)w * m / h, 1);
+			h = m;
+		}
+	}
+
+	*width = w;
+	*height = h;
+}
+
+/** Prepare resampler after the input header is read */
+static int pic_resize_prepare(struct pic *p)
+{
+	uint w, h;
+	pic_resize_dims(p, &w, &h);
+	p->out_info.width = w;
+	p->out_info.height = h;
+	if (w == p->in_info.width && h == p->in_info.height)
+		return 0;
+
+	// Let JPEG decoder perform the most part of downscaling
+	if (p->jpegr != NULL
+		&& 0 != pic_jpg_scale(p, w, h))
+		return -1;
+
+	fcom_dbglog("resize: %u/%u -> %u/%u"
+		, p->in_info.width, p->in_info.height, w, h);
+	if (w == p->in_info.width && h == p->in_info.height)
+		return 0;
+
+	if (0 != pic_resize_init(&p->rs, p->in_info.width, p->in_info.height, w, h
+		, (p->in_info.format & 0xff) / 8, p->conf.resize_filter)) {
+		fcom_errlog("pic_resize_init");
+		return -1;
+	}
+	p->resize = 1;
+	return 0;
+}
+
 /** Prepare output file name */
 static char* pic_oname(struct pic *p, ffstr in, ffstr base)
 {
@@ -307,53 +457,46 @@ static int pic_next(struct pic *p)
 static void pic_trash_complete(void *param, int result)
 {
 	struct pic *p = (struct pic*)param;
+	p->trashing = 0;
 	pic_run(p);
 }
 
-static void pic_trash_src(struct pic *p)
+static void pic_trash_src(struct pic *p, const char *name)
 {
 	fcom_cominfo *ci = core->com->create();
 	ci->operation = ffsz_dup("trash");
 	ci->overwrite = 1; // if trash doesn't work: delete
 
 	ffstr *ps = ffvec_pushT(&ci->input, ffstr);
-	char *sz = ffsz_dup(p->name.ptr);
+	char *sz = ffsz_dup(name);
 	ffstr_setz(ps, sz);
 
 	ci->test = p->cmd->test;
 
 	ci->on_complete = pic_trash_complete;
 	ci->opaque = p;
-	fcom_dbglog("pic: trash: %s", p->name.ptr);
+	fcom_dbglog("pic: trash: %s", name);
+	p->trashing = 1;
 	core->com->run(ci);
 }
 
-static void pic_run(fcom_op *op)
+/** Convert the opened input file.
+Return 'done' on success;
+ 'skip': skip this file after error;
+ 'erro': fatal error */
+static int pic_file(struct pic *p)
 {
-	struct pic *p = op;
-	int r, rc = 1;
-	enum { I_IN, I_READ, I_INPUT, I_CONV, I_OUTPUT, I_OUT_OPEN, I_WRITE, };
+	int r;
+	enum { I_READ, I_INPUT, I_RESIZE, I_CONV, I_OUTPUT, I_OUT_OPEN, I_WRITE, };
+	p->st = I_INPUT;
 
 	while (!FFINT_READONCE(p->stop)) {
 		switch (p->st) {
 
-		case I_IN:
-			switch (pic_next(p)) {
-			case 'done':
-				rc = 0; goto end;
-			case 'erro':
-				goto end;
-			case 'skip':
-				continue;
-			}
-
-			p->st = I_INPUT;
-			continue;
-
 		case I_READ:
 			r = core->file->read(p->in, &p->idata, p->in_off);
-			if (r == FCOM_FILE_ERR) goto end;
-			if (r == FCOM_FILE_EOF) goto end;
+			if (r == FCOM_FILE_ERR) return 'erro';
+			if (r == FCOM_FILE_EOF) return 'erro';
 			p->in_off += p->idata.len;
 
 			p->st = I_INPUT;
@@ -363,8 +506,13 @@ static void pic_run(fcom_op *op)
 			r = p->read(p, &p->idata, &p->tdata);
 			switch (r) {
 			case 'head': {
-				p->out_info.width = p->in_info.width;
-				p->out_info.height = p->in_info.height;
+				if (0 != pic_resize_prepare(p)) {
+					if (p->conf.skip_errors) {
+						pic_reset(p);
+						return 'skip';
+					}
+					return 'erro';
+				}
 				continue;
 			}
 
@@ -375,12 +523,35 @@ static void pic_run(fcom_op *op)
 			case 'erro':
 				if (p->conf.skip_errors) {
 					pic_reset(p);
-					p->st = I_IN;
-					continue;
+					return 'skip';
 				}
-				goto end;
+				return 'erro';
+			}
+
+			p->st = I_OUTPUT;
+			if (p->resize)
+				p->st = I_RESIZE;
+			else if (p->conv)
+				p->st = I_CONV;
+			continue;
+
+		case I_RESIZE:
+			if (p->r_done) {
+				fcom_errlog("resize: incomplete image data");
+				return 'erro';
+			}
+			r = pic_resize_process(&p->rs, &p->tdata, &p->rdata);
+			switch (r) {
+			case 'more':
+				p->st = I_INPUT;
+				continue;
+
+			case 'done':
+				fcom_errlog("resize: unexpected end of image");
+				return 'erro';
 			}
 
+			p->tdata = p->rdata;
 			p->st = I_OUTPUT;
 			if (p->conv)
 				p->st = I_CONV;
@@ -388,7 +559,7 @@ static void pic_run(fcom_op *op)
 
 		case I_CONV:
 			r = pic_conv(p, &p->tdata, &p->tdata);
-			if (r != 0) goto end;
+			if (r != 0) return 'erro';
 			p->st = I_OUTPUT;
 			continue;
 
@@ -404,18 +575,17 @@ static void pic_run(fcom_op *op)
 
 			case 'more':
 				p->st = I_INPUT;
+				if (p->resize) {
+					ffstr_null(&p->tdata);
+					p->st = I_RESIZE;
+				}
 				continue;
 
 			case 'done':
 				pic_reset(p);
-				p->st = I_IN;
-				if (p->conf.delete_source) {
-					pic_trash_src(p);
-					return;
-				}
-				continue;
+				return 'done';
 
-			case 'erro': goto end;
+			case 'erro': return 'erro';
 			}
 
 			p->st = I_WRITE;
@@ -434,10 +604,9 @@ static void pic_run(fcom_op *op)
 			if (r == FCOM_FILE_ERR) {
 				if (p->conf.skip_errors) {
 					pic_reset(p);
-					p->st = I_IN;
-					continue;
+					return 'skip';
 				}
-				goto end;
+				return 'erro';
 			}
 			p->st = I_WRITE;
 		}
@@ -445,7 +614,7 @@ static void pic_run(fcom_op *op)
 
 		case I_WRITE:
 			r = core->file->write(p->out, p->odata, p->out_off);
-			if (r == FCOM_FILE_ERR) goto end;
+			if (r == FCOM_FILE_ERR) return 'erro';
 			p->out_off += p->odata.len;
 
 			p->st = I_OUTPUT;
@@ -453,6 +622,235 @@ static void pic_run(fcom_op *op)
 		}
 	}
 
+	return 'erro';
+}
+
+/*
+--jobs N:
+The main thread gets the next input file, opens it and passes it to a free worker.
+Each worker has its own conversion context (readers, writers, buffers) and converts 1 file as a core job.
+When the job is complete, the main thread reports the results in input order.
+*/
+
+#define PIC_RESULTS_PER_JOB  16
+
+struct pic_result {
+	char *name, *oname;
+	ffstr base;
+	uint r; // 'done', 'skip', 'erro'
+	uint ready;
+};
+
+struct pic_worker {
+	struct pic *parent;
+	struct pic *p; // conversion context
+	struct pic_result *res; // !=NULL: busy
+	fcom_job job;
+};
+
+static void pic_par_init(struct pic *p)
+{
+	p->workers = ffmem_calloc(p->conf.jobs, sizeof(struct pic_worker));
+	p->results = ffmem_calloc(p->conf.jobs * PIC_RESULTS_PER_JOB, sizeof(struct pic_result));
+	fcom_dbglog("pic: using %u workers", p->conf.jobs);
+}
+
+static void pic_par_free(struct pic *p)
+{
+	if (p->workers == NULL)
+		return;
+
+	for (uint i = 0;  i != p->conf.jobs;  i++) {
+		struct pic_worker *w = &p->workers[i];
+		if (w->p != NULL)
+			pic_close(w->p);
+	}
+	ffmem_free(p->workers);
+
+	const uint nres = p->conf.jobs * PIC_RESULTS_PER_JOB;
+	for (;  p->oseq != p->iseq;  p->oseq++) {
+		struct pic_result *res = &p->results[p->oseq % nres];
+		ffmem_free(res->name);
+		ffmem_free(res->oname);
+		ffstr_free(&res->base);
+	}
+	ffmem_free(p->results);
+}
+
+/** Signal all workers to stop */
+static void pic_par_stop(struct pic *p)
+{
+	for (uint i = 0;  i != p->conf.jobs;  i++) {
+		struct pic_worker *w = &p->workers[i];
+		if (w->p != NULL)
+			FFINT_WRITEONCE(w->p->stop, 1);
+	}
+}
+
+/** Main thread: worker has finished */
+static void pic_worker_done(void *param)
+{
+	struct pic_worker *w = param;
+	struct pic *p = w->parent;
+	if (w->job.cancelled)
+		w->res->r = 'erro';
+	w->res->ready = 1;
+	w->res = NULL;
+	p->nbusy--;
+	pic_run(p);
+}
+
+/** Worker thread: convert 1 file */
+static void pic_worker_proc(void *param)
+{
+	struct pic_worker *w = param;
+	w->res->r = pic_file(w->p);
+	w->res->oname = w->p->oname;
+	w->p->oname = NULL;
+}
+
+/** Pass the opened input file to a free worker */
+static void pic_par_start(struct pic *p)
+{
+	struct pic_worker *w = NULL;
+	for (uint i = 0;  i != p->conf.jobs;  i++) {
+		if (p->workers[i].res == NULL) {
+			w = &p->workers[i];
+			break;
+		}
+	}
+	FCOM_ASSERT(w != NULL);
+
+	if (w->p == NULL) {
+		w->parent = p;
+		w->p = pic_ctx_create(p->cmd);
+		w->p->conf = p->conf;
+		w->p->write = p->write;
+		w->p->autoname_ext = p->autoname_ext;
+	}
+	struct pic *c = w->p;
+
+	const uint nres = p->conf.jobs * PIC_RESULTS_PER_JOB;
+	struct pic_result *res = &p->results[p->iseq % nres];
+	ffmem_zero_obj(res);
+	res->name = ffsz_dupn(p->name.ptr, p->name.len);
+	ffstr_dupstr(&res->base, &p->basepath);
+	p->iseq++;
+
+	fcom_file_obj *f = c->in;
+	c->in = p->in;
+	p->in = f;
+	c->ifi = p->ifi;
+	c->read = p->read;
+	ffstr_setz(&c->name, res->name);
+	c->basepath = res->base;
+
+	w->res = res;
+	p->nbusy++;
+	fcom_job_set(&w->job, pic_worker_proc, pic_worker_done, w, p);
+	core->job(&w->job);
+}
+
+static void pic_par_run(struct pic *p)
+{
+	const uint nres = p->conf.jobs * PIC_RESULTS_PER_JOB;
+
+	for (;;) {
+		if (p->trashing)
+			return;
+
+		if (p->oseq != p->iseq
+			&& p->results[p->oseq % nres].ready) {
+			struct pic_result *res = &p->results[p->oseq % nres];
+			p->oseq++;
+
+			switch (res->r) {
+			case 'done':
+				fcom_verblog("%s", res->oname);
+				if (p->conf.delete_source && !p->failed)
+					pic_trash_src(p, res->name);
+				break;
+
+			case 'erro':
+				p->failed = 1;
+				pic_par_stop(p);
+				break;
+			}
+
+			ffmem_free(res->name);
+			ffmem_free(res->oname);
+			ffstr_free(&res->base);
+			continue;
+		}
+
+		if (!p->input_done && !p->failed && !FFINT_READONCE(p->stop)
+			&& p->nbusy != p->conf.jobs
+			&& p->iseq - p->oseq != nres) {
+
+			switch (pic_next(p)) {
+			case 'done':
+				p->input_done = 1;
+				continue;
+
+			case 'erro':
+				p->failed = 1;
+				pic_par_stop(p);
+				continue;
+
+			case 'skip':
+				continue;
+			}
+
+			pic_par_start(p);
+			continue;
+		}
+
+		if (p->nbusy == 0 && p->oseq == p->iseq
+			&& (p->input_done || p->failed || FFINT_READONCE(p->stop)))
+			break;
+		return; // wait for workers
+	}
+
+	int rc = (p->failed || FFINT_READONCE(p->stop));
+	fcom_cominfo *cmd = p->cmd;
+	pic_close(p);
+	core->com->complete(cmd, rc);
+}
+
+static void pic_run(fcom_op *op)
+{
+	struct pic *p = op;
+	int rc = 1;
+
+	if (p->workers != NULL) {
+		pic_par_run(p);
+		return;
+	}
+
+	while (!FFINT_READONCE(p->stop)) {
+		switch (pic_next(p)) {
+		case 'done':
+			rc = 0; goto end;
+		case 'erro':
+			goto end;
+		case 'skip':
+			continue;
+		}
+
+		switch (pic_file(p)) {
+		case 'done':
+			fcom_verblog("%s", p->oname);
+			if (p->conf.delete_source) {
+				pic_trash_src(p, p->name.ptr);
+				return;
+			}
+			break;
+
+		case 'erro':
+			goto end;
+		}
+	}
+
 end:
 	{
 	fcom_cominfo *cmd = p->cmd;
@@ -465,6 +863,8 @@ static void pic_signal(fcom_op *op, uint signal)
 {
 	struct pic *p = op;
 	FFINT_WRITEONCE(p->stop, 1);
+	if (p->workers != NULL)
+		pic_par_stop(p);
 }
 
 static const fcom_operation fcom_op_pic = {
@@ -0,0 +1,84 @@
+/** fcom: pixel conversion: compare SIMD kernels with the portable implementation
+2026, Simon Zolin */
+
+#include <util/pixel-conv.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static const ffuint fmts[] = {
+	PIC_RGB, PIC_BGR, PIC_RGBA, PIC_BGRA, PIC_ABGR,
+};
+
+static const char* fmt_name(ffuint f)
+{
+	switch (f) {
+	case PIC_RGB: return "RGB";
+	case PIC_BGR: return "BGR";
+	case PIC_RGBA: return "RGBA";
+	case PIC_BGRA: return "BGRA";
+	case PIC_ABGR: return "ABGR";
+	}
+	return "?";
+}
+
+static const char* simd_name(ffuint simd)
+{
+	static const char names[][8] = { "none", "SSSE3", "AVX2", "NEON" };
+	return names[simd];
+}
+
+/** Convert lines of different width with both implementations and compare the results */
+static int test_conv(ffuint simd, ffuint in_fmt, ffuint out_fmt, const ffbyte *src, ffbyte *d1, ffbyte *d2)
+{
+	for (ffuint w = 0;  w <= 67;  w++) {
+		ffuint osize = w * (out_fmt & 0xff) / 8;
+		memset(d1, 0xcc, osize + 32);
+		memset(d2, 0xcc, osize + 32);
+
+		int r1 = pic_convert_c(in_fmt, src, out_fmt, d1, w);
+		int r2 = pic_convert_simd(simd, in_fmt, src, out_fmt, d2, w);
+		if (r1 != r2 || memcmp(d1, d2, osize + 32)) {
+			printf("FAIL: %s: %s -> %s: %u pixels\n"
+				, simd_name(simd), fmt_name(in_fmt), fmt_name(out_fmt), w);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int main()
+{
+	ffbyte *src = malloc(4 * 1024), *d1 = malloc(4 * 1024), *d2 = malloc(4 * 1024);
+	int rc = 0;
+	ffuint n = 0;
+
+	srand(1);
+	for (ffuint i = 0;  i != 4 * 1024;  i++) {
+		src[i] = rand();
+	}
+
+	ffuint best = pic_simd_detect();
+	for (ffuint simd = PIC_SIMD_SSSE3;  simd <= PIC_SIMD_NEON;  simd++) {
+		if (best == PIC_SIMD_NONE
+			|| (best == PIC_SIMD_NEON) != (simd == PIC_SIMD_NEON)
+			|| simd > best)
+			continue;
+
+		for (ffuint i = 0;  i != FF_COUNT(fmts);  i++) {
+			for (ffuint j = 0;  j != FF_COUNT(fmts);  j++) {
+				if (i == j)
+					continue;
+				rc |= test_conv(simd, fmts[i], fmts[j], src, d1, d2);
+				n++;
+			}
+		}
+		printf("%s: checked %u conversions\n", simd_name(simd), n);
+		n = 0;
+	}
+
+	free(src);
+	free(d1);
+	free(d2);
+	return rc;
+}
@@ -8,7 +8,9 @@ Parse HTML data\n\
 Usage:\n\
   `fcom html` INPUT... --filter TAG.ATTR [-o OUTPUT]\n\
 OPTIONS\n\
-  `--filter` TAG.ATTR    Print all values of an HTML tag's attribute\n\
+  `--filter` TAG.ATTR    Print all values of an HTML tag's attribute.\n\
+                          May be specified multiple times:\n\
+                          all filters are applied in a single pass.\n\
 ";
 }
 
@@ -18,10 +20,13 @@ OPTIONS\n\
 
 static const fcom_core *core;
 
-struct h_conf {
+struct h_filter {
 	ffstr tag, attr;
 };
 
+#define H_FILTERS_MAX  64
+#define H_CARRY_MAX  (64*1024) // max. size of an incomplete token kept between the chunks
+
 struct html {
 	fcom_cominfo cominfo;
 
@@ -30,42 +35,61 @@ struct html {
 	fcom_cominfo *cmd;
 
 	ffstr iname;
-	ffvec fdata;
-	ffstr idata;
+	fcom_file_obj *in;
+	ffstr data;
+	ffvec ibuf; // unprocessed data from the previous chunk
 
 	htmlread html;
+	uint64 tag_filters, attr_filters; // bit-mask of matching filters
 	ffvec buf;
 	fcom_file_obj *out;
 
-	struct h_conf conf;
+	ffvec filters; // struct h_filter[]
 };
 
-#define O(member)  (void*)FF_OFF(struct html, member)
+static int args_filter(void *obj, ffstr s)
+{
+	struct html *h = obj;
+	if (h->filters.len == H_FILTERS_MAX) {
+		fcom_fatlog("--filter: too many filters (max: %u)", H_FILTERS_MAX);
+		return 1;
+	}
+
+	struct h_filter *f = ffvec_zpushT(&h->filters, struct h_filter);
+	ffstr tag, attr;
+	ffstr_splitby(&s, '.', &tag, &attr);
+	ffstr_dupstr(&f->tag, &tag);
+	ffstr_dupstr(&f->attr, &attr);
+	return 0;
+}
 
 static int args_parse(struct html *h, fcom_cominfo *cmd)
 {
 	static const struct ffarg args[] = {
-		{ "--filter",		'S',	O(conf.tag) },
+		{ "--filter",		'+S',	args_filter },
 		{}
 	};
 	if (core->com->args_parse(cmd, args, h, FCOM_COM_AP_INOUT))
 		return -1;
 
-	ffstr_splitby(&h->conf.tag, '.', &h->conf.tag, &h->conf.attr);
-
 	if (!h->cmd->output.len)
 		h->cmd->stdout = 1;
 
 	return 0;
 }
 
-#undef O
-
 static void html_close(fcom_op *op)
 {
 	struct html *h = op;
+	struct h_filter *f;
+	FFSLICE_WALK(&h->filters, f) {
+		ffstr_free(&f->tag);
+		ffstr_free(&f->attr);
+	}
+	ffvec_free(&h->filters);
+	core->file->destroy(h->in);
 	core->file->destroy(h->out);
-	ffvec_free(&h->fdata);
+	ffvec_free(&h->ibuf);
 	ffvec_free(&h->buf);
 	ffmem_free(h);
 }
@@ -79,7 +103,8 @@ static fcom_op* html_create(fcom_cominfo *cmd)
 		goto end;
 
 	struct fcom_file_conf fc = {};
-	fc.buffer_size = cmd->buffer_size;
+	fcom_cmd_file_conf(&fc, cmd);
+	h->in = core->file->create(&fc);
 	h->out = core->file->create(&fc);
 
 	return h;
@@ -89,55 +114,76 @@ end:
 	return NULL;
 }
 
-static int html_find_tagattr(struct h_conf *conf, ffstr *in, ffstr *out, htmlread *html)
+/** Get bit-mask of the filters that match the tag or attribute name */
+static uint64 html_filters_match(struct html *h, ffstr name, uint64 mask, uint attr)
+{
+	uint64 m = 0;
+	const struct h_filter *f = h->filters.ptr;
+	for (uint i = 0;  i != h->filters.len;  i++) {
+		if (!(mask & (1ULL << i)))
+			continue;
+		const ffstr *s = (attr) ? &f[i].attr : &f[i].tag;
+		if (ffstr_ieq2(&name, s))
+			m |= 1ULL << i;
+	}
+	return m;
+}
+
+/** Parse HTML data and store the values of the matching attributes.
+Return the number of unprocessed bytes */
+static ffsize html_process(struct html *h, ffstr in)
 {
-	uint state = 0;
+	ffstr out;
 	for (;;) {
-		int r = htmlread_process(html, in, out);
+		int r = htmlread_process(&h->html, &in, &out);
 
-		fcom_dbglog("htmlread_process: %d %S", r, out);
+		fcom_dbglog("htmlread_process: %d %S", r, &out);
 
 		switch (r) {
 		case HTML_TAG:
-			state = 0;
-			if (ffstr_ieq2(out, &conf->tag))
-				state = 1;
+			h->tag_filters = html_filters_match(h, out, ~0ULL, 0);
+			h->attr_filters = 0;
 			break;
 
 		case HTML_TAG_CLOSE:
 		case HTML_TAG_CLOSE_SELF:
+			h->tag_filters = 0;
+			h->attr_filters = 0;
+			break;
+
 		case HTML_TEXT:
 			break;
 
 		case HTML_ATTR:
-			if (state == 2)
-				state = 1;
-			if (state == 1 && ffstr_ieq2(out, &conf->attr))
-				state = 2;
+			h->attr_filters = 0;
+			if (h->tag_filters)
+				h->attr_filters = html_filters_match(h, out, h->tag_filters, 1);
 			break;
 
 		case HTML_ATTR_VAL:
-			if (state == 2)
-				return 0;
+			if (h->attr_filters) {
+				ffvec_addstr(&h->buf, &out);
+				ffvec_addchar(&h->buf, '\n');
+			}
+			h->attr_filters = 0;
 			break;
 
 		default:
-			return 1;
+			return in.len;
 		}
 	}
-	return 1;
 }
 
 static void html_run(fcom_op *op)
 {
 	struct html *h = op;
 	int r, rc = 1;
-	enum { I_IN, I_READ, I_PROC, I_OUT_OPEN, I_WRITE };
+	enum { I_IN, I_READ, I_PROC, I_WRITE };
 
 	while (!FFINT_READONCE(h->stop)) {
 		switch (h->st) {
 
-		case I_IN:
+		case I_IN: {
 			if (0 > (r = core->com->input_next(h->cmd, &h->iname, NULL, 0))) {
 				if (r == FCOM_COM_RINPUT_NOMORE)
 					rc = 0;
@@ -147,44 +193,79 @@ static void html_run(fcom_op *op)
 			if (!!core->com->input_allowed(h->cmd, h->iname, FCOM_COM_IA_AUTO))
 				continue;
 
+			uint iflags = fcom_file_cominfo_flags_i(h->cmd);
+			r = core->file->open(h->in, h->iname.ptr, iflags);
+			if (r == FCOM_FILE_ERR) goto end;
+			core->file->behaviour(h->in, FCOM_FBEH_SEQ);
+
+			// the output file is created even if nothing matches
+			uint oflags = FCOM_FILE_WRITE;
+			oflags |= fcom_file_cominfo_flags_o(h->cmd);
+			r = core->file->open(h->out, h->cmd->output.ptr, oflags);
+			if (r == FCOM_FILE_ERR) goto end;
+
+			ffmem_zero_obj(&h->html);
+			htmlread_open(&h->html);
+			h->tag_filters = 0;
+			h->attr_filters = 0;
+			h->ibuf.len = 0;
 			h->st = I_READ;
+		}
 			// fallthrough
 
 		case I_READ:
-			if (fffile_readwhole(h->iname.ptr, &h->fdata, (uint64)-1))
-				goto end;
-			h->idata = *(ffstr*)&h->fdata;
+			r = core->file->read(h->in, &h->data, -1);
+			if (r == FCOM_FILE_ERR) goto end;
+			if (r == FCOM_FILE_EOF) {
+				htmlread_close(&h->html);
+				core->file->close(h->in);
+				core->file->close(h->out);
+				h->st = I_IN;
+				continue;
+			}
 			h->st = I_PROC;
 			// fallthrough
 
-		case I_PROC:
-			htmlread_open(&h->html);
-			while (h->idata.len) {
-				ffstr val;
-				if (html_find_tagattr(&h->conf, &h->idata, &val, &h->html))
-					break;
-				ffvec_addstr(&h->buf, &val);
-				ffvec_addchar(&h->buf, '\n');
+		case I_PROC: {
+			ffstr in = h->data;
+			if (h->ibuf.len != 0) {
+				// append new data to the incomplete token from the previous chunk
+				ffvec_addstr(&h->ibuf, &h->data);
+				in = *(ffstr*)&h->ibuf;
 			}
-			htmlread_close(&h->html);
-			h->st = I_OUT_OPEN;
-			// fallthrough
 
-		case I_OUT_OPEN: {
-			uint oflags = FCOM_FILE_WRITE;
-			oflags |= fcom_file_cominfo_flags_o(h->cmd);
-			r = core->file->open(h->out, h->cmd->output.ptr, oflags);
-			if (r == FCOM_FILE_ERR) goto end;
+			ffsize n = html_process(h, in);
+			if (n > H_CARRY_MAX) {
+				// don't buffer a token of unlimited size (e.g. an unclosed quote): skip it
+				fcom_warnlog("%S: line %U: HTML token is too large (%L bytes): skipping"
+					, &h->iname, h->html.line, n);
+				n = 0;
+				uint64 line = h->html.line;
+				ffmem_zero_obj(&h->html);
+				htmlread_open(&h->html);
+				h->html.line = line;
+				h->tag_filters = 0;
+				h->attr_filters = 0;
+			}
+			const char *tail = in.ptr + in.len - n;
+			if (h->ibuf.len != 0) {
+				ffmem_move(h->ibuf.ptr, tail, n);
+				h->ibuf.len = n;
+			} else if (n != 0) {
+				ffvec_add(&h->ibuf, tail, n, 1);
+			}
 			h->st = I_WRITE;
 		}
 			// fallthrough
 
 		case I_WRITE:
-			r = core->file->write(h->out, *(ffstr*)&h->buf, -1);
-			if (r == FCOM_FILE_ERR) goto end;
-			core->file->close(h->out);
+			if (h->buf.len != 0) {
+				r = core->file->write(h->out, *(ffstr*)&h->buf, -1);
+				if (r == FCOM_FILE_ERR) goto end;
+				h->buf.len = 0;
+			}
 
-			h->st = I_IN;
+			h->st = I_READ;
 			continue;
 		}
 	}
@@ -11,7 +11,7 @@ Usage:\n\
 }
 
 #include <fcom.h>
-#include <ffbase/unicode.h>
+#include <util/utf8-conv.h>
 
 static const fcom_core *core;
 
@@ -22,11 +22,11 @@ struct utf8 {
 	uint stop;
 	fcom_cominfo *cmd;
 
-	fcom_file_obj *out;
+	fcom_file_obj *in, *out;
 	ffstr iname;
 	ffstr data;
-	ffvec fdata, buf;
-	uint64 off;
+	ffvec buf;
+	struct utf8conv conv;
 };
 
 static int args_parse(struct utf8 *u, fcom_cominfo *cmd)
@@ -46,8 +46,8 @@ static int args_parse(struct utf8 *u, fcom_cominfo *cmd)
 static void utf8_close(fcom_op *op)
 {
 	struct utf8 *u = op;
+	core->file->destroy(u->in);
 	core->file->destroy(u->out);
-	ffvec_free(&u->fdata);
 	ffvec_free(&u->buf);
 	ffmem_free(u);
 }
@@ -61,7 +61,8 @@ static fcom_op* utf8_create(fcom_cominfo *cmd)
 		goto end;
 
 	struct fcom_file_conf fc = {};
-	fc.buffer_size = cmd->buffer_size;
+	fcom_cmd_file_conf(&fc, cmd);
+	u->in = core->file->create(&fc);
 	u->out = core->file->create(&fc);
 
 	return u;
@@ -71,67 +72,16 @@ end:
 	return NULL;
 }
 
-static ffsize ffutf8_encodedata(char *dst, ffsize cap, const char *src, ffsize *plen, uint flags)
-{
-	ffssize r;
-	ffsize len = *plen;
-
-	switch (flags) {
-	case FFUNICODE_UTF8:
-		if (dst == NULL)
-			return len;
-		len = ffmin(cap, len);
-		ffmem_copy(dst, src, len);
-		*plen = len;
-		return len;
-
-	case FFUNICODE_UTF16LE:
-		r = ffutf8_from_utf16(dst, cap, src, *plen, FFUNICODE_UTF16LE);
-		break;
-
-	case FFUNICODE_UTF16BE:
-		r = ffutf8_from_utf16(dst, cap, src, *plen, FFUNICODE_UTF16BE);
-		break;
-
-	default:
-		r = ffutf8_from_cp(dst, cap, src, *plen, flags);
-		break;
-	}
-
-	if (r < 0)
-		return 0;
-	return r;
-}
-
-static ffsize ffutf8_encodewhole(char *dst, ffsize cap, const char *src, ffsize len, uint flags)
-{
-	ffsize ln = len;
-	ffsize r = ffutf8_encodedata(dst, cap, src, &ln, flags);
-	if (ln != len)
-		return 0; //not enough output space
-	return r;
-}
-
-static ffsize ffutf8_strencode(ffvec *dst, const char *src, ffsize len, uint flags)
-{
-	ffsize r = ffutf8_encodewhole(NULL, 0, src, len, flags);
-	if (NULL == ffvec_realloc(dst, r, 1))
-		return 0;
-	r = ffutf8_encodewhole(dst->ptr, dst->cap, src, len, flags);
-	dst->len = r;
-	return r;
-}
-
 static void utf8_run(fcom_op *op)
 {
 	struct utf8 *u = op;
 	int r, rc = 1;
-	enum { I_IN, I_READ, I_PROC, I_OUT_OPEN, I_WRITE };
+	enum { I_IN, I_BOM, I_OUT_OPEN, I_PROC, I_WRITE, I_READ, I_FIN };
 
 	while (!FFINT_READONCE(u->stop)) {
 		switch (u->st) {
 
-		case I_IN:
+		case I_IN: {
 			if (0 > (r = core->com->input_next(u->cmd, &u->iname, NULL, 0))) {
 				if (r == FCOM_COM_RINPUT_NOMORE)
 					rc = 0;
@@ -141,31 +91,30 @@ static void utf8_run(fcom_op *op)
 			if (0 != core->com->input_allowed(u->cmd, u->iname, FCOM_COM_IA_AUTO))
 				continue;
 
-			u->st = I_READ;
+			uint iflags = fcom_file_cominfo_flags_i(u->cmd);
+			r = core->file->open(u->in, u->iname.ptr, iflags);
+			if (r == FCOM_FILE_ERR) goto end;
+			core->file->behaviour(u->in, FCOM_FBEH_SEQ);
+			u->st = I_BOM;
+		}
 			// fallthrough
 
-		case I_READ:
-			if (0 != fffile_readwhole(u->iname.ptr, &u->fdata, (uint64)-1))
-				goto end;
-			u->st = I_PROC;
-			// fallthrough
+		case I_BOM: {
+			r = core->file->read(u->in, &u->data, -1);
+			if (r == FCOM_FILE_ERR) goto end;
 
-		case I_PROC: {
-			ffstr data = *(ffstr*)&u->fdata;
-			ffsize n = data.len;
-			int coding = ffutf_bom(data.ptr, &n);
+			ffsize n = u->data.len;
+			int coding = -1;
+			if (r != FCOM_FILE_EOF)
+				coding = ffutf_bom(u->data.ptr, &n);
 			if (coding == -1) {
 				fcom_infolog("%S: no BOM, skipping file", &u->iname);
+				core->file->close(u->in);
 				u->st = I_IN;
 				continue;
 			}
-			ffstr_shift(&data, n);
-
-			u->buf.len = 0;
-			if (0 == ffutf8_strencode(&u->buf, data.ptr, data.len, coding)) {
-				fcom_errlog("ffutf8_strencode");
-				goto end;
-			}
+			ffstr_shift(&u->data, n);
+			utf8conv_init(&u->conv, coding);
 			u->st = I_OUT_OPEN;
 		}
 			// fallthrough
@@ -175,16 +124,46 @@ static void utf8_run(fcom_op *op)
 			oflags |= fcom_file_cominfo_flags_o(u->cmd);
 			r = core->file->open(u->out, u->cmd->output.ptr, oflags);
 			if (r == FCOM_FILE_ERR) goto end;
-			u->st = I_WRITE;
+			u->st = I_PROC;
 		}
 			// fallthrough
 
+		case I_PROC:
+			u->buf.len = 0;
+			if (0 != utf8conv_process(&u->conv, u->data.ptr, u->data.len, &u->buf)) {
+				fcom_errlog("%S: conversion to UTF-8 failed", &u->iname);
+				goto end;
+			}
+			u->st = I_WRITE;
+			// fallthrough
+
 		case I_WRITE:
 			r = core->file->write(u->out, *(ffstr*)&u->buf, -1);
 			if (r == FCOM_FILE_ERR) goto end;
+			u->st = I_READ;
+			// fallthrough
 
-			core->file->close(u->out);
+		case I_READ:
+			r = core->file->read(u->in, &u->data, -1);
+			if (r == FCOM_FILE_ERR) goto end;
+			if (r == FCOM_FILE_EOF) {
+				u->st = I_FIN;
+				continue;
+			}
+			u->st = I_PROC;
+			continue;
 
+		case I_FIN:
+			u->buf.len = 0;
+			if (0 != utf8conv_fin(&u->conv, &u->buf)) {
+				fcom_errlog("%S: conversion to UTF-8 failed", &u->iname);
+				goto end;
+			}
+			r = core->file->write(u->out, *(ffstr*)&u->buf, -1);
+			if (r == FCOM_FILE_ERR) goto end;
+
+			core->file->close(u->out);
+			core->file->close(u->in);
 			u->st = I_IN;
 			continue;
 		}
@@ -7,6 +7,9 @@ htmlread_process
 */
 
 #include <ffbase/string.h>
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
 
 typedef struct htmlread {
 	ffuint state, nextstate;
@@ -15,6 +18,30 @@ typedef struct htmlread {
 	int tag_lslash;
 } htmlread;
 
+/** Find the first occurrence of any of 2 characters.
+Processes 16 bytes at once with SSE2.
+Return -1 if not found */
+static inline ffssize _html_find2(const char *s, ffsize len, char a, char b)
+{
+	ffsize i = 0;
+
+#ifdef __SSE2__
+	const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+	for (;  i + 16 <= len;  i += 16) {
+		__m128i v = _mm_loadu_si128((__m128i*)(s + i));
+		ffuint m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+		if (m != 0)
+			return i + __builtin_ctz(m);
+	}
+#endif
+
+	for (;  i != len;  i++) {
+		if (s[i] == a || s[i] == b)
+			return i;
+	}
+	return -1;
+}
+
 void htmlread_open(htmlread *h)
 {
 	h->line = 1;
@@ -57,7 +84,7 @@ int htmlread_process(htmlread *h, ffstr *in, ffstr *out)
 			else
 				out->ptr = in->ptr;
 
-			if (0 > (i = ffstr_findany(in, "<\n", 2))) {
+			if (0 > (i = _html_find2(in->ptr, in->len, '<', '\n'))) {
 				out->len = in->ptr + in->len - out->ptr;
 				if (out->len == 0)
 					return HTML_MORE;
@@ -84,7 +111,9 @@ int htmlread_process(htmlread *h, ffstr *in, ffstr *out)
 			// fallthrough
 
 		case I_TAG_1: // "<": handle "</"
-			if (in->len != 0 && in->ptr[i] == '/') {
+			if (in->len == 0)
+				return HTML_MORE;
+			if (in->ptr[0] == '/') {
 				h->tag_lslash = 1; // </...
 				ffstr_shift(in, 1);
 			}
@@ -152,22 +181,44 @@ int htmlread_process(htmlread *h, ffstr *in, ffstr *out)
 			return HTML_ATTR;
 
 		case I_ATTR_EQ: // "<tag attr": handle "="
+			if (in->len == 0)
+				return HTML_MORE;
 			if (in->ptr[0] != '=') { // "<tag attr "
 				h->state = I_WSPACE,  h->nextstate = I_ATTR;
 				continue;
 			}
 			ffstr_shift(in, 1);
 			h->state = I_WSPACE,  h->nextstate = I_ATTRVAL;
-			// fallthrough
+			continue;
 
 		case I_ATTRVAL: // "<tag attr=": return attribute value
+			if (in->len == 0)
+				return HTML_MORE;
+
 			if (!(in->ptr[0] == '"' || in->ptr[0] == '\'')) {
-				//TODO
-				// h->state = I_ATTR;
-				continue;
+				// "<tag attr=val>" or "<tag attr=val/>"
+				for (ffsize off = 0;;) {
+					ffssize k = ffs_findany(in->ptr + off, in->len - off, " \t\r\n>/", 6);
+					if (k < 0)
+						return HTML_MORE;
+					i = off + k;
+					if (in->ptr[i] != '/')
+						break;
+					if ((ffsize)i + 1 == in->len)
+						return HTML_MORE; // "/" or "/>"?
+					if (in->ptr[i + 1] == '>')
+						break;
+					off = i + 1; // "val/val"
+				}
+
+				ffstr_set(out, in->ptr, i);
+				ffstr_shift(in, i);
+				h->state = I_WSPACE,  h->nextstate = I_ATTR;
+				return HTML_ATTR_VAL;
 			}
 
-			if (0 > (i = ffs_findany(in->ptr + 1, in->len - 1, "\"\n", 2)))
+			c = in->ptr[0];
+			if (0 > (i = _html_find2(in->ptr + 1, in->len - 1, c, c)))
 				return HTML_MORE;
 			//TODO line++
 
@@ -177,7 +228,7 @@ int htmlread_process(htmlread *h, ffstr *in, ffstr *out)
 			return HTML_ATTR_VAL;
 
 		case I_ANGL_R: // skip input until next '>'
-			if (0 > (i = ffstr_findany(in, ">\n", 2))) {
+			if (0 > (i = _html_find2(in->ptr, in->len, '>', '\n'))) {
 				ffstr_shift(in, in->len);
 				return HTML_MORE;
 			}
@@ -0,0 +1,295 @@
+/** fcom: Resize images line by line (separable convolution)
+2026, Simon Zolin */
+
+/*
+pic_resize_init pic_resize_free
+pic_resize_process
+*/
+
+/*
+Each input line is resampled horizontally into a ring buffer of lines.
+When the ring buffer contains all lines needed for the next output line,
+ the vertical pass computes it.
+Both passes use fixed-point weights; the vertical pass uses SSE2.
+*/
+
+#pragma once
+#include <ffbase/string.h>
+#include <math.h>
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
+
+enum PIC_RESIZE_FILTER {
+	PIC_RESIZE_BILINEAR,
+	PIC_RESIZE_BOX,
+	PIC_RESIZE_LANCZOS,
+};
+
+#define _PIC_RESIZE_PREC  14
+
+/** Weights for one output pixel (or line) */
+struct _pic_rs_coef {
+	ffuint start, n;
+};
+
+struct _pic_rs_dim {
+	struct _pic_rs_coef *coef; // [out]
+	short *weights; // [out][ntaps]
+	ffuint ntaps;
+};
+
+struct pic_resize {
+	ffuint src_w, src_h, dst_w, dst_h;
+	ffuint channels;
+	struct _pic_rs_dim h, v;
+
+	ffbyte *ring; // horizontally resampled lines
+	ffuint ring_lines;
+	ffuint line_in, line_out;
+	ffbyte *out;
+};
+
+static inline double _pic_rs_sinc(double x)
+{
+	if (x == 0)
+		return 1;
+	x *= 3.14159265358979323846;
+	return sin(x) / x;
+}
+
+static inline double _pic_rs_filter(ffuint filter, double x)
+{
+	if (filter == PIC_RESIZE_BOX)
+		return (x > -0.5 && x <= 0.5) ? 1 : 0;
+
+	x = fabs(x);
+	switch (filter) {
+	case PIC_RESIZE_LANCZOS:
+		return (x < 3) ? _pic_rs_sinc(x) * _pic_rs_sinc(x / 3) : 0;
+	}
+	return (x < 1) ? 1 - x : 0;
+}
+
+static inline double _pic_rs_support(ffuint filter)
+{
+	switch (filter) {
+	case PIC_RESIZE_BOX:
+		return 0.5;
+	case PIC_RESIZE_LANCZOS:
+		return 3;
+	}
+	return 1;
+}
+
+/** Compute fixed-point weights for resampling `in` pixels into `out` pixels */
+static inline int _pic_rs_coefs(struct _pic_rs_dim *d, ffuint in, ffuint out, ffuint filter)
+{
+	double scale = (double)in / out;
+	double fscale = (scale > 1) ? scale : 1;
+	double support = _pic_rs_support(filter) * fscale;
+	d->ntaps = (ffuint)ceil(support) * 2 + 1;
+
+	double *w = ffmem_alloc(d->ntaps * sizeof(double));
+	d->coef = ffmem_alloc(out * sizeof(struct _pic_rs_coef));
+	d->weights = ffmem_calloc(out * d->ntaps, sizeof(short));
+	if (w == NULL || d->coef == NULL || d->weights == NULL) {
+		ffmem_free(w);
+		return -1;
+	}
+
+	for (ffuint i = 0;  i != out;  i++) {
+		double center = (i + 0.5) * scale;
+		int xmin = (int)(center - support + 0.5);
+		if (xmin < 0)
+			xmin = 0;
+		int xmax = (int)(center + support + 0.5);
+		if (xmax > (int)in)
+			xmax = in;
+		ffuint n = ffmin((ffuint)(xmax - xmin), d->ntaps);
+
+		double sum = 0;
+		for (ffuint k = 0;  k != n;  k++) {
+			w[k] = _pic_rs_filter(filter, (k + xmin - center + 0.5) / fscale);
+			sum += w[k];
+		}
+
+		short *ws = d->weights + i * d->ntaps;
+		for (ffuint k = 0;  k != n;  k++) {
+			double v = (sum != 0) ? w[k] / sum : 0;
+			ws[k] = (short)lround(v * (1 << _PIC_RESIZE_PREC));
+		}
+		d->coef[i].start = xmin;
+		d->coef[i].n = n;
+	}
+
+	ffmem_free(w);
+	return 0;
+}
+
+static inline void _pic_rs_dim_free(struct _pic_rs_dim *d)
+{
+	ffmem_free(d->coef);
+	ffmem_free(d->weights);
+}
+
+static inline ffbyte _pic_rs_clamp(int v)
+{
+	v = (v + (1 << (_PIC_RESIZE_PREC - 1))) >> _PIC_RESIZE_PREC;
+	if (v < 0)
+		return 0;
+	if (v > 255)
+		return 255;
+	return v;
+}
+
+static inline void pic_resize_free(struct pic_resize *rs)
+{
+	_pic_rs_dim_free(&rs->h);
+	_pic_rs_dim_free(&rs->v);
+	ffmem_alignfree(rs->ring);
+	ffmem_alignfree(rs->out);
+	ffmem_zero_obj(rs);
+}
+
+/**
+channels: bytes per pixel (3 or 4)
+filter: enum PIC_RESIZE_FILTER
+Return 0 on success */
+static inline int pic_resize_init(struct pic_resize *rs, ffuint src_w, ffuint src_h, ffuint dst_w, ffuint dst_h, ffuint channels, ffuint filter)
+{
+	ffmem_zero_obj(rs);
+	rs->src_w = src_w;
+	rs->src_h = src_h;
+	rs->dst_w = dst_w;
+	rs->dst_h = dst_h;
+	rs->channels = channels;
+
+	if (_pic_rs_coefs(&rs->h, src_w, dst_w, filter)
+		|| _pic_rs_coefs(&rs->v, src_h, dst_h, filter))
+		goto err;
+
+	for (ffuint i = 0;  i != dst_h;  i++) {
+		rs->ring_lines = ffmax(rs->ring_lines, rs->v.coef[i].n);
+	}
+
+	ffsize line = ffint_align_ceil2(dst_w * channels, 16);
+	if (NULL == (rs->ring = ffmem_align(line * rs->ring_lines, 16))
+		|| NULL == (rs->out = ffmem_align(line, 16)))
+		goto err;
+	return 0;
+
+err:
+	pic_resize_free(rs);
+	return -1;
+}
+
+static inline void _pic_rs_horiz(struct pic_resize *rs, const ffbyte *in, ffbyte *out)
+{
+	const ffuint ch = rs->channels;
+	for (ffuint x = 0;  x != rs->dst_w;  x++) {
+		const struct _pic_rs_coef *c = &rs->h.coef[x];
+		const short *w = rs->h.weights + x * rs->h.ntaps;
+		const ffbyte *s = in + c->start * ch;
+		int acc[4] = {0};
+
+		for (ffuint k = 0;  k != c->n;  k++) {
+			for (ffuint i = 0;  i != ch;  i++) {
+				acc[i] += s[k * ch + i] * w[k];
+			}
+		}
+
+		for (ffuint i = 0;  i != ch;  i++) {
+			out[x * ch + i] = _pic_rs_clamp(acc[i]);
+		}
+	}
+}
+
+static inline void _pic_rs_vert(struct pic_resize *rs, ffuint y)
+{
+	const struct _pic_rs_coef *c = &rs->v.coef[y];
+	const short *w = rs->v.weights + y * rs->v.ntaps;
+	const ffsize line = ffint_align_ceil2(rs->dst_w * rs->channels, 16);
+	const ffsize len = rs->dst_w * rs->channels;
+	const ffbyte *rows[c->n + 1];
+	ffsize i = 0;
+
+	for (ffuint k = 0;  k != c->n;  k++) {
+		rows[k] = rs->ring + ((c->start + k) % rs->ring_lines) * line;
+	}
+
+#ifdef __SSE2__
+	// process 2 lines at once: (row[k][x] * w[k] + row[k+1][x] * w[k+1]) for 8 bytes
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi32(1 << (_PIC_RESIZE_PREC - 1));
+	for (;  i + 8 <= len;  i += 8) {
+		__m128i lo = round, hi = round;
+		ffuint k;
+		for (k = 0;  k + 2 <= c->n;  k += 2) {
+			__m128i a = _mm_loadl_epi64((__m128i*)(rows[k] + i));
+			__m128i b = _mm_loadl_epi64((__m128i*)(rows[k + 1] + i));
+			__m128i ab = _mm_unpacklo_epi8(a, b);
+			__m128i ww = _mm_set1_epi32(((ffuint)(ffushort)w[k + 1] << 16) | (ffushort)w[k]);
+			lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi8(ab, zero), ww));
+			hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi8(ab, zero), ww));
+		}
+		if (k != c->n) {
+			__m128i a = _mm_loadl_epi64((__m128i*)(rows[k] + i));
+			__m128i ab = _mm_unpacklo_epi8(a, zero);
+			__m128i ww = _mm_set1_epi32((ffushort)w[k]);
+			lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi8(ab, zero), ww));
+			hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi8(ab, zero), ww));
+		}
+		lo = _mm_srai_epi32(lo, _PIC_RESIZE_PREC);
+		hi = _mm_srai_epi32(hi, _PIC_RESIZE_PREC);
+		__m128i r = _mm_packs_epi32(lo, hi);
+		_mm_storel_epi64((__m128i*)(rs->out + i), _mm_packus_epi16(r, r));
+	}
+#endif
+
+	for (;  i != len;  i++) {
+		int acc = 0;
+		for (ffuint k = 0;  k != c->n;  k++) {
+			acc += rows[k][i] * w[k];
+		}
+		rs->out[i] = _pic_rs_clamp(acc);
+	}
+}
+
+/** Resample the next line.
+input: input line; set to empty when consumed
+output: output line
+Return 0 if output line is ready;
+ 'more': need next input line;
+ 'done': all output lines are ready */
+static inline int pic_resize_process(struct pic_resize *rs, ffstr *input, ffstr *output)
+{
+	const ffsize line = ffint_align_ceil2(rs->dst_w * rs->channels, 16);
+
+	for (;;) {
+		if (rs->line_out == rs->dst_h)
+			return 'done';
+
+		const struct _pic_rs_coef *c = &rs->v.coef[rs->line_out];
+		if (rs->line_in < c->start + c->n) {
+			if (input->len == 0)
+				return 'more';
+
+			// don't store the lines that won't be used
+			if (rs->line_in >= c->start) {
+				ffbyte *dst = rs->ring + (rs->line_in % rs->ring_lines) * line;
+				_pic_rs_horiz(rs, (ffbyte*)input->ptr, dst);
+			}
+			rs->line_in++;
+			input->len = 0;
+			continue;
+		}
+
+		_pic_rs_vert(rs, rs->line_out);
+		rs->line_out++;
+		ffstr_set(output, rs->out, rs->dst_w * rs->channels);
+		return 0;
+	}
+}
+
+#undef _PIC_RESIZE_PREC
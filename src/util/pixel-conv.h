@@ -1,6 +1,23 @@
 /** fcom: Convert pixel lines
 2016, Simon Zolin */
 
+/*
+pic_convert_c
+pic_simd_detect
+pic_convert_simd
+pic_convert
+*/
+
+#pragma once
+#include <ffbase/base.h>
+#if defined __x86_64__ || defined __i386__
+	#include <immintrin.h>
+	#define PIC_SIMD_X86
+#elif defined __ARM_NEON && defined __aarch64__
+	#include <arm_neon.h>
+	#define PIC_SIMD_ARM
+#endif
+
 enum PIC_FMT {
 	PIC_RGB = 24,
 	PIC_RGBA = 32,
@@ -13,9 +30,9 @@ enum PIC_FMT {
 
 #define CASE(a, b)  (((a) << 8) | (b))
 
-/** Convert pixels
+/** Convert pixels (portable implementation)
 in_fmt, out_fmt: enum PIC_FMT */
-static inline int pic_convert(ffuint in_fmt, const void *_src, ffuint out_fmt, void *_dst, ffuint pixels)
+static inline int pic_convert_c(ffuint in_fmt, const void *_src, ffuint out_fmt, void *_dst, ffuint pixels)
 {
 	ffuint i;
 	const ffbyte *in, *src = _src;
@@ -116,6 +133,52 @@ static inline int pic_convert(ffuint in_fmt, const void *_src, ffuint out_fmt, v
 		}
 		break;
 
+	case CASE(PIC_RGB, PIC_RGBA):
+	case CASE(PIC_BGR, PIC_BGRA):
+		for (i = 0;  i != pixels;  i++) {
+			in = src + i * 3;
+			o = dst + i * 4;
+			o[0] = in[0];
+			o[1] = in[1];
+			o[2] = in[2];
+			o[3] = 0xff;
+		}
+		break;
+
+	case CASE(PIC_RGB, PIC_BGRA):
+	case CASE(PIC_BGR, PIC_RGBA):
+		for (i = 0;  i != pixels;  i++) {
+			in = src + i * 3;
+			o = dst + i * 4;
+			o[0] = in[2];
+			o[1] = in[1];
+			o[2] = in[0];
+			o[3] = 0xff;
+		}
+		break;
+
+	case CASE(PIC_RGB, PIC_ABGR):
+		for (i = 0;  i != pixels;  i++) {
+			in = src + i * 3;
+			o = dst + i * 4;
+			o[0] = 0xff;
+			o[1] = in[2];
+			o[2] = in[1];
+			o[3] = in[0];
+		}
+		break;
+
+	case CASE(PIC_BGR, PIC_ABGR):
+		for (i = 0;  i != pixels;  i++) {
+			in = src + i * 3;
+			o = dst + i * 4;
+			o[0] = 0xff;
+			o[1] = in[0];
+			o[2] = in[1];
+			o[3] = in[2];
+		}
+		break;
+
 	default:
 		return -1;
 	}
@@ -123,4 +186,289 @@ static inline int pic_convert(ffuint in_fmt, const void *_src, ffuint out_fmt, v
 	return 0;
 }
 
+
+/* SIMD kernels.
+All conversions are byte shuffles within a block of 4 pixels (16 bytes for 32-bit pixels):
+ 4->4: reorder channels
+ 3->3: reorder channels; only 12 bytes of a 16-byte block are used
+ 3->4: expand and set alpha=0xff
+ 4->3: apply alpha channel, then pack
+The kernels read and write whole 16-byte blocks,
+ so the last pixels of a line are always converted by pic_convert_c().
+Input and output buffers must not overlap. */
+
+enum PIC_SIMD {
+	PIC_SIMD_NONE,
+	PIC_SIMD_SSSE3,
+	PIC_SIMD_AVX2,
+	PIC_SIMD_NEON,
+};
+
+enum _PIC_K {
+	_PIC_K_SHUF,
+	_PIC_K_EXPAND,
+	_PIC_K_ALPHA,
+};
+
+struct _pic_kernel {
+	ffuint cas;
+	ffbyte kind; // enum _PIC_K
+	ffbyte in_bpp, out_bpp; // bytes per pixel
+	ffbyte alpha; // _PIC_K_ALPHA: alpha channel index
+	ffbyte mask[16]; // shuffle mask; bytes with the highest bit set are zeroed
+};
+
+#define _PIC_Z  0x80
+#define _PIC_M44(a, b, c, d) \
+	{ a, b, c, d,  4+a, 4+b, 4+c, 4+d,  8+a, 8+b, 8+c, 8+d,  12+a, 12+b, 12+c, 12+d }
+#define _PIC_M33(a, b, c) \
+	{ a, b, c,  3+a, 3+b, 3+c,  6+a, 6+b, 6+c,  9+a, 9+b, 9+c,  _PIC_Z, _PIC_Z, _PIC_Z, _PIC_Z }
+#define _PIC_M34(a, b, c, d) \
+	{ a, b, c, d,  3+a, 3+b, 3+c, 3+d,  6+a, 6+b, 6+c, 6+d,  9+a, 9+b, 9+c, 9+d }
+#define _PIC_M43(a, b, c) \
+	{ a, b, c,  4+a, 4+b, 4+c,  8+a, 8+b, 8+c,  12+a, 12+b, 12+c,  _PIC_Z, _PIC_Z, _PIC_Z, _PIC_Z }
+
+static const struct _pic_kernel _pic_kernels[] = {
+	{ CASE(PIC_RGB, PIC_BGR),	_PIC_K_SHUF, 3, 3, 0, _PIC_M33(2, 1, 0) },
+	{ CASE(PIC_BGR, PIC_RGB),	_PIC_K_SHUF, 3, 3, 0, _PIC_M33(2, 1, 0) },
+
+	{ CASE(PIC_ABGR, PIC_RGBA),	_PIC_K_SHUF, 4, 4, 0, _PIC_M44(3, 2, 1, 0) },
+	{ CASE(PIC_RGBA, PIC_ABGR),	_PIC_K_SHUF, 4, 4, 0, _PIC_M44(3, 2, 1, 0) },
+	{ CASE(PIC_RGBA, PIC_BGRA),	_PIC_K_SHUF, 4, 4, 0, _PIC_M44(2, 1, 0, 3) },
+	{ CASE(PIC_BGRA, PIC_RGBA),	_PIC_K_SHUF, 4, 4, 0, _PIC_M44(2, 1, 0, 3) },
+	{ CASE(PIC_BGRA, PIC_ABGR),	_PIC_K_SHUF, 4, 4, 0, _PIC_M44(3, 0, 1, 2) },
+
+	{ CASE(PIC_ABGR, PIC_BGR),	_PIC_K_ALPHA, 4, 3, 0, _PIC_M43(1, 2, 3) },
+	{ CASE(PIC_ABGR, PIC_RGB),	_PIC_K_ALPHA, 4, 3, 0, _PIC_M43(3, 2, 1) },
+	{ CASE(PIC_RGBA, PIC_RGB),	_PIC_K_ALPHA, 4, 3, 3, _PIC_M43(0, 1, 2) },
+	{ CASE(PIC_BGRA, PIC_BGR),	_PIC_K_ALPHA, 4, 3, 3, _PIC_M43(0, 1, 2) },
+	{ CASE(PIC_RGBA, PIC_BGR),	_PIC_K_ALPHA, 4, 3, 3, _PIC_M43(2, 1, 0) },
+	{ CASE(PIC_BGRA, PIC_RGB),	_PIC_K_ALPHA, 4, 3, 3, _PIC_M43(2, 1, 0) },
+
+	{ CASE(PIC_RGB, PIC_RGBA),	_PIC_K_EXPAND, 3, 4, 0, _PIC_M34(0, 1, 2, _PIC_Z) },
+	{ CASE(PIC_BGR, PIC_BGRA),	_PIC_K_EXPAND, 3, 4, 0, _PIC_M34(0, 1, 2, _PIC_Z) },
+	{ CASE(PIC_RGB, PIC_BGRA),	_PIC_K_EXPAND, 3, 4, 0, _PIC_M34(2, 1, 0, _PIC_Z) },
+	{ CASE(PIC_BGR, PIC_RGBA),	_PIC_K_EXPAND, 3, 4, 0, _PIC_M34(2, 1, 0, _PIC_Z) },
+	{ CASE(PIC_RGB, PIC_ABGR),	_PIC_K_EXPAND, 3, 4, 0, _PIC_M34(_PIC_Z, 2, 1, 0) },
+	{ CASE(PIC_BGR, PIC_ABGR),	_PIC_K_EXPAND, 3, 4, 0, _PIC_M34(_PIC_Z, 0, 1, 2) },
+};
+
+#undef _PIC_M44
+#undef _PIC_M33
+#undef _PIC_M34
+#undef _PIC_M43
+
+static inline const struct _pic_kernel* _pic_kernel_find(ffuint in_fmt, ffuint out_fmt)
+{
+	ffuint cas = CASE(in_fmt, out_fmt);
+	for (ffuint i = 0;  i != FF_COUNT(_pic_kernels);  i++) {
+		if (_pic_kernels[i].cas == cas)
+			return &_pic_kernels[i];
+	}
+	return NULL;
+}
+
+/** Get the number of pixels after which a 16-byte block can't be read or written */
+static inline ffuint _pic_kernel_tail(const struct _pic_kernel *k)
+{
+	return (k->in_bpp == 3 || k->out_bpp == 3) ? 6 : 4;
+}
+
+#ifdef PIC_SIMD_X86
+
+/** x * a / 255 for 16-bit values (exact for 8-bit inputs) */
+__attribute__((target("ssse3")))
+static inline __m128i _pic_mul255_sse(__m128i x, __m128i a)
+{
+	__m128i t = _mm_mullo_epi16(x, a);
+	t = _mm_add_epi16(t, _mm_add_epi16(_mm_srli_epi16(t, 8), _mm_set1_epi16(1)));
+	return _mm_srli_epi16(t, 8);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i _pic_mul255_avx2(__m256i x, __m256i a)
+{
+	__m256i t = _mm256_mullo_epi16(x, a);
+	t = _mm256_add_epi16(t, _mm256_add_epi16(_mm256_srli_epi16(t, 8), _mm256_set1_epi16(1)));
+	return _mm256_srli_epi16(t, 8);
+}
+
+__attribute__((target("ssse3")))
+static ffsize _pic_conv_ssse3(const struct _pic_kernel *k, const ffbyte *src, ffbyte *dst, ffsize pixels)
+{
+	const ffuint a = k->alpha, Z = _PIC_Z;
+	const __m128i mask = _mm_loadu_si128((__m128i*)k->mask);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha_or = _mm_cmplt_epi8(mask, zero);
+	const __m128i amask_lo = _mm_setr_epi8(a, Z, a, Z, a, Z, a, Z, 4+a, Z, 4+a, Z, 4+a, Z, 4+a, Z);
+	const __m128i amask_hi = _mm_setr_epi8(8+a, Z, 8+a, Z, 8+a, Z, 8+a, Z, 12+a, Z, 12+a, Z, 12+a, Z, 12+a, Z);
+	ffsize i, tail = _pic_kernel_tail(k);
+
+	for (i = 0;  i + tail <= pixels;  i += 4) {
+		__m128i v = _mm_loadu_si128((__m128i*)(src + i * k->in_bpp));
+
+		if (k->kind == _PIC_K_ALPHA) {
+			__m128i lo = _mm_unpacklo_epi8(v, zero);
+			__m128i hi = _mm_unpackhi_epi8(v, zero);
+			lo = _pic_mul255_sse(lo, _mm_shuffle_epi8(v, amask_lo));
+			hi = _pic_mul255_sse(hi, _mm_shuffle_epi8(v, amask_hi));
+			v = _mm_packus_epi16(lo, hi);
+		}
+
+		v = _mm_shuffle_epi8(v, mask);
+		if (k->kind == _PIC_K_EXPAND)
+			v = _mm_or_si128(v, alpha_or);
+		_mm_storeu_si128((__m128i*)(dst + i * k->out_bpp), v);
+	}
+	return i;
+}
+
+/** Same as SSSE3 kernel, but each 128-bit lane converts its own block of 4 pixels */
+__attribute__((target("avx2")))
+static ffsize _pic_conv_avx2(const struct _pic_kernel *k, const ffbyte *src, ffbyte *dst, ffsize pixels)
+{
+	const ffuint a = k->alpha, Z = _PIC_Z;
+	const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i*)k->mask));
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alpha_or = _mm256_cmpgt_epi8(zero, mask);
+	const __m256i amask_lo = _mm256_broadcastsi128_si256(
+		_mm_setr_epi8(a, Z, a, Z, a, Z, a, Z, 4+a, Z, 4+a, Z, 4+a, Z, 4+a, Z));
+	const __m256i amask_hi = _mm256_broadcastsi128_si256(
+		_mm_setr_epi8(8+a, Z, 8+a, Z, 8+a, Z, 8+a, Z, 12+a, Z, 12+a, Z, 12+a, Z, 12+a, Z));
+	ffsize i, tail = _pic_kernel_tail(k);
+	const ffuint ib = k->in_bpp, ob = k->out_bpp;
+
+	for (i = 0;  i + 4 + tail <= pixels;  i += 8) {
+		__m256i v = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128((__m128i*)(src + i * ib)))
+			, _mm_loadu_si128((__m128i*)(src + (i + 4) * ib)), 1);
+
+		if (k->kind == _PIC_K_ALPHA) {
+			__m256i lo = _mm256_unpacklo_epi8(v, zero);
+			__m256i hi = _mm256_unpackhi_epi8(v, zero);
+			lo = _pic_mul255_avx2(lo, _mm256_shuffle_epi8(v, amask_lo));
+			hi = _pic_mul255_avx2(hi, _mm256_shuffle_epi8(v, amask_hi));
+			v = _mm256_packus_epi16(lo, hi);
+		}
+
+		v = _mm256_shuffle_epi8(v, mask);
+		if (k->kind == _PIC_K_EXPAND)
+			v = _mm256_or_si256(v, alpha_or);
+
+		if (ob == 4) {
+			_mm256_storeu_si256((__m256i*)(dst + i * 4), v);
+		} else {
+			// the 2nd store overwrites the unused trailer of the 1st one
+			_mm_storeu_si128((__m128i*)(dst + i * ob), _mm256_castsi256_si128(v));
+			_mm_storeu_si128((__m128i*)(dst + (i + 4) * ob), _mm256_extracti128_si256(v, 1));
+		}
+	}
+	return i;
+}
+
+#endif // PIC_SIMD_X86
+
+#ifdef PIC_SIMD_ARM
+
+static inline uint16x8_t _pic_mul255_neon(uint16x8_t x, uint16x8_t a)
+{
+	uint16x8_t t = vmulq_u16(x, a);
+	t = vaddq_u16(t, vaddq_u16(vshrq_n_u16(t, 8), vdupq_n_u16(1)));
+	return vshrq_n_u16(t, 8);
+}
+
+static ffsize _pic_conv_neon(const struct _pic_kernel *k, const ffbyte *src, ffbyte *dst, ffsize pixels)
+{
+	const ffbyte a = k->alpha, Z = _PIC_Z;
+	const uint8x16_t mask = vld1q_u8(k->mask);
+	const uint8x16_t alpha_or = vcgeq_u8(mask, vdupq_n_u8(0x80));
+	const ffbyte alo[16] = { a, Z, a, Z, a, Z, a, Z, 4+a, Z, 4+a, Z, 4+a, Z, 4+a, Z };
+	const ffbyte ahi[16] = { 8+a, Z, 8+a, Z, 8+a, Z, 8+a, Z, 12+a, Z, 12+a, Z, 12+a, Z, 12+a, Z };
+	const uint8x16_t amask_lo = vld1q_u8(alo), amask_hi = vld1q_u8(ahi);
+	ffsize i, tail = _pic_kernel_tail(k);
+
+	for (i = 0;  i + tail <= pixels;  i += 4) {
+		uint8x16_t v = vld1q_u8(src + i * k->in_bpp);
+
+		if (k->kind == _PIC_K_ALPHA) {
+			uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+			uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+			lo = _pic_mul255_neon(lo, vreinterpretq_u16_u8(vqtbl1q_u8(v, amask_lo)));
+			hi = _pic_mul255_neon(hi, vreinterpretq_u16_u8(vqtbl1q_u8(v, amask_hi)));
+			v = vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+		}
+
+		v = vqtbl1q_u8(v, mask);
+		if (k->kind == _PIC_K_EXPAND)
+			v = vorrq_u8(v, alpha_or);
+		vst1q_u8(dst + i * k->out_bpp, v);
+	}
+	return i;
+}
+
+#endif // PIC_SIMD_ARM
+
+/** Get the best SIMD implementation supported by CPU.
+Return enum PIC_SIMD */
+static inline ffuint pic_simd_detect()
+{
+#if defined PIC_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return PIC_SIMD_AVX2;
+	if (__builtin_cpu_supports("ssse3"))
+		return PIC_SIMD_SSSE3;
+#elif defined PIC_SIMD_ARM
+	return PIC_SIMD_NEON;
+#endif
+	return PIC_SIMD_NONE;
+}
+
+/** Convert pixels using the specified implementation
+simd: enum PIC_SIMD
+in_fmt, out_fmt: enum PIC_FMT */
+static inline int pic_convert_simd(ffuint simd, ffuint in_fmt, const void *_src, ffuint out_fmt, void *_dst, ffuint pixels)
+{
+	const ffbyte *src = _src;
+	ffbyte *dst = _dst;
+	const struct _pic_kernel *k;
+	ffsize i = 0;
+
+	if (simd == PIC_SIMD_NONE
+		|| NULL == (k = _pic_kernel_find(in_fmt, out_fmt)))
+		return pic_convert_c(in_fmt, src, out_fmt, dst, pixels);
+
+	switch (simd) {
+#ifdef PIC_SIMD_X86
+	case PIC_SIMD_AVX2:
+		i = _pic_conv_avx2(k, src, dst, pixels);
+		i += _pic_conv_ssse3(k, src + i * k->in_bpp, dst + i * k->out_bpp, pixels - i);
+		break;
+
+	case PIC_SIMD_SSSE3:
+		i = _pic_conv_ssse3(k, src, dst, pixels);
+		break;
+#endif
+
+#ifdef PIC_SIMD_ARM
+	case PIC_SIMD_NEON:
+		i = _pic_conv_neon(k, src, dst, pixels);
+		break;
+#endif
+	}
+
+	return pic_convert_c(in_fmt, src + i * k->in_bpp, out_fmt, dst + i * k->out_bpp, pixels - i);
+}
+
+/** Convert pixels using the best implementation for this CPU
+in_fmt, out_fmt: enum PIC_FMT */
+static inline int pic_convert(ffuint in_fmt, const void *src, ffuint out_fmt, void *dst, ffuint pixels)
+{
+	static ffuint simd = ~0U;
+	if (simd == ~0U)
+		simd = pic_simd_detect();
+	return pic_convert_simd(simd, in_fmt, src, out_fmt, dst, pixels);
+}
+
+#undef _PIC_Z
 #undef CASE
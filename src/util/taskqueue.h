@@ -1,5 +1,6 @@
 /** task queue: First in, first out.  One reader/deleter, multiple writers.
-2013, 2022, Simon Zolin
+Lock-free intrusive MPSC queue (D. Vyukov's algorithm).
+2013, 2022, 2026, Simon Zolin
 */
 
 /*
@@ -11,18 +12,35 @@ fftaskqueue_del
 fftaskqueue_run
 */
 
+/*
+Writers append the items with a single atomic exchange of `head`.
+The reader takes the items from `tail`.
+`stub` item is used so that the list is never empty.
+
+Wake-up coalescing:
+fftaskqueue_post() returns 1 only for the first post after the reader has started processing the tasks.
+The reader resets the flag before taking the items,
+ so a task is never left in queue without a wake-up signal.
+*/
+
 #pragma once
-#include <ffbase/list.h>
-#include <ffbase/lock.h>
+#include <ffbase/base.h>
 
 typedef void (*fftask_handler)(void *param);
 
 typedef struct fftask {
 	fftask_handler handler;
 	void *param;
-	ffchain_item sib;
+	struct fftask *next;
+	ffuint state; // enum _FFTASK_STATE
 } fftask;
 
+enum _FFTASK_STATE {
+	_FFTASK_IDLE,
+	_FFTASK_QUEUED,
+	_FFTASK_DELETED, // still in queue, but must be skipped
+};
+
 #define fftask_set(t, func, udata) \
 	(t)->handler = (func),  (t)->param = (udata)
 
@@ -49,37 +67,64 @@ struct fftaskqueue_conf_log {
 	} while (0)
 #endif
 
+#define _fftq_xchg(ptr, val)  __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST)
+#define _fftq_cas(ptr, old, val) \
+	__atomic_compare_exchange_n(ptr, &(old), val, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#define _fftq_load(ptr)  __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define _fftq_store(ptr, val)  __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
 
 typedef struct fftaskqueue {
 	struct fftaskqueue_conf_log log;
-	fflist tasks; //fftask[]
-	fflock lk;
+
+	// writers
+	fftask *head; // the last added item
+	ffuint signalled;
+
+	// reader
+	fftask *tail; // the first item
+	fftask stub;
 } fftaskqueue;
 
 static inline void fftaskqueue_init(fftaskqueue *tq)
 {
-	fflist_init(&tq->tasks);
-	fflock_init(&tq->lk);
+	tq->stub.next = NULL;
+	tq->head = &tq->stub;
+	tq->tail = &tq->stub;
+	tq->signalled = 0;
 }
 
 /** Return TRUE if a task is in the queue. */
-#define fftaskqueue_active(tq, t)  ((t)->sib.next != NULL)
+#define fftaskqueue_active(tq, t)  (__atomic_load_n(&(t)->state, __ATOMIC_ACQUIRE) == _FFTASK_QUEUED)
+
+static inline void _fftaskqueue_push(fftaskqueue *tq, fftask *t)
+{
+	t->next = NULL;
+	fftask *prev = _fftq_xchg(&tq->head, t);
+	_fftq_store(&prev->next, t);
+}
 
 /** Add item into task queue.  Thread-safe.
-Return 1 if the queue was empty. */
+Return 1 if the reader must be signalled (the first post since the reader has started processing). */
 static inline ffuint fftaskqueue_post(fftaskqueue *tq, fftask *t)
 {
-	ffuint r = 0;
-
-	fflock_lock(&tq->lk);
-	if (fftaskqueue_active(tq, t))
-		goto done;
-	r = fflist_empty(&tq->tasks);
-	fflist_add(&tq->tasks, &t->sib);
+	ffuint st = _fftq_load(&t->state);
+	for (;;) {
+		if (st == _FFTASK_QUEUED)
+			return 0;
+
+		if (st == _FFTASK_DELETED) {
+			// the task is still in queue: just restore it
+			if (_fftq_cas(&t->state, st, _FFTASK_QUEUED))
+				return 0;
+			continue;
+		}
+
+		if (_fftq_cas(&t->state, st, _FFTASK_QUEUED))
+			break;
+	}
 
-done:
-	fflock_unlock(&tq->lk);
-	return r;
+	_fftaskqueue_push(tq, t);
+	return !_fftq_xchg(&tq->signalled, 1);
 }
 
 #define fftaskqueue_post4(tq, t, func, _param) \
@@ -89,41 +134,88 @@ do { \
 	fftaskqueue_post(tq, t); \
 } while (0)
 
-/** Remove item from task queue. */
+/** Remove item from task queue.
+The item stays in the list until the reader skips it,
+ so the object must remain valid until the next fftaskqueue_run(). */
 static inline void fftaskqueue_del(fftaskqueue *tq, fftask *t)
 {
-	fflock_lock(&tq->lk);
-	if (!fftaskqueue_active(tq, t))
-		goto done;
-	fflist_rm(&tq->tasks, &t->sib);
-
-done:
-	fflock_unlock(&tq->lk);
+	ffuint st = _FFTASK_QUEUED;
+	_fftq_cas(&t->state, st, _FFTASK_DELETED);
 }
 
-/** Call a handler for each task.
-Return the number of tasks executed. */
-static inline ffuint fftaskqueue_run(fftaskqueue *tq)
+/** Get the first item.
+Return NULL if the queue is empty or a writer hasn't yet finished adding the next item. */
+static inline fftask* _fftaskqueue_pop(fftaskqueue *tq)
 {
-	ffchain_item *it, *sentl = fflist_sentl(&tq->tasks);
-	ffuint n = 0, nn = tq->tasks.len;
+	fftask *tail = tq->tail, *next = _fftq_load(&tail->next);
+
+	if (tail == &tq->stub) {
+		if (next == NULL)
+			return NULL;
+		tq->tail = next;
+		tail = next;
+		next = _fftq_load(&next->next);
+	}
 
-	while (n < nn) {
+	if (next != NULL) {
+		tq->tail = next;
+		return tail;
+	}
 
-		it = FFINT_READONCE(fflist_first(&tq->tasks));
-		if (it == sentl)
-			break; // list is empty
+	if (tail != _fftq_load(&tq->head))
+		return NULL; // a writer is in progress
 
-		fflock_lock(&tq->lk);
-		fflist_rm(&tq->tasks, it);
-		fflock_unlock(&tq->lk);
+	_fftaskqueue_push(tq, &tq->stub);
 
-		fftask *t = FF_CONTAINER(fftask, sib, it);
-		fftaskqueue_extralog(tq, "task:%p  handler:%p  param:%p", t, t->handler, t->param);
-		t->handler(t->param);
+	next = _fftq_load(&tail->next);
+	if (next != NULL) {
+		tq->tail = next;
+		return tail;
+	}
+	return NULL;
+}
 
-		n++;
+/** Call a handler for each task.
+Only the tasks added before this call are processed
+ (or all of them, if the last added item is the stub).
+Return the number of tasks executed. */
+static inline ffuint fftaskqueue_run(fftaskqueue *tq)
+{
+	ffuint n = 0;
+	_fftq_xchg(&tq->signalled, 0);
+	// Note: `head` may be the stub re-pushed by _fftaskqueue_pop() while the items before it
+	//  are still in queue, so the queue isn't empty here.
+	fftask *last = _fftq_load(&tq->head);
+
+	for (;;) {
+		fftask *t = _fftaskqueue_pop(tq);
+		if (t == NULL)
+			break;
+
+		for (;;) {
+			ffuint st = _FFTASK_QUEUED;
+			if (_fftq_cas(&t->state, st, _FFTASK_IDLE)) {
+				fftaskqueue_extralog(tq, "task:%p  handler:%p  param:%p", t, t->handler, t->param);
+				t->handler(t->param);
+				n++;
+				break;
+			}
+
+			// deleted
+			if (_fftq_cas(&t->state, st, _FFTASK_IDLE))
+				break;
+			// A writer has restored the deleted task (DELETED -> QUEUED) after we took it from the list:
+			//  the task is still queued, execute it now
+		}
+
+		if (t == last)
+			break;
 	}
 
 	return n;
 }
+
+#undef _fftq_xchg
+#undef _fftq_cas
+#undef _fftq_load
+#undef _fftq_store
@@ -0,0 +1,248 @@
+/** fcom: streaming conversion of UTF-16/codepage data to UTF-8
+2026, Simon Zolin */
+
+/*
+utf8conv_init
+utf8conv_process
+utf8conv_fin
+*/
+
+#pragma once
+#include <ffbase/vector.h>
+#include <ffbase/unicode.h>
+#if defined __SSE2__
+	#include <emmintrin.h>
+#elif defined __ARM_NEON && defined __aarch64__
+	#include <arm_neon.h>
+	#define UTF8CONV_NEON
+#endif
+
+/** Converter state kept between chunks */
+struct utf8conv {
+	ffuint coding; // enum FFUNICODE
+	ffuint ntail;
+	ffbyte tail[4]; // incomplete UTF-16 character from the previous chunk
+};
+
+static inline void utf8conv_init(struct utf8conv *c, ffuint coding)
+{
+	c->coding = coding;
+	c->ntail = 0;
+}
+
+/** Get the number of leading ASCII bytes */
+static inline ffsize _utf8conv_ascii_len(const ffbyte *s, ffsize n)
+{
+	ffsize i = 0;
+
+#if defined __SSE2__
+	for (;  i + 16 <= n;  i += 16) {
+		__m128i v = _mm_loadu_si128((__m128i*)(s + i));
+		ffuint m = _mm_movemask_epi8(v);
+		if (m != 0)
+			return i + __builtin_ctz(m);
+	}
+
+#elif defined UTF8CONV_NEON
+	for (;  i + 16 <= n;  i += 16) {
+		if (vmaxvq_u8(vld1q_u8(s + i)) >= 0x80)
+			break;
+	}
+#endif
+
+	for (;  i != n;  i++) {
+		if (s[i] >= 0x80)
+			break;
+	}
+	return i;
+}
+
+static inline ffuint _utf8conv_put(char *d, ffuint val)
+{
+	if (val < 0x80) {
+		d[0] = val;
+		return 1;
+	} else if (val < 0x800) {
+		d[0] = 0xc0 | (val >> 6);
+		d[1] = 0x80 | (val & 0x3f);
+		return 2;
+	} else if (val < 0x10000) {
+		d[0] = 0xe0 | (val >> 12);
+		d[1] = 0x80 | ((val >> 6) & 0x3f);
+		d[2] = 0x80 | (val & 0x3f);
+		return 3;
+	}
+	d[0] = 0xf0 | (val >> 18);
+	d[1] = 0x80 | ((val >> 12) & 0x3f);
+	d[2] = 0x80 | ((val >> 6) & 0x3f);
+	d[3] = 0x80 | (val & 0x3f);
+	return 4;
+}
+
+#define _UTF8CONV_REPLACEMENT  0xfffd
+
+/** Convert ASCII-only blocks of 8 UTF-16 characters.
+Return the number of input bytes processed */
+static inline ffsize _utf8conv_utf16_ascii(const ffbyte *s, ffsize n, char *d, int be)
+{
+	ffsize i = 0;
+
+#if defined __SSE2__
+	const __m128i hi_mask = _mm_set1_epi16((short)0xff80);
+	const __m128i zero = _mm_setzero_si128();
+	for (;  i + 16 <= n;  i += 16) {
+		__m128i v = _mm_loadu_si128((__m128i*)(s + i));
+		if (be)
+			v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		__m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(v, hi_mask), zero);
+		if (_mm_movemask_epi8(ascii) != 0xffff)
+			break;
+		_mm_storel_epi64((__m128i*)(d + i / 2), _mm_packus_epi16(v, v));
+	}
+
+#elif defined UTF8CONV_NEON
+	for (;  i + 16 <= n;  i += 16) {
+		uint16x8_t v = vreinterpretq_u16_u8(vld1q_u8(s + i));
+		if (be)
+			v = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(v)));
+		if (vmaxvq_u16(v) >= 0x80)
+			break;
+		vst1_u8((ffbyte*)d + i / 2, vmovn_u16(v));
+	}
+#endif
+
+	(void)s; (void)n; (void)d; (void)be;
+	return i;
+}
+
+/** Convert UTF-16 data.
+Stop before an incomplete character at the end of input.
+consumed: [output] the number of input bytes processed
+Return the number of output bytes */
+static inline ffsize _utf8conv_utf16(const ffbyte *s, ffsize n, char *d, ffsize *consumed, int be)
+{
+	ffsize i = 0, o = 0;
+
+	while (i + 2 <= n) {
+		ffsize k = _utf8conv_utf16_ascii(s + i, n - i, d + o, be);
+		i += k;
+		o += k / 2;
+
+		// process the next block with a mix of non-ASCII characters
+		ffsize end = ffmin(i + 16, n);
+		while (i + 2 <= end) {
+			ffuint c = (be) ? ffint_be_cpu16_ptr(s + i) : ffint_le_cpu16_ptr(s + i);
+
+			if (c >= 0xd800 && c < 0xdc00) {
+				if (i + 4 > n)
+					goto done; // the low surrogate is in the next chunk
+
+				ffuint c2 = (be) ? ffint_be_cpu16_ptr(s + i + 2) : ffint_le_cpu16_ptr(s + i + 2);
+				if (c2 >= 0xdc00 && c2 < 0xe000) {
+					c = 0x10000 + (((c - 0xd800) << 10) | (c2 - 0xdc00));
+					i += 2;
+				} else {
+					c = _UTF8CONV_REPLACEMENT; // unpaired high surrogate
+				}
+
+			} else if (c >= 0xdc00 && c < 0xe000) {
+				c = _UTF8CONV_REPLACEMENT; // unpaired low surrogate
+			}
+
+			i += 2;
+			o += _utf8conv_put(d + o, c);
+		}
+	}
+
+done:
+	*consumed = i;
+	return o;
+}
+
+/** Convert the next chunk of input data and append the result to `out`.
+An incomplete character at the end of input is saved until the next call.
+Return 0 on success;
+ -1 on error */
+static inline int utf8conv_process(struct utf8conv *c, const void *_in, ffsize len, ffvec *out)
+{
+	const ffbyte *in = _in;
+	ffsize n, r;
+
+	switch (c->coding) {
+	case FFUNICODE_UTF8:
+		if (NULL == ffvec_add(out, in, len, 1))
+			return -1;
+		return 0;
+
+	case FFUNICODE_UTF16LE:
+	case FFUNICODE_UTF16BE: {
+		int be = (c->coding == FFUNICODE_UTF16BE);
+
+		// UTF-16: 2 bytes -> max. 3 bytes; surrogate pair: 4 bytes -> 4 bytes
+		if (NULL == ffvec_grow(out, (len + c->ntail) / 2 * 3 + 4, 1))
+			return -1;
+
+		while (c->ntail != 0 && len != 0) {
+			n = ffmin(sizeof(c->tail) - c->ntail, len);
+			ffmem_copy(c->tail + c->ntail, in, n);
+			in += n;
+			len -= n;
+			c->ntail += n;
+
+			out->len += _utf8conv_utf16(c->tail, c->ntail, ffslice_end(out, 1), &r, be);
+			c->ntail -= r;
+			ffmem_move(c->tail, c->tail + r, c->ntail);
+		}
+
+		out->len += _utf8conv_utf16(in, len, ffslice_end(out, 1), &r, be);
+		n = len - r;
+		if (n != 0) {
+			FF_ASSERT(c->ntail == 0 && n < sizeof(c->tail));
+			ffmem_copy(c->tail, in + r, n);
+			c->ntail = n;
+		}
+		return 0;
+	}
+	}
+
+	// single-byte codepage: 1 byte -> max. 3 bytes
+	if (NULL == ffvec_grow(out, len * 3, 1))
+		return -1;
+
+	while (len != 0) {
+		n = _utf8conv_ascii_len(in, len);
+		ffmem_copy(ffslice_end(out, 1), in, n);
+		out->len += n;
+		in += n;
+		len -= n;
+
+		for (n = 0;  n != len;  n++) {
+			if (in[n] < 0x80)
+				break;
+		}
+		if (n != 0) {
+			ffssize r2 = ffutf8_from_cp(ffslice_end(out, 1), ffvec_unused(out), (char*)in, n, c->coding);
+			if (r2 < 0)
+				return -1;
+			out->len += r2;
+			in += n;
+			len -= n;
+		}
+	}
+	return 0;
+}
+
+/** Finalize conversion: replace an incomplete character at the end of data.
+Return 0 on success;
+ -1 on error */
+static inline int utf8conv_fin(struct utf8conv *c, ffvec *out)
+{
+	if (c->ntail == 0)
+		return 0;
+
+	c->ntail = 0;
+	if (NULL == ffvec_grow(out, 3, 1))
+		return -1;
+	out->len += _utf8conv_put(ffslice_end(out, 1), _UTF8CONV_REPLACEMENT);
+	return 0;
+}
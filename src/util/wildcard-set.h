@@ -0,0 +1,300 @@
+/** fcom: Match a string against a set of wildcard patterns ('*', '?'), case-insensitive
+2026, Simon Zolin */
+
+/*
+wcset_init wcset_free
+wcset_add
+wcset_compile
+wcset_match
+*/
+
+/*
+The patterns are compiled into 3 tables:
+. exact names ("file.txt") -> hash set
+. suffixes ("*.txt") -> hash set per suffix length
+. everything else -> a single automaton for all patterns
+
+Automaton:
+Each pattern of N tokens ('?', '*' or a character) has N+1 states,
+ and all states of all patterns are stored in one bit array,
+ so all patterns are advanced at once with a few bitwise operations per input character:
+  S = ((S & ADV[c]) << 1) | (S & STAR)
+  S |= (S & STAR) << 1
+ADV[c]: states whose token matches character `c`
+STAR: states whose token is '*'
+A pattern matches if its last state is set after the whole input is processed.
+*/
+
+#pragma once
+#include <ffbase/vector.h>
+#include <ffbase/map.h>
+
+struct _wcset_ent {
+	ffstr pattern;
+	ffstr key; // hash table key: exact name or suffix
+	ffuint i; // index in the order of wcset_add()
+};
+
+typedef struct wcset {
+	ffvec ents; // struct _wcset_ent[]
+	ffmap exact; // name -> struct _wcset_ent*
+	ffmap suffix; // suffix -> struct _wcset_ent*
+	ffvec suffix_lens; // ffuint[]
+	int match_all; // index of "*" pattern; -1: none
+
+	// automaton
+	ffuint nwords; // 64-bit words per state bit array
+	ffuint64 *adv; // [256][nwords]
+	ffuint64 *star, *init, *final; // [nwords]
+	ffuint *state_ent; // state -> pattern index
+} wcset;
+
+static inline ffuint _wcset_hash(const char *s, ffsize len)
+{
+	ffuint h = 0x811c9dc5;
+	for (ffsize i = 0;  i != len;  i++) {
+		h ^= ffchar_lower(s[i]);
+		h *= 0x01000193;
+	}
+	return h;
+}
+
+static int _wcset_keyeq(void *opaque, const void *key, ffsize keylen, void *val)
+{
+	const struct _wcset_ent *e = val;
+	return (e->key.len == keylen && !ffs_icmp(key, e->key.ptr, keylen));
+}
+
+static inline void wcset_init(wcset *w)
+{
+	ffmem_zero_obj(w);
+	ffmap_init(&w->exact, _wcset_keyeq);
+	ffmap_init(&w->suffix, _wcset_keyeq);
+	w->match_all = -1;
+}
+
+static inline void _wcset_nfa_free(wcset *w)
+{
+	ffmem_free(w->adv);  w->adv = NULL;
+	ffmem_free(w->star);  w->star = NULL;
+	ffmem_free(w->init);  w->init = NULL;
+	ffmem_free(w->final);  w->final = NULL;
+	ffmem_free(w->state_ent);  w->state_ent = NULL;
+	w->nwords = 0;
+}
+
+static inline void wcset_free(wcset *w)
+{
+	ffvec_free(&w->ents);
+	ffmap_free(&w->exact);
+	ffmap_free(&w->suffix);
+	ffvec_free(&w->suffix_lens);
+	_wcset_nfa_free(w);
+}
+
+/** Add pattern before wcset_compile().
+The data must remain valid until wcset_free(). */
+static inline void wcset_add(wcset *w, ffstr pattern)
+{
+	struct _wcset_ent *e = ffvec_pushT(&w->ents, struct _wcset_ent);
+	e->pattern = pattern;
+	e->i = w->ents.len - 1;
+}
+
+static inline int _wcset_wild(ffstr s)
+{
+	return (ffs_findany(s.ptr, s.len, "*?", 2) >= 0);
+}
+
+static inline ffuint _wcset_tokens(ffstr s)
+{
+	ffuint n = 0;
+	for (ffsize i = 0;  i != s.len;  i++) {
+		if (s.ptr[i] == '*' && i != 0 && s.ptr[i - 1] == '*')
+			continue; // "**" == "*"
+		n++;
+	}
+	return n;
+}
+
+#define _WCSET_BIT_SET(a, i)  ((a)[(i) / 64] |= (ffuint64)1 << ((i) % 64))
+
+/** Build the automaton from the patterns that don't fit into hash tables */
+static inline int _wcset_nfa_build(wcset *w, ffvec *rest)
+{
+	ffuint nstates = 0;
+	struct _wcset_ent **pe;
+	FFSLICE_WALK(rest, pe) {
+		nstates += _wcset_tokens((*pe)->pattern) + 1;
+	}
+
+	w->nwords = (nstates + 63) / 64;
+	if (NULL == (w->adv = ffmem_calloc(256 * w->nwords, sizeof(ffuint64)))
+		|| NULL == (w->star = ffmem_calloc(w->nwords, sizeof(ffuint64)))
+		|| NULL == (w->init = ffmem_calloc(w->nwords, sizeof(ffuint64)))
+		|| NULL == (w->final = ffmem_calloc(w->nwords, sizeof(ffuint64)))
+		|| NULL == (w->state_ent = ffmem_alloc(nstates * sizeof(ffuint))))
+		return -1;
+
+	ffuint st = 0;
+	FFSLICE_WALK(rest, pe) {
+		ffstr s = (*pe)->pattern;
+		_WCSET_BIT_SET(w->init, st);
+		if (s.len != 0 && s.ptr[0] == '*')
+			_WCSET_BIT_SET(w->init, st + 1); // '*' matches empty string
+
+		for (ffsize i = 0;  i != s.len;  i++) {
+			int c = (ffbyte)s.ptr[i];
+			switch (c) {
+			case '*':
+				if (i != 0 && s.ptr[i - 1] == '*')
+					continue;
+				_WCSET_BIT_SET(w->star, st);
+				break;
+
+			case '?':
+				for (ffuint k = 0;  k != 256;  k++) {
+					_WCSET_BIT_SET(w->adv + k * w->nwords, st);
+				}
+				break;
+
+			default:
+				_WCSET_BIT_SET(w->adv + ffchar_lower(c) * w->nwords, st);
+				_WCSET_BIT_SET(w->adv + ffchar_upper(c) * w->nwords, st);
+			}
+			w->state_ent[st] = (*pe)->i;
+			st++;
+		}
+
+		_WCSET_BIT_SET(w->final, st);
+		w->state_ent[st] = (*pe)->i;
+		st++;
+	}
+	return 0;
+}
+
+/** Prepare the added patterns for matching.
+Return 0 on success */
+static inline int wcset_compile(wcset *w)
+{
+	int rc = -1;
+	ffvec rest = {}; // struct _wcset_ent*[]
+	struct _wcset_ent *e;
+
+	FFSLICE_WALK(&w->ents, e) {
+		ffstr s = e->pattern, sfx = {};
+		if (s.len != 0 && s.ptr[0] == '*')
+			ffstr_set(&sfx, s.ptr + 1, s.len - 1);
+
+		if (!_wcset_wild(s)) {
+			e->key = s;
+			ffmap_add_hash(&w->exact, _wcset_hash(s.ptr, s.len), e);
+
+		} else if (s.ptr[0] == '*' && !_wcset_wild(sfx)) {
+			if (sfx.len == 0) {
+				if (w->match_all < 0)
+					w->match_all = e->i;
+				continue;
+			}
+
+			e->key = sfx;
+			ffmap_add_hash(&w->suffix, _wcset_hash(sfx.ptr, sfx.len), e);
+
+			ffuint *it, found = 0;
+			FFSLICE_WALK(&w->suffix_lens, it) {
+				if (*it == sfx.len) {
+					found = 1;
+					break;
+				}
+			}
+			if (!found)
+				*ffvec_pushT(&w->suffix_lens, ffuint) = sfx.len;
+
+		} else {
+			*ffvec_pushT(&rest, struct _wcset_ent*) = e;
+		}
+	}
+
+	if (rest.len != 0
+		&& _wcset_nfa_build(w, &rest))
+		goto end;
+
+	rc = 0;
+
+end:
+	ffvec_free(&rest);
+	return rc;
+}
+
+static inline int _wcset_nfa_match(const wcset *w, ffstr name)
+{
+	const ffuint n = w->nwords;
+	ffuint64 stk[16], *S = stk;
+	if (n > FF_COUNT(stk)
+		&& NULL == (S = ffmem_alloc(n * sizeof(ffuint64))))
+		return -1;
+
+	ffmem_copy(S, w->init, n * sizeof(ffuint64));
+
+	for (ffsize i = 0;  i != name.len;  i++) {
+		const ffuint64 *adv = w->adv + (ffbyte)name.ptr[i] * n;
+		ffuint64 carry = 0, carry_star = 0, any = 0;
+		for (ffuint k = 0;  k != n;  k++) {
+			ffuint64 a = S[k] & adv[k], st = S[k] & w->star[k];
+			ffuint64 v = (a << 1) | carry | st;
+			carry = a >> 63;
+			// a new state after '*' is active immediately
+			ffuint64 vs = v & w->star[k];
+			v |= (vs << 1) | carry_star;
+			carry_star = vs >> 63;
+			S[k] = v;
+			any |= v;
+		}
+		if (any == 0)
+			break; // no pattern can match
+	}
+
+	int r = -1;
+	for (ffuint k = 0;  k != n;  k++) {
+		ffuint64 v = S[k] & w->final[k];
+		if (v != 0) {
+			r = w->state_ent[k * 64 + __builtin_ctzll(v)];
+			break;
+		}
+	}
+
+	if (S != stk)
+		ffmem_free(S);
+	return r;
+}
+
+/** Find a pattern matching the whole string.
+Return the index of a matching pattern (in the order of wcset_add());
+ -1: no match */
+static inline int wcset_match(const wcset *w, ffstr name)
+{
+	if (w->match_all >= 0)
+		return w->match_all;
+
+	const struct _wcset_ent *e;
+	ffuint hash = _wcset_hash(name.ptr, name.len);
+	if (NULL != (e = ffmap_find_hash((ffmap*)&w->exact, hash, name.ptr, name.len, NULL)))
+		return e->i;
+
+	const ffuint *it;
+	FFSLICE_WALK(&w->suffix_lens, it) {
+		if (*it > name.len)
+			continue;
+		const char *s = name.ptr + name.len - *it;
+		hash = _wcset_hash(s, *it);
+		if (NULL != (e = ffmap_find_hash((ffmap*)&w->suffix, hash, s, *it, NULL)))
+			return e->i;
+	}
+
+	if (w->nwords != 0)
+		return _wcset_nfa_match(w, name);
+
+	return -1;
+}
+
+#undef _WCSET_BIT_SET
@@ -10,6 +10,28 @@ test_tar() {
 	diff fcomtest/tardir/file fcomtest/untardir/fcomtest/tardir/file
 
 	./fcom -V untar "fcomtest/tar.tar" -C "fcomtest/untardir" -l
+
+	# large file: the data is copied by the kernel, to a file and to a pipe
+	head -c 3000000 /dev/urandom >fcomtest/tardir/big
+	./fcom tar "fcomtest/tardir" -o "fcomtest/tar.tar" -f
+	./fcom tar "fcomtest/tardir" -o STDOUT | cat >fcomtest/tar-pipe.tar
+	cmp fcomtest/tar.tar fcomtest/tar-pipe.tar
+	./fcom -V untar "fcomtest/tar.tar" -C "fcomtest/untardir" -f
+	cmp fcomtest/tardir/big fcomtest/untardir/fcomtest/tardir/big
+
+	# many files; mtime of files and directories is preserved
+	mkdir -p fcomtest/tardir/d1/d2
+	for i in $(seq 1 200) ; do
+		echo $i >fcomtest/tardir/d1/d2/$i
+	done
+	touch -d 2020-01-01 fcomtest/tardir/d1/d2/100 fcomtest/tardir/d1/d2 fcomtest/tardir/d1
+	./fcom tar "fcomtest/tardir" -o "fcomtest/tar.tar" -f
+	rm -rf fcomtest/untardir
+	./fcom untar "fcomtest/tar.tar" -C "fcomtest/untardir"
+	diff -r fcomtest/tardir fcomtest/untardir/fcomtest/tardir
+	test "$(stat -c %Y fcomtest/untardir/fcomtest/tardir/d1/d2/100)" = "$(stat -c %Y fcomtest/tardir/d1/d2/100)"
+	test "$(stat -c %Y fcomtest/untardir/fcomtest/tardir/d1/d2)" = "$(stat -c %Y fcomtest/tardir/d1/d2)"
+	test "$(stat -c %Y fcomtest/untardir/fcomtest/tardir/d1)" = "$(stat -c %Y fcomtest/tardir/d1)"
 }
 
 test_un7z() {
@@ -25,6 +47,22 @@ test_un7z() {
 
 	./fcom un7z "fcomtest/7z.7z" -C "fcomtest/un7z" -l
 	./fcom -V un7z "fcomtest/7z.7z" -C "fcomtest/un7z" -l
+
+	# --workers: non-solid archive, 1 folder per file
+	mkdir -p fcomtest/7zdir/d
+	for i in $(seq 1 20) ; do
+		head -c $((i * 10000)) /dev/urandom >fcomtest/7zdir/d/$i
+	done
+	touch fcomtest/7zdir/empty
+	touch -d 2020-01-01 fcomtest/7zdir/d
+	if test -f /usr/bin/7zr ; then
+		7zr a -ms=off fcomtest/7z-ns.7z fcomtest/7zdir
+	else
+		7z a -ms=off fcomtest/7z-ns.7z fcomtest/7zdir
+	fi
+	./fcom -D un7z "fcomtest/7z-ns.7z" -C "fcomtest/un7z-mt" --workers 4
+	diff -r fcomtest/7zdir fcomtest/un7z-mt/7zdir
+	test "$(stat -c %Y fcomtest/un7z-mt/7zdir/d)" = "$(stat -c %Y fcomtest/7zdir/d)"
 }
 
 test_zip() {
@@ -72,6 +110,18 @@ test_zip() {
 	./fcom unzip "fcomtest/zip.zip" -C "fcomtest" --autodir
 	diff fcomtest/zipdir/file1 fcomtest/zip/fcomtest/zipdir/file1
 
+	# --cdir-cache: the 2nd run uses the cache; a modified archive invalidates it
+	local list1=$(./fcom unzip "fcomtest/zip.zip" -l --cdir-cache "fcomtest/zcd")
+	test "$(ls fcomtest/zcd/*.zipcd | wc -l)" == 1
+	local list2=$(./fcom unzip "fcomtest/zip.zip" -l --cdir-cache "fcomtest/zcd")
+	test "$list1" == "$list2"
+	./fcom unzip "fcomtest/zip.zip" -C "fcomtest/unzipcd" -m "fcomtest/zipdir/file3" --cdir-cache "fcomtest/zcd"
+	diff fcomtest/zipdir/file3 fcomtest/unzipcd/fcomtest/zipdir/file3
+	test -f fcomtest/unzipcd/fcomtest/zipdir/file1 && false
+	echo file4 >fcomtest/zipdir/file4
+	./fcom zip "fcomtest/zipdir" -o "fcomtest/zip.zip" -f
+	./fcom unzip "fcomtest/zip.zip" -l --cdir-cache "fcomtest/zcd" | grep file4
+
 	# --each
 	echo file1 >fcomtest/a
 	echo file2 >fcomtest/b
@@ -116,6 +166,16 @@ test_unxz() {
 	xz "fcomtest/file" -c >>fcomtest/file.xz
 	./fcom -V unxz "fcomtest/file.xz" -o "fcomtest/file-d"
 	diff fcomtest/file-d fcomtest/file
+
+	# multi-block, multi-stream: decode blocks in parallel
+	head -c 3000000 /dev/urandom >fcomtest/big
+	xz -T2 --block-size=200KiB -c "fcomtest/big" >fcomtest/big.xz
+	xz -T2 --block-size=300KiB -c "fcomtest/file" >>fcomtest/big.xz
+	cat fcomtest/big fcomtest/file >fcomtest/big-cat
+	./fcom -V unxz "fcomtest/big.xz" -o "fcomtest/big-d" --workers 4 -f
+	cmp fcomtest/big-d fcomtest/big-cat
+	./fcom unxz "fcomtest/big.xz" -o STDOUT --workers 4 | cmp - fcomtest/big-cat
+	cat fcomtest/big.xz | ./fcom unxz "" -o STDOUT --workers 4 | cmp - fcomtest/big-cat
 }
 
 test_iso() {
@@ -3,7 +3,8 @@
 
 TESTS=()
 TESTS+=(copy list move sync touch trash)
-TESTS+=(help hex md5 textcount utf8 html)
+TESTS+=(help hex md5 textcount utf8 html server)
+TESTS+=(keystream pixel_conv)
 CMDS_WIN=(reg_search)
 # pic unico
 
@@ -37,6 +38,25 @@ test_copy_update() {
 	../fcom -V copy --update --replace-date "file" -o "file-rd" | grep 'replace date'
 	../fcom list -l "file" "file-rd"
 
+	# --delta: only the changed blocks are written
+	head -c 5000000 /dev/urandom >file-big
+	../fcom copy --update --delta-hashes "hashes" "file-big" -o "file-big-u" ; cmp file-big file-big-u
+	# the target isn't read: the saved hashes are valid
+	printf 'changed' | dd of=file-big bs=1 seek=3000000 conv=notrunc
+	touch file-big -d '+1 hour'
+	../fcom -D copy --update --delta-hashes "hashes" "file-big" -o "file-big-u" >delta.log
+	grep 'using block hashes' delta.log
+	grep 'delta: written 1,048,576 of 5,000,000' delta.log
+	cmp file-big file-big-u
+	# the target is read
+	printf 'changed' | dd of=file-big bs=1 seek=100 conv=notrunc
+	touch file-big -d '+2 hour'
+	../fcom -V copy --update --delta "file-big" -o "file-big-u" | grep 'delta: written 1,048,576 of 5,000,000'
+	cmp file-big file-big-u
+	# smaller source
+	head -c 2000000 file-big >file-big2 ; touch file-big2 -d '+3 hour'
+	../fcom copy --update --delta "file-big2" -o "file-big-u" ; cmp file-big2 file-big-u
+
 	cd ..
 }
 
@@ -170,6 +190,28 @@ test_list() {
 	./fcom list "fcomtest" "."
 	test "$(./fcom list --oneline "fcomtest" "./fcom")" == '"fcomtest/list" "./fcom" '
 	./fcom list -l "fcomtest" "."
+
+	# directory types from the scan;  --long: more than 1 batch
+	mkdir -p fcomtest/listdir/sub
+	touch fcomtest/listdir/sub/f
+	seq 1 5000 | sed 's,^,fcomtest/listdir/,' | xargs touch
+	test "$(./fcom list "fcomtest/listdir" | wc -l)" == 5002
+	test "$(./fcom list -l "fcomtest/listdir" | wc -l)" == 5002
+	./fcom list -l "fcomtest/listdir" | grep -q ' fcomtest/listdir/sub/f$'
+
+	# --zero, --json, --sort
+	test "$(./fcom list -0 "fcomtest/listdir" | tr -cd '\0' | wc -c)" == 5002
+	./fcom list --json "fcomtest/listdir" | grep -q '^{"name":"fcomtest/listdir/sub","dir":true}$'
+	! ./fcom list --json "fcomtest/listdir" "fcomtest/list" | grep -q '"size"'
+	./fcom list --json -l "fcomtest/listdir/sub" | grep -q '^{"name":"fcomtest/listdir/sub/f","dir":false,"size":0,"mtime":[0-9]*}$'
+	# larger than any directory
+	head -c 100000 /dev/zero >fcomtest/listdir/2
+	test "$(./fcom list --sort size "fcomtest/listdir" | tail -1)" == "fcomtest/listdir/2"
+	test "$(./fcom list --sort name "fcomtest/listdir" | head -3 | tr '\n' ' ')" == "fcomtest/listdir/1 fcomtest/listdir/10 fcomtest/listdir/100 "
+	! ./fcom list --sort unknown "fcomtest/listdir"
+
+	# names from STDIN: more than 1 portion
+	test "$(seq 1 20000 | sed 's,.*,fcomtest/list,' | ./fcom list @- | grep -c 'fcomtest/list')" == 20000
 }
 
 test_md5() {
@@ -237,6 +279,11 @@ test_move() {
 	test -f fcomtest/odir/fcomtest/idir/idir2/hi
 }
 
+# Print "WIDTHxHEIGHT" from BMP header
+bmp_dims() {
+	od -An -t d4 -j 18 -N 8 "$1" | awk '{ h = ($2 < 0) ? -$2 : $2; print $1 "x" h }'
+}
+
 test_pic() {
 
 	spectacle -o fcomtest/fileo.bmp -b
@@ -270,6 +317,27 @@ test_pic() {
 	./fcom pic "fcomtest/file.png" -o "fcomtest/filepng.bmp"
 	test -f fcomtest/filepng.bmp
 
+	# resize
+	./fcom pic "fcomtest/file.jpg" --max-side 100 -o "fcomtest/file-small.png"
+	test -f fcomtest/file-small.png
+	./fcom pic "fcomtest/file.png" --resize 64x48 --resize-filter lanczos -o "fcomtest/file-64x48.bmp"
+	test "$(bmp_dims fcomtest/file-64x48.bmp)" == "64x48"
+	./fcom pic "fcomtest/file.bmp" --resize x48 -o "fcomtest/file-h48.jpg"
+	test -f fcomtest/file-h48.jpg
+	# check the size of the output image: the proportions are kept
+	local w=$(bmp_dims fcomtest/file.bmp | cut -dx -f1)
+	local h=$(bmp_dims fcomtest/file.bmp | cut -dx -f2)
+	./fcom pic "fcomtest/file.bmp" --resize x48 -o "fcomtest/file-h48.bmp"
+	test "$(bmp_dims fcomtest/file-h48.bmp)" == "$(( w * 48 / h > 0 ? w * 48 / h : 1 ))x48"
+	./fcom pic "fcomtest/file.bmp" --max-side 100 -o "fcomtest/file-small.bmp"
+	if test $w -le 100 && test $h -le 100 ; then
+		test "$(bmp_dims fcomtest/file-small.bmp)" == "${w}x${h}"
+	elif test $w -ge $h ; then
+		test "$(bmp_dims fcomtest/file-small.bmp)" == "100x$(( h * 100 / w > 0 ? h * 100 / w : 1 ))"
+	else
+		test "$(bmp_dims fcomtest/file-small.bmp)" == "$(( w * 100 / h > 0 ? w * 100 / h : 1 ))x100"
+	fi
+
 	# autoname
 	mkdir fcomtest/multi
 	cd fcomtest/multi
@@ -282,6 +350,12 @@ test_pic() {
 	mv fcomtest/file.bmp fcomtest/filepng.bmp fcomtest/dir1/dir2/
 	./fcom -V pic fcomtest/dir1 -C "fcomtest/multi" -o ".jpg"
 	diff fcomtest/multi/dir1/dir2/file.jpg fcomtest/multi/dir1/dir2/filepng.jpg
+
+	# parallel
+	mkdir fcomtest/multi-j
+	./fcom -V pic fcomtest/dir1 -C "fcomtest/multi-j" -o ".jpg" --jobs 4
+	diff fcomtest/multi/dir1/dir2/file.jpg fcomtest/multi-j/dir1/dir2/file.jpg
+	diff fcomtest/multi/dir1/dir2/filepng.jpg fcomtest/multi-j/dir1/dir2/filepng.jpg
 }
 
 test_unico() {
@@ -422,22 +496,106 @@ test_trash() {
 	echo 123 >fcomtest/trash
 	echo 123 >fcomtest/trash2
 	./fcom -V trash "fcomtest/trash" "fcomtest/trash2" --wipe --rename -f
+
+	# freedesktop.org Trash: many files, the same names
+	mkdir -p fcomtest/trashdir/a fcomtest/trashdir/b
+	seq 1 1000 | sed 's,^,fcomtest/trashdir/a/,' | xargs touch
+	seq 1 1000 | sed 's,^,fcomtest/trashdir/b/,' | xargs touch
+	echo 123 >"fcomtest/trashdir/a/x y"
+	local xdg="$PWD/fcomtest/xdg"
+	XDG_DATA_HOME="$xdg" ./fcom trash fcomtest/trashdir/a/* fcomtest/trashdir/b/*
+	test "$(ls fcomtest/trashdir/a fcomtest/trashdir/b | grep -c '^[0-9]')" == 0
+	test "$(ls $xdg/Trash/files | wc -l)" == 2001
+	test "$(ls $xdg/Trash/info | wc -l)" == 2001
+	grep -q "^Path=$PWD/fcomtest/trashdir/a/x%20y$" "$xdg/Trash/info/x y.trashinfo"
+	grep -q '^DeletionDate=....-..-..T..:..:..$' "$xdg/Trash/info/x y.trashinfo"
+	diff "$xdg/Trash/files/x y" - <<< 123
+
+	# --wipe: several write-behind windows
+	head -c 20000000 /dev/zero >fcomtest/trash
+	./fcom -V trash "fcomtest/trash" --wipe -f
+	! test -f fcomtest/trash
 }
 
 test_utf8() {
-
-	# ./fcom utf8 "fcomtest/file-utf16" -o "fcomtest/file-utf8"
-	# diff fcomtest/file fcomtest/file-utf8
-	echo
+	# the input is read by 4KB: the characters at the offsets 4092..4096 straddle the chunk boundary
+	for pad in 2045 2046 2047 ; do
+		# UTF-16LE: BOM, 'a' x pad, U+1F600 (surrogate pair), U+0416, 'b', incomplete character
+		{ printf '\xff\xfe' ; printf 'a\0%.0s' $(seq $pad) ; printf '\x3d\xd8\x00\xde\x16\x04b\0\x3d\xd8' ; } >fcomtest/utf16le
+		# UTF-16BE: the same text; a single odd byte at the end
+		{ printf '\xfe\xff' ; printf '\0a%.0s' $(seq $pad) ; printf '\xd8\x3d\xde\x00\x04\x16\0b\x00' ; } >fcomtest/utf16be
+		{ printf 'a%.0s' $(seq $pad) ; printf '\xf0\x9f\x98\x80\xd0\x96b\xef\xbf\xbd' ; } >fcomtest/utf8-expect
+		./fcom utf8 "fcomtest/utf16le" -o "fcomtest/utf8-le" --buffer 4096 --overwrite
+		cmp fcomtest/utf8-expect fcomtest/utf8-le
+		./fcom utf8 "fcomtest/utf16be" -o "fcomtest/utf8-be" --buffer 4096 --overwrite
+		cmp fcomtest/utf8-expect fcomtest/utf8-be
+
+		# UTF-8 with BOM: U+1F600 split between the chunks
+		{ printf '\xef\xbb\xbf' ; printf 'a%.0s' $(seq $((pad * 2 - 1))) ; printf '\xf0\x9f\x98\x80b' ; } >fcomtest/utf8-bom
+		{ printf 'a%.0s' $(seq $((pad * 2 - 1))) ; printf '\xf0\x9f\x98\x80b' ; } >fcomtest/utf8-expect
+		./fcom utf8 "fcomtest/utf8-bom" -o "fcomtest/utf8" --buffer 4096 --overwrite
+		cmp fcomtest/utf8-expect fcomtest/utf8
+	done
 }
 
 test_html() {
 	cat <<EOF >fcomtest/html
 <tag attr="123"></tag>
 <tag attr="234"/>
+<a href='345' id=456>
 EOF
 	./fcom html "fcomtest/html" --filter "tag.attr" | grep 123
 	./fcom html "fcomtest/html" --filter "tag.attr" | grep 234
+	./fcom html "fcomtest/html" --filter "tag.attr" --filter "a.href" --filter "a.id" >fcomtest/html.out
+	grep 123 fcomtest/html.out
+	grep 345 fcomtest/html.out
+	grep 456 fcomtest/html.out
+	# a very large token split across reads is skipped, the next tags are processed
+	{ printf '<tag attr="' ; head -c 1000000 /dev/zero | tr '\0' x ; printf '"></tag>\n<tag attr="567"/>\n' ; } >fcomtest/html-big
+	./fcom html "fcomtest/html-big" --filter "tag.attr" | grep 567
+	# unquoted value of a self-closing tag
+	echo '<a href=x/y/>' >fcomtest/html-sc
+	test "$(./fcom html "fcomtest/html-sc" --filter "a.href")" == "x/y"
+	# the output file is created even if nothing matches
+	./fcom html "fcomtest/html" --filter "b.href" -o fcomtest/html-empty.out
+	test -f fcomtest/html-empty.out
+	! test -s fcomtest/html-empty.out
+}
+
+test_server() {
+	export FCOM_SOCKET=$(pwd)/fcomtest/fcom.sock
+	./fcom --server &
+	local pid=$!
+	while ! test -S $FCOM_SOCKET ; do sleep .1 ; done
+
+	echo hello >fcomtest/file
+	mkdir fcomtest/dir
+	cd fcomtest/dir
+	# relative paths, stdin & stdout of the client
+	../../fcom --client md5 ../file | grep file
+	../../fcom --client list @- <<<"../file" | grep file
+	../../fcom --client copy ../file -o file-copy ; diff ../file file-copy
+	# exit code of the operation
+	! ../../fcom --client list nonexistent
+	# the server accepts the next client after a failed request
+	! ../../fcom --client no-such-op
+	../../fcom --client md5 ../file | grep file
+	cd ../..
+
+	kill $pid
+	wait $pid || true
+	unset FCOM_SOCKET
+}
+
+# unit tests: the binaries are built in the parent directory of the app directory
+test_keystream() {
+	make -C .. keystream-test
+	../keystream-test
+}
+
+test_pixel_conv() {
+	make -C .. pixel-conv-test
+	../pixel-conv-test
 }
 
 source "$(dirname $0)/test-pack.sh"